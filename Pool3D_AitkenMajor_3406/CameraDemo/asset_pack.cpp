@@ -0,0 +1,151 @@
+#include <stdexcept>
+#include <ios>
+#include <algorithm>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "asset_pack.h"
+
+namespace game {
+
+uint64_t HashName(const std::string &name, uint64_t hash){
+
+    for (unsigned char c : name){
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+
+AssetPack::AssetPack(void){
+
+    data_ = NULL;
+    size_ = 0;
+    entry_ = NULL;
+    entry_num_ = 0;
+#ifdef _WIN32
+    file_ = NULL;
+    mapping_ = NULL;
+#endif
+}
+
+
+AssetPack::~AssetPack(){
+
+    Close();
+}
+
+
+void AssetPack::Open(const std::string &filename){
+
+    Close();
+
+    // Map the whole file read-only
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE){
+        throw(std::ios_base::failure(std::string("Error opening asset pack ")+filename));
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    const void *data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!data){
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        throw(std::ios_base::failure(std::string("Error mapping asset pack ")+filename));
+    }
+    file_ = file;
+    mapping_ = mapping;
+    size_ = (size_t) size.QuadPart;
+#else
+    int file = open(filename.c_str(), O_RDONLY);
+    if (file < 0){
+        throw(std::ios_base::failure(std::string("Error opening asset pack ")+filename));
+    }
+    struct stat info;
+    void *data = MAP_FAILED;
+    if (fstat(file, &info) == 0 && info.st_size > 0){
+        data = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    }
+    // The mapping stays valid after the file is closed
+    close(file);
+    if (data == MAP_FAILED){
+        throw(std::ios_base::failure(std::string("Error mapping asset pack ")+filename));
+    }
+    size_ = (size_t) info.st_size;
+#endif
+    data_ = (const unsigned char *) data;
+
+    // Check the header and that the index and all entries lie inside the file
+    const PackHeader *header = (const PackHeader *) data_;
+    bool valid = size_ >= sizeof(PackHeader) && header->magic == pack_magic_g && header->version == pack_version_g &&
+                 header->entry_num <= (size_ - sizeof(PackHeader)) / sizeof(PackEntry);
+    if (valid){
+        entry_ = (const PackEntry *) (data_ + sizeof(PackHeader));
+        entry_num_ = header->entry_num;
+        for (uint32_t i = 0; i < entry_num_ && valid; i++){
+            valid = entry_[i].offset <= size_ && entry_[i].size <= size_ - entry_[i].offset;
+        }
+    }
+    if (!valid){
+        Close();
+        throw(std::ios_base::failure(std::string("Invalid asset pack ")+filename));
+    }
+}
+
+
+void AssetPack::Close(void){
+
+    if (!data_){
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+    CloseHandle((HANDLE) mapping_);
+    CloseHandle((HANDLE) file_);
+    file_ = NULL;
+    mapping_ = NULL;
+#else
+    munmap((void *) data_, size_);
+#endif
+    data_ = NULL;
+    size_ = 0;
+    entry_ = NULL;
+    entry_num_ = 0;
+}
+
+
+bool AssetPack::IsOpen(void) const {
+
+    return data_ != NULL;
+}
+
+
+PackSpan AssetPack::Find(uint64_t key, PackEntryType type) const {
+
+    const PackEntry *end = entry_ + entry_num_;
+    const PackEntry *found = std::lower_bound(entry_, end, key, [](const PackEntry &e, uint64_t k){ return e.key < k; });
+    if (found != end && found->key == key && found->type == (uint32_t) type){
+        return PackSpan(data_ + found->offset, (size_t) found->size);
+    }
+    return PackSpan();
+}
+
+
+PackSpan AssetPack::FindFile(const std::string &filename) const {
+
+    size_t slash = filename.find_last_of("/\\");
+    return Find(HashName(slash == std::string::npos ? filename : filename.substr(slash + 1)), PackedFile);
+}
+
+} // namespace game
@@ -0,0 +1,94 @@
+#ifndef ASSET_PACK_H_
+#define ASSET_PACK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace game {
+
+    // Asset pack file: a PackHeader, the PackEntry index sorted by key, then the data of
+    // the entries, each aligned to pack_alignment_g bytes. The file is mapped into memory
+    // and read in place, so entries are used without copying or parsing
+    const uint32_t pack_magic_g = 0x4b415041; // "APAK"
+    const uint32_t pack_version_g = 1;
+    const uint32_t pack_alignment_g = 16;
+
+    // Kind of data in an entry
+    typedef enum Packed { PackedFile = 0, PackedMesh = 1 } PackEntryType;
+
+    struct PackHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entry_num;
+        uint32_t reserved;
+    };
+
+    struct PackEntry {
+        uint64_t key; // HashName of the file name (PackedFile) or mesh description (PackedMesh)
+        uint32_t type; // PackEntryType
+        uint32_t reserved;
+        uint64_t offset; // From the start of the pack
+        uint64_t size;
+    };
+
+    // Start of the data of a PackedMesh entry; offsets are from the start of the entry.
+    // Vertices are in packed_vertex_format_g, indices are 16 or 32-bit
+    struct PackMeshHeader {
+        uint32_t vertex_num;
+        uint32_t index_num;
+        uint32_t index_size; // Bytes per index
+        uint32_t vertex_offset;
+        uint32_t index_offset;
+        float position_offset[3]; // Dequantization of the stored positions
+        float position_scale[3];
+    };
+
+    // 64-bit FNV-1a hash of a string (keys of the pack entries)
+    uint64_t HashName(const std::string &name, uint64_t hash = 0xcbf29ce484222325ULL);
+
+    // Read-only bytes of an entry (data is null when the entry does not exist)
+    struct PackSpan {
+        const unsigned char *data;
+        size_t size;
+
+        PackSpan(void) : data(NULL), size(0) {}
+        PackSpan(const unsigned char *d, size_t s) : data(d), size(s) {}
+    };
+
+    // Class that maps an asset pack for reading. Lookups are thread-safe
+    class AssetPack {
+
+        public:
+            AssetPack(void);
+            ~AssetPack();
+
+            // Map a pack file (throws std::ios_base::failure if it is missing or invalid)
+            void Open(const std::string &filename);
+            void Close(void);
+            bool IsOpen(void) const;
+
+            // Entry with this key and type (binary search of the index)
+            PackSpan Find(uint64_t key, PackEntryType type) const;
+            // Bundled file by name (only the file name counts, not its directory)
+            PackSpan FindFile(const std::string &filename) const;
+
+        private:
+            const unsigned char *data_; // Mapped file
+            size_t size_;
+            const PackEntry *entry_; // Index, sorted by key
+            uint32_t entry_num_;
+#ifdef _WIN32
+            void *file_; // Handles of the file and its mapping
+            void *mapping_;
+#endif
+
+            // Copying would unmap the file twice
+            AssetPack(const AssetPack &);
+            AssetPack &operator=(const AssetPack &);
+
+    }; // class AssetPack
+
+} // namespace game
+
+#endif // ASSET_PACK_H_
@@ -9,9 +9,4 @@ Ball::Ball(const std::string& name, const Resource *geometry, const Resource *ma
 Ball::~Ball() {
 }
 
-void Ball::Update(void) {
-    // No per-frame update here; physics and transforms are driven by the Game's physics step.
-    // Keep as a no-op to avoid duplicating state changes.
-}
-
 } // namespace game
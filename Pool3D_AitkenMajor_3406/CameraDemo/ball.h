@@ -22,8 +22,8 @@ namespace game {
 
         virtual ~Ball();
 
-        // Update called by scene; override if needed
-        virtual void Update(void) override;
+        // No Update: physics and transforms are driven by the Game's physics step, so balls
+        // are not registered with the update scheduler
 
         // Velocity
         glm::vec3 GetVelocity() const { return velocity_; }
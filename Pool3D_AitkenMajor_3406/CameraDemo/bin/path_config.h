@@ -1 +1,3 @@
 #define MATERIAL_DIRECTORY "C:/Users/ethan/OneDrive/University Work/Computer Science/Advanced Game Development/Project/Pool3D_AitkenMajor_3406/CameraDemo"
+#define PROGRAM_CACHE_DIRECTORY "C:/Users/ethan/OneDrive/University Work/Computer Science/Advanced Game Development/Project/Pool3D_AitkenMajor_3406/CameraDemo/bin/program_cache"
+#define PACK_FILE "C:/Users/ethan/OneDrive/University Work/Computer Science/Advanced Game Development/Project/Pool3D_AitkenMajor_3406/CameraDemo/bin/assets.pak"
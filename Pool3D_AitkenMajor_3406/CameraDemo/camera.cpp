@@ -10,6 +10,8 @@
 namespace game {
 
 Camera::Camera(void){
+
+    viewport_height_ = 0.0f;
 }
 
 
@@ -123,25 +125,26 @@ void Camera::SetProjection(GLfloat fov, GLfloat near, GLfloat far, GLfloat w, GL
     float top = tan((fov/2.0)*(glm::pi<float>()/180.0))*near;
     float right = top * w/h;
     projection_matrix_ = glm::frustum(-right, right, -top, top, near, far);
+    viewport_height_ = h;
 }
 
 
-void Camera::SetupShader(GLuint program){
+void Camera::SetupShader(GLuint program, RenderBackend *backend){
 
     // Update view matrix
     SetupViewMatrix();
 
     // Set view matrix in shader
-    GLint view_mat = glGetUniformLocation(program, "view_mat");
-    glUniformMatrix4fv(view_mat, 1, GL_FALSE, glm::value_ptr(view_matrix_));
+    GLint view_mat = backend->GetUniformLocation(program, "view_mat");
+    backend->SetUniform(view_mat, view_matrix_);
     
     // Set projection matrix in shader
-    GLint projection_mat = glGetUniformLocation(program, "projection_mat");
-    glUniformMatrix4fv(projection_mat, 1, GL_FALSE, glm::value_ptr(projection_matrix_));
+    GLint projection_mat = backend->GetUniformLocation(program, "projection_mat");
+    backend->SetUniform(projection_mat, projection_matrix_);
 }
 
 
-void Camera::SetupViewMatrix(void){
+glm::mat4 Camera::GetViewMatrix(void) const {
 
     //view_matrix_ = glm::lookAt(position, look_at, up);
 
@@ -154,28 +157,49 @@ void Camera::SetupViewMatrix(void){
     current_up = glm::normalize(current_up);
 
     // Initialize the view matrix as an identity matrix
-    view_matrix_ = glm::mat4(1.0); 
+    glm::mat4 view_matrix = glm::mat4(1.0); 
 
     // Copy vectors to matrix
     // Add vectors to rows, not columns of the matrix, so that we get
     // the inverse transformation
     // Note that in glm, the reference for matrix entries is of the form
     // matrix[column][row]
-    view_matrix_[0][0] = current_side[0]; // First row
-    view_matrix_[1][0] = current_side[1];
-    view_matrix_[2][0] = current_side[2];
-    view_matrix_[0][1] = current_up[0]; // Second row
-    view_matrix_[1][1] = current_up[1];
-    view_matrix_[2][1] = current_up[2];
-    view_matrix_[0][2] = current_forward[0]; // Third row
-    view_matrix_[1][2] = current_forward[1];
-    view_matrix_[2][2] = current_forward[2];
+    view_matrix[0][0] = current_side[0]; // First row
+    view_matrix[1][0] = current_side[1];
+    view_matrix[2][0] = current_side[2];
+    view_matrix[0][1] = current_up[0]; // Second row
+    view_matrix[1][1] = current_up[1];
+    view_matrix[2][1] = current_up[2];
+    view_matrix[0][2] = current_forward[0]; // Third row
+    view_matrix[1][2] = current_forward[1];
+    view_matrix[2][2] = current_forward[2];
 
     // Create translation to camera position
     glm::mat4 trans = glm::translate(glm::mat4(1.0), -position_);
 
     // Combine translation and view matrix in proper order
-    view_matrix_ *= trans;
+    view_matrix *= trans;
+
+    return view_matrix;
+}
+
+
+glm::mat4 Camera::GetProjectionMatrix(void) const {
+
+    return projection_matrix_;
+}
+
+
+float Camera::GetProjectionScale(void) const {
+
+    // projection_matrix_[1][1] maps view-space y/depth to [-1, 1]
+    return projection_matrix_[1][1] * viewport_height_ * 0.5f;
+}
+
+
+void Camera::SetupViewMatrix(void){
+
+    view_matrix_ = GetViewMatrix();
 }
 
 } // namespace game
@@ -7,6 +7,8 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
+#include "render_backend.h"
+
 
 namespace game {
 
@@ -46,8 +48,14 @@ namespace game {
             // Set projection from frustum parameters: field-of-view,
             // near and far planes, and width and height of viewport
             void SetProjection(GLfloat fov, GLfloat near, GLfloat far, GLfloat w, GLfloat h);
-            // Set all camera-related variables in shader program
-            void SetupShader(GLuint program);
+            // Set all camera-related variables in shader program (bound through 'backend')
+            void SetupShader(GLuint program, RenderBackend *backend);
+
+            // Get the current view and projection matrices
+            glm::mat4 GetViewMatrix(void) const;
+            glm::mat4 GetProjectionMatrix(void) const;
+            // Pixels covered by one world unit at unit distance in front of the camera
+            float GetProjectionScale(void) const;
 
         private:
             glm::vec3 position_; // Position of camera
@@ -56,6 +64,7 @@ namespace game {
             glm::vec3 side_; // Initial side vector
             glm::mat4 view_matrix_; // View matrix
             glm::mat4 projection_matrix_; // Projection matrix
+            float viewport_height_; // Height of viewport in pixels
 
             // Create view matrix from current camera parameters
             void SetupViewMatrix(void);
@@ -0,0 +1,89 @@
+#include <cfloat>
+
+#include "frustum.h"
+
+namespace game {
+
+Frustum::Frustum(void){
+
+    // Padding planes always contain the sphere
+    for (int i = 0; i < 8; i++){
+        a_[i] = 0.0f;
+        b_[i] = 0.0f;
+        c_[i] = 0.0f;
+        d_[i] = FLT_MAX;
+    }
+}
+
+
+Frustum::~Frustum(){
+}
+
+
+void Frustum::Set(const glm::mat4 &view_projection){
+
+    // Gribb/Hartmann plane extraction: each plane is the sum or difference
+    // of the last row of the clip matrix with one of the other rows.
+    // Note that in glm the reference for matrix entries is matrix[column][row]
+    const glm::mat4 &m = view_projection;
+    for (int i = 0; i < 6; i++){
+        int row = i / 2; // left/right: x, bottom/top: y, near/far: z
+        float sign = (i % 2 == 0) ? 1.0f : -1.0f;
+        glm::vec4 plane(m[0][3] + sign * m[0][row],
+                        m[1][3] + sign * m[1][row],
+                        m[2][3] + sign * m[2][row],
+                        m[3][3] + sign * m[3][row]);
+
+        // Normalize so the plane equation gives the euclidean distance
+        float len = glm::length(glm::vec3(plane.x, plane.y, plane.z));
+        if (len > 0.0f){
+            plane = plane / len;
+        }
+        a_[i] = plane.x;
+        b_[i] = plane.y;
+        c_[i] = plane.z;
+        d_[i] = plane.w;
+    }
+}
+
+
+bool Frustum::TestSphere(const glm::vec3 &center, float radius, unsigned &mask) const {
+
+    // Bit i set: sphere is outside (or fully inside) plane i
+    unsigned outside = 0;
+    unsigned inside = 0;
+
+#ifdef FRUSTUM_USE_SSE
+    const __m128 x = _mm_set1_ps(center.x);
+    const __m128 y = _mm_set1_ps(center.y);
+    const __m128 z = _mm_set1_ps(center.z);
+    const __m128 r = _mm_set1_ps(radius);
+    const __m128 neg_r = _mm_set1_ps(-radius);
+    for (int g = 0; g < 8; g += 4){
+        __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(a_ + g), x),
+                                            _mm_mul_ps(_mm_load_ps(b_ + g), y)),
+                                 _mm_add_ps(_mm_mul_ps(_mm_load_ps(c_ + g), z),
+                                            _mm_load_ps(d_ + g)));
+        outside |= (unsigned) _mm_movemask_ps(_mm_cmplt_ps(dist, neg_r)) << g;
+        inside |= (unsigned) _mm_movemask_ps(_mm_cmpge_ps(dist, r)) << g;
+    }
+#else
+    for (int i = 0; i < 6; i++){
+        float dist = a_[i] * center.x + b_[i] * center.y + c_[i] * center.z + d_[i];
+        if (dist < -radius){
+            outside |= 1u << i;
+        }
+        else if (dist >= radius){
+            inside |= 1u << i;
+        }
+    }
+#endif
+
+    if (outside & mask){
+        return false;
+    }
+    mask &= ~inside;
+    return true;
+}
+
+} // namespace game
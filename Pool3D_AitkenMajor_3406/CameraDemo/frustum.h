@@ -0,0 +1,50 @@
+#ifndef FRUSTUM_H_
+#define FRUSTUM_H_
+
+#include <glm/glm.hpp>
+
+// Use SSE for the plane tests when the target supports it
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace game {
+
+    // Counters of the culling pass
+    struct CullStats {
+        int drawn; // Nodes sent to the render queue
+        int culled; // Nodes rejected by the frustum test
+    };
+
+    // View frustum as six planes, used to cull bounding spheres
+    class Frustum {
+
+        public:
+            // Mask with the bits of all six planes set
+            static const unsigned AllPlanes = 0x3F;
+
+            Frustum(void);
+            ~Frustum();
+
+            // Extract the planes from a combined projection * view matrix
+            void Set(const glm::mat4 &view_projection);
+
+            // Test a world-space sphere against the planes whose bits are set in 'mask'.
+            // Returns false if the sphere is outside the frustum. Otherwise clears the bits
+            // of the planes the sphere is entirely inside of, so children can skip them.
+            bool TestSphere(const glm::vec3 &center, float radius, unsigned &mask) const;
+
+        private:
+            // Planes in structure-of-arrays form (a*x + b*y + c*z + d >= 0 inside),
+            // padded to 8 so they can be tested four at a time
+            alignas(16) float a_[8];
+            alignas(16) float b_[8];
+            alignas(16) float c_[8];
+            alignas(16) float d_[8];
+
+    }; // class Frustum
+
+} // namespace game
+
+#endif // FRUSTUM_H_
@@ -7,7 +7,11 @@
 #include <glm/glm.hpp>
 #include <iostream>
 #include <time.h>
+#include <ctime>
+#include <cfloat>
+#include <cstdio>
 #include <sstream>
+#include <iomanip>
 #include <cmath>
 #include <vector>
 #include <algorithm>
@@ -36,6 +40,54 @@ namespace game {
 
     // Materials 
     const std::string material_directory_g = MATERIAL_DIRECTORY;
+    // Asset packs tried in order: beside a relocated executable, then the one the build made
+    const char *pack_file_g[] = { "assets.pak", PACK_FILE };
+
+    // Ball types of the field: base color and stripe flag. All balls share the "Sphere" mesh,
+    // so a new type only needs a new entry here
+    struct BallStyle {
+        glm::vec3 color;
+        bool stripe;
+    };
+    const BallStyle ball_styles_g[] = {
+        // 1 black solid + 7 solids (yellow, blue, red, purple, orange, green, red)
+        { glm::vec3(0.0f, 0.0f, 0.0f), false },
+        { glm::vec3(1.0f, 1.0f, 0.0f), false },
+        { glm::vec3(0.0f, 0.0f, 1.0f), false },
+        { glm::vec3(1.0f, 0.0f, 0.0f), false },
+        { glm::vec3(0.5f, 0.0f, 0.5f), false },
+        { glm::vec3(1.0f, 0.5f, 0.0f), false },
+        { glm::vec3(0.0f, 1.0f, 0.0f), false },
+        { glm::vec3(0.6f, 0.0f, 0.0f), false },
+        // gradient counterparts (same order except black has no stripe)
+        { glm::vec3(1.0f, 1.0f, 0.0f), true },
+        { glm::vec3(0.0f, 0.0f, 1.0f), true },
+        { glm::vec3(1.0f, 0.0f, 0.0f), true },
+        { glm::vec3(0.5f, 0.0f, 0.5f), true },
+        { glm::vec3(1.0f, 0.5f, 0.0f), true },
+        { glm::vec3(0.0f, 1.0f, 0.0f), true },
+        { glm::vec3(0.6f, 0.0f, 0.0f), true }
+    };
+    const glm::vec3 white_ball_color_g(1.0f, 1.0f, 1.0f);
+    const glm::vec3 pocket_color_g(0.3f, 0.3f, 0.3f);
+
+    // Time per frame spent creating GL objects of resources built in the background (seconds)
+    const double upload_budget_g = 0.002;
+    // GPU memory of the resources; beyond it, resources no node uses are deleted
+    const size_t resource_memory_budget_g = 64 * 1024 * 1024;
+
+    // Scripted camera of the benchmark: orbit around the playing field at this distance and height
+    const float benchmark_orbit_radius_g = 800.0f;
+    const float benchmark_orbit_height_g = 200.0f;
+
+    // File written by the trace key (F2)
+    const std::string trace_filename_g = "frame_trace.json";
+
+    // Longest wait for events while the table is idle (seconds)
+    const double idle_wait_timeout_g = 0.25;
+
+    // Seed of the simulation's random numbers, unless a replayed input log sets another
+    const unsigned random_seed_g = 5489u;
 
 
     Game::Game(void) : window_(nullptr), animating_(true),
@@ -46,18 +98,37 @@ namespace game {
         pocket_radius_multiplier_(1.5f),
         has_stored_third_(false), has_stored_fp_(false), has_stored_fp_forward_(false),
         physics_active_(false), physics_stop_threshold_(0.01f),
-        tracer_node_(nullptr), tracer_length_(400.0f), tracer_thickness_(5.0f),
-        tracer_debug_draw_(false)
+        stats_elapsed_(0.0), stats_packet_(nullptr),
+        tick_(0), tick_time_(0.0), replaying_(false), replay_next_(0), seed_(random_seed_g), rng_(random_seed_g),
+        redraw_(true), keys_held_(0),
+        framebuffer_width_(0), framebuffer_height_(0), pending_uploads_(0),
+        tracer_node_(nullptr), tracer_length_(400.0f), tracer_thickness_(5.0f), tracer_debug_draw_(false),
+        threaded_rendering_(true)
     {
         // Don't do heavy work in constructor; Init() will do it.
+        std::fill(key_down_, key_down_ + GLFW_KEY_LAST + 1, false);
+
+        // Physics advances with the fixed ticks of the main loop; the tracer follows once per
+        // frame that ran a tick, and the stats in the title are checked at the slow rate
+        scheduler_.Register(FixedTickTier, &Game::PhysicsTick, this);
+        tracer_update_ = scheduler_.Register(OnEventTier, &Game::TracerUpdate, this);
+        scheduler_.Register(SlowTier, &Game::StatsUpdate, this);
     }
 
     Game::~Game() {
+        // Take the context back from the render thread (if MainLoop did not return)
+        render_thread_.Stop();
+        // Free the GPU memory of the resources while the context exists
+        if (window_ || offscreen_context_.IsCreated()) {
+            resman_.UnloadAll();
+        }
+        offscreen_target_.Destroy();
+        offscreen_context_.Destroy();
         // Terminate GLFW and allow other destructors to run
         glfwTerminate();
     }
 
-    Ball* Game::CreateBallInstance(std::string entity_name, std::string object_name, std::string material_name) {
+    Ball* Game::CreateBallInstance(std::string entity_name, std::string object_name, std::string material_name, const glm::vec3& color, ColorMode mode) {
 
         Resource* geom = resman_.GetResource(object_name);
         if (!geom) {
@@ -69,42 +140,20 @@ namespace game {
             throw(GameException(std::string("Could not find resource \"") + material_name + std::string("\"")));
         }
 
-        Ball* ball = new Ball(entity_name, geom, mat);
+        Ball* ball = ball_pool_.Get(ball_pool_.Create(entity_name, geom, mat));
         scene_.AddNode(ball);
         balls_.push_back(ball);
 
-        // Explicit base radius matching the sphere mesh (CreateColoredSphere used radius = 1.0f)
+        // Explicit base radius matching the sphere mesh (created with radius = 1.0f)
         ball->SetBaseRadius(1.0f);
 
+        // The shader colors the shared mesh
+        ball->SetBaseColor(color);
+        ball->SetColorMode(mode);
+
         // Set a color hint on the ball so other systems can query a representative color.
-        // We map known mesh name substrings to the colors used when creating colored spheres.
-        glm::vec3 hintColor(1.0f, 1.0f, 1.0f);
-        bool haveHint = true;
-        if (object_name.find("Yellow") != std::string::npos) {
-            hintColor = glm::vec3(1.0f, 1.0f, 0.0f);
-        } else if (object_name.find("Blue") != std::string::npos) {
-            hintColor = glm::vec3(0.0f, 0.0f, 1.0f);
-        } else if (object_name.find("RedA") != std::string::npos) {
-            hintColor = glm::vec3(1.0f, 0.0f, 0.0f);
-        } else if (object_name.find("RedB") != std::string::npos) {
-            hintColor = glm::vec3(0.6f, 0.0f, 0.0f);
-        } else if (object_name.find("Purple") != std::string::npos) {
-            hintColor = glm::vec3(0.5f, 0.0f, 0.5f);
-        } else if (object_name.find("Orange") != std::string::npos) {
-            hintColor = glm::vec3(1.0f, 0.5f, 0.0f);
-        } else if (object_name.find("Green") != std::string::npos) {
-            hintColor = glm::vec3(0.0f, 1.0f, 0.0f);
-        } else if (object_name.find("Black") != std::string::npos) {
-            hintColor = glm::vec3(0.0f, 0.0f, 0.0f);
-        } else if (object_name.find("White") != std::string::npos) {
-            hintColor = glm::vec3(1.0f, 1.0f, 1.0f);
-        } else {
-            haveHint = false;
-        }
-        if (haveHint) {
-            // SceneNode::SetColorHint is inherited by Ball
-            ball->SetColorHint(hintColor);
-        }
+        // SceneNode::SetColorHint is inherited by Ball
+        ball->SetColorHint(color);
 
         return ball;
     }
@@ -149,6 +198,33 @@ namespace game {
     }
 
 
+    void Game::InitHeadless(int width, int height) {
+
+        // GLFW only provides the timer here: its null platform needs no display
+#ifdef GLFW_PLATFORM_NULL
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
+        if (!glfwInit()) {
+            throw(GameException(std::string("Could not initialize the GLFW library")));
+        }
+
+        offscreen_context_.Create();
+
+        // glewInit queries the window system (GLX); load the entry points of the current context only
+        glewExperimental = GL_TRUE;
+        GLenum err = glewContextInit();
+        if (err != GLEW_OK) {
+            throw(GameException(std::string("Could not initialize the GLEW library: ") + std::string((const char*)glewGetErrorString(err))));
+        }
+
+        offscreen_target_.Create(width, height);
+        InitView();
+
+        // Set variables
+        animating_ = true;
+    }
+
+
     void Game::InitView(void) {
 
         glEnable(GL_DEPTH_TEST);
@@ -160,8 +236,16 @@ namespace game {
         // glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
         int width, height;
-        glfwGetFramebufferSize(window_, &width, &height);
+        if (window_) {
+            glfwGetFramebufferSize(window_, &width, &height);
+        }
+        else {
+            width = offscreen_target_.GetWidth();
+            height = offscreen_target_.GetHeight();
+        }
         glViewport(0, 0, width, height);
+        framebuffer_width_ = width;
+        framebuffer_height_ = height;
 
         camera_.SetView(camera_position_g, camera_look_at_g, camera_up_g);
         camera_.SetProjection(camera_fov_g, camera_near_clip_distance_g, camera_far_clip_distance_g, width, height);
@@ -173,44 +257,43 @@ namespace game {
         glfwSetWindowUserPointer(window_, (void*)this);
         glfwSetKeyCallback(window_, KeyCallback);
         glfwSetFramebufferSizeCallback(window_, ResizeCallback);
+        glfwSetWindowRefreshCallback(window_, RefreshCallback);
     }
 
 
     void Game::SetupResources(void) {
 
-        // Base sphere geometry is still useful but we'll create color-specific sphere meshes
-        // Create colored sphere meshes for cue and other balls
+        // Resources are built on worker threads and uploaded by the main loop; until then
+        // nodes draw a coarser level that is ready, or nothing.
+        // One sphere mesh (with its levels of detail) shared by the balls and the pocket guides;
+        // each node sets its color and stripe mode as material parameters.
         // Ball radius in game instances will be controlled by SetScale on the node (we use scale 10.0f in SetupScene)
-        resman_.CreateColoredSphere("Sphere_White", glm::vec3(1.0f, 1.0f, 1.0f), false, 1.0f, 24, 24);
-        resman_.CreateColoredSphere("Sphere_Black", glm::vec3(0.0f, 0.0f, 0.0f), false, 1.0f, 24, 24);
-
-        // Solid colored balls
-        resman_.CreateColoredSphere("Sphere_Yellow", glm::vec3(1.0f, 1.0f, 0.0f), false, 1.0f, 24, 24);
-        resman_.CreateColoredSphere("Sphere_Blue", glm::vec3(0.0f, 0.0f, 1.0f), false, 1.0f, 24, 24);
-        resman_.CreateColoredSphere("Sphere_RedA", glm::vec3(1.0f, 0.0f, 0.0f), false, 1.0f, 24, 24);
-        resman_.CreateColoredSphere("Sphere_Purple", glm::vec3(0.5f, 0.0f, 0.5f), false, 1.0f, 24, 24);
-        resman_.CreateColoredSphere("Sphere_Orange", glm::vec3(1.0f, 0.5f, 0.0f), false, 1.0f, 24, 24);
-        resman_.CreateColoredSphere("Sphere_Green", glm::vec3(0.0f, 1.0f, 0.0f), false, 1.0f, 24, 24);
-        resman_.CreateColoredSphere("Sphere_RedB", glm::vec3(0.6f, 0.0f, 0.0f), false, 1.0f, 24, 24);
-
-        // Gradient (stripe-like) versions: same colors, interpolated toward white
-        resman_.CreateColoredSphere("Sphere_Yellow_Stripe", glm::vec3(1.0f, 1.0f, 0.0f), true, 1.0f, 24, 24);
-        resman_.CreateColoredSphere("Sphere_Blue_Stripe", glm::vec3(0.0f, 0.0f, 1.0f), true, 1.0f, 24, 24);
-        resman_.CreateColoredSphere("Sphere_RedA_Stripe", glm::vec3(1.0f, 0.0f, 0.0f), true, 1.0f, 24, 24);
-        resman_.CreateColoredSphere("Sphere_Purple_Stripe", glm::vec3(0.5f, 0.0f, 0.5f), true, 1.0f, 24, 24);
-        resman_.CreateColoredSphere("Sphere_Orange_Stripe", glm::vec3(1.0f, 0.5f, 0.0f), true, 1.0f, 24, 24);
-        resman_.CreateColoredSphere("Sphere_Green_Stripe", glm::vec3(0.0f, 1.0f, 0.0f), true, 1.0f, 24, 24);
-        // duplicate red stripe
-        resman_.CreateColoredSphere("Sphere_RedB_Stripe", glm::vec3(0.6f, 0.0f, 0.0f), true, 1.0f, 24, 24);
-
-        // Create pocket guide sphere geometry (darker grey)
-        // We'll create a unit sphere (radius = 1.0) and scale instances to the world pocket radius in SetupScene.
-        resman_.CreateColoredSphere("Pocket_Sphere", glm::vec3(0.3f, 0.3f, 0.3f), false, 1.0f, 16, 16);
+        // Shaders and pre-generated meshes are read from the asset pack when one is found;
+        // without it they are loaded from the source directory and generated
+        for (const char *pack_file : pack_file_g) {
+            try {
+                resman_.OpenPack(pack_file);
+                std::cout << "Asset pack " << pack_file << std::endl;
+                break;
+            }
+            catch (std::ios_base::failure &) {
+            }
+        }
+        resman_.CreateColoredSphere("Sphere", glm::vec3(1.0f, 1.0f, 1.0f), false, 1.0f, 24, 24);
+
+        // Linked shader programs are cached in the build directory; warm starts skip compiling
+        resman_.SetProgramCacheDirectory(PROGRAM_CACHE_DIRECTORY);
 
         // Create a torus geometry resource is no longer needed here (was moved previously).
-        // Load basic material (reused). NOTE: CreateColoredSphere baked vertex colors, so single material is fine.
+        // Load basic material (reused by every node)
         std::string filename = std::string(MATERIAL_DIRECTORY) + std::string("/material");
-        resman_.LoadResource(Material, "ObjectMaterial", filename.c_str());
+        // Solid and gradient colors are shader variants picked per node
+        resman_.LoadResource(Material, "ObjectMaterial", filename.c_str(), SolidColorFeature | GradientColorFeature);
+
+        // Ray-cast sphere impostors (toggle with V)
+        filename = std::string(MATERIAL_DIRECTORY) + std::string("/impostor");
+        resman_.LoadResource(Material, "ImpostorMaterial", filename.c_str());
+        resman_.SetMemoryBudget(resource_memory_budget_g);
 
         // Create tracer box (unit depth = 1.0). We'll scale per-instance to desired length/thickness.
         resman_.CreateBox("Tracer", 0.05f, 0.05f, 1.0f); // thin tall box aligned along +Z
@@ -220,48 +303,103 @@ namespace game {
     void Game::MainLoop(void) {
 
         double last_frame = glfwGetTime();
+        tick_time_ = last_frame;
+        bool first_frame = true;
+        bool loading = resman_.IsLoading();
+        // With the render thread the first upload only runs at the first handover: until
+        // then the resources requested by Init are all pending
+        pending_uploads_ = resman_.GetPendingCount();
+        Profiler::SetThreadName("Main");
+
+        // The render thread takes over the context: it submits each frame and presents it
+        // while this thread builds the next one. Resources are uploaded there while this
+        // thread waits for the handover, as the scene reads them when building a frame
+        const RenderPacket* previous_packet = nullptr;
+        if (threaded_rendering_) {
+            render_thread_.Start(window_,
+                [this]() { UploadResources(); },
+                [this](RenderPacket* packet) { scene_.SubmitPacket(packet); glfwSwapBuffers(window_); });
+        }
+
         while (!glfwWindowShouldClose(window_)) {
+            PROFILE_ZONE("Frame");
             double current_time = glfwGetTime();
+
+            // Finish a few resources built in the background (and material variants on first use)
+            if (!render_thread_.IsRunning()) {
+                UploadResources();
+            }
+            if (pending_uploads_ == 0 && loading) {
+                std::cout << "Resources ready after " << (int) (glfwGetTime() * 1000.0) << " ms" << std::endl;
+                loading = false;
+            }
+
+            // Idle: the last frame is still on screen and nothing would change it, so wait
+            // for an event (or the next slow update) instead of redrawing. A frame that wakes
+            // up is drawn right away; the time spent waiting is neither simulated nor counted
+            // as a frame
+            if (IsIdle() && pending_uploads_ == 0) {
+                {
+                    PROFILE_ZONE("Idle");
+                    double slow_wait = scheduler_.GetSlowDeadline() - current_time;
+                    glfwWaitEventsTimeout(std::max(0.0, std::min(idle_wait_timeout_g, slow_wait)));
+                }
+                current_time = glfwGetTime();
+                last_frame = current_time;
+                // Keys received while waiting belong to the first tick after it
+                tick_time_ = current_time - physics_accumulator_;
+                Profiler::RestartFrame();
+                if (IsIdle()) {
+                    // Only slow updates can be due: they run without a frame (and ask for
+                    // one if they change what is drawn)
+                    scheduler_.RunFrame(current_time);
+                    continue;
+                }
+            }
             float dt = (float)(current_time - last_frame);
             if (dt <= 0.0f) dt = 0.0001f;
             last_frame = current_time;
 
-            // Handle continuous input (camera movement, free-camera controls)
-            ProcessContinuousInput(dt);
-
-            // Fixed-step physics updates
+            // Fixed-step physics updates (each tick applies the input received during it)
             physics_accumulator_ += dt;
+            int substeps = 0;
             while (physics_accumulator_ >= physics_dt_) {
-                UpdatePhysicsStep(physics_dt_);
+                scheduler_.RunTick(physics_dt_);
                 physics_accumulator_ -= physics_dt_;
+                substeps++;
             }
+            physics_stats_.EndFrame(substeps);
 
-            // Update scene at a lower rate if animating_ (keeps existing behaviour for other node updates)
+            // Updates signaled by the ticks (the tracer) and the slow updates that fell due
             if (animating_) {
-                static double last_time = 0;
-                double current_time_anim = glfwGetTime();
-                if ((current_time_anim - last_time) > 0.05) {
-                    scene_.Update();
-                    last_time = current_time_anim;
-                }
+                scheduler_.RunFrame(current_time);
             }
 
-            // If in first-person mode, position camera at white ball
-            if (first_person_ && white_ball_) {
-                // camera follows white ball only in first-person mode
-                glm::vec3 wbpos = white_ball_->GetPosition();
-                camera_.SetPosition(wbpos);
-                // keep camera orientation as-is (so player aims by rotating camera)
+            // Draw the scene (with the render thread: hand the frame over, to be submitted
+            // while the next one is built), seen from the camera latched just now
+            Camera view = LatchCamera(glfwGetTime());
+            RenderPacket* packet = scene_.BuildPacket(&view);
+            packet->viewport_width = framebuffer_width_;
+            packet->viewport_height = framebuffer_height_;
+            if (render_thread_.IsRunning()) {
+                PROFILE_ZONE("Handover");
+                render_thread_.Submit(packet);
+            }
+            else {
+                scene_.SubmitPacket(packet);
+            }
+            redraw_ = false;
+            if (first_frame) {
+                std::cout << "First frame after " << (int) (glfwGetTime() * 1000.0) << " ms" << std::endl;
+                first_frame = false;
             }
 
-            // Update tracer (visual aiming helper)
-            UpdateTracer();
-
-            // Draw the scene
-            scene_.Draw(&camera_);
+            // The render thread is done with the packet of the previous frame (StatsUpdate reads it)
+            stats_packet_ = previous_packet;
+            previous_packet = packet;
 
-            // Debug-forward draw for tracer (only colored tracer now)
-            if (tracer_node_ && tracer_node_->IsVisible() && tracer_debug_draw_) {
+            // Debug-forward draw for tracer (only colored tracer now; needs the context on this thread)
+            if (tracer_node_ && tracer_node_->IsVisible() && tracer_debug_draw_ && !render_thread_.IsRunning()) {
                 // Save original transform so we can restore it after the debug draw
                 glm::vec3 origPos = tracer_node_->GetPosition();
                 glm::quat origOri = tracer_node_->GetOrientation();
@@ -314,36 +452,174 @@ namespace game {
                 tracer_node_->SetScale(origScale);
             }
 
-            glfwSwapBuffers(window_);
-            glfwPollEvents();
+            if (!render_thread_.IsRunning()) {
+                PROFILE_ZONE("Swap");
+                glfwSwapBuffers(window_);
+            }
+            {
+                PROFILE_ZONE("Events");
+                glfwPollEvents();
+            }
+            Profiler::EndFrame();
+        }
+
+        // The last frame is presented; the context returns to this thread
+        render_thread_.Stop();
+
+        if (!record_filename_.empty()) {
+            try {
+                input_log_.SetSeed(seed_);
+                input_log_.Save(record_filename_);
+                std::cout << input_log_.GetSize() << " input events written to " << record_filename_ << std::endl;
+            }
+            catch (std::exception& e) {
+                std::cerr << e.what() << std::endl;
+            }
         }
     }
 
 
-    void Game::CreateBallField(int num_balls) {
+    void Game::UploadResources(void) {
 
-        // Prepare the ordered list of mesh names to create exactly 15 balls matching your specification:
-        // 1 black solid + 7 solids (yellow, blue, red, purple, orange, green, red) + 7 gradient-to-white variants
-        std::vector<std::string> meshNames;
-        meshNames.push_back("Sphere_Black");
-        meshNames.push_back("Sphere_Yellow");
-        meshNames.push_back("Sphere_Blue");
-        meshNames.push_back("Sphere_RedA");
-        meshNames.push_back("Sphere_Purple");
-        meshNames.push_back("Sphere_Orange");
-        meshNames.push_back("Sphere_Green");
-        meshNames.push_back("Sphere_RedB");
-        // gradient counterparts (same order except black has no stripe)
-        meshNames.push_back("Sphere_Yellow_Stripe");
-        meshNames.push_back("Sphere_Blue_Stripe");
-        meshNames.push_back("Sphere_RedA_Stripe");
-        meshNames.push_back("Sphere_Purple_Stripe");
-        meshNames.push_back("Sphere_Orange_Stripe");
-        meshNames.push_back("Sphere_Green_Stripe");
-        meshNames.push_back("Sphere_RedB_Stripe");
+        PROFILE_ZONE("Uploads");
+        pending_uploads_ = resman_.ProcessUploads(upload_budget_g);
+    }
+
+
+    void Game::SetThreadedRendering(bool threaded) {
+
+        threaded_rendering_ = threaded;
+    }
+
+
+    void Game::RecordInput(const std::string& filename) {
+
+        record_filename_ = filename;
+    }
+
+
+    void Game::ReplayInput(const std::string& filename) {
+
+        input_log_.Load(filename);
+        replaying_ = input_log_.GetSize() > 0;
+        replay_next_ = 0;
+        // Respawns draw the same positions as in the recorded session
+        seed_ = input_log_.GetSeed();
+        rng_.seed(seed_);
+    }
+
+
+    // Print mean, median, 95th percentile and maximum of frame times (seconds) in ms
+    static void PrintFrameTimes(const char* label, std::vector<double> times) {
+
+        if (times.empty()) {
+            std::cout << label << ": not available" << std::endl;
+            return;
+        }
+        double sum = 0.0;
+        for (double t : times) {
+            sum += t;
+        }
+        std::sort(times.begin(), times.end());
+        size_t p95 = std::min(times.size() - 1, (size_t)(0.95 * times.size()));
+        std::cout << label << " (ms): mean " << 1000.0 * sum / times.size()
+                  << ", median " << 1000.0 * times[times.size() / 2]
+                  << ", p95 " << 1000.0 * times[p95]
+                  << ", max " << 1000.0 * times.back() << std::endl;
+    }
+
+
+    // Print the physics counters (averaged per step) and the step duration histogram
+    static void PrintPhysicsStats(const PhysicsSnapshot& stats) {
+
+        if (stats.steps == 0) {
+            return;
+        }
+        double steps = (double)stats.steps;
+        const PhysicsCounters& total = stats.total;
+        std::cout << "Physics (per step): active " << total.active_balls / steps
+                  << ", sleeping " << total.sleeping_balls / steps
+                  << ", pairs " << total.broadphase_pairs / steps
+                  << ", tests " << total.narrowphase_tests / steps
+                  << ", contacts " << total.contacts_resolved / steps
+                  << ", wall hits " << total.wall_hits / steps
+                  << ", pocket tests " << total.pocket_tests / steps
+                  << ", respawn attempts " << total.respawn_attempts / steps << std::endl;
+        std::cout << "Physics step (us): mean " << 1e6 * stats.window_mean << ", max " << 1e6 * stats.window_max << std::endl;
+        for (int bin = 0; bin < physics_histogram_bins_g; ++bin) {
+            if (stats.histogram[bin] > 0) {
+                std::cout << "  >= " << 1e6 * PhysicsStats::GetBinStart(bin) << " us: " << stats.histogram[bin] << std::endl;
+            }
+        }
+    }
+
+
+    const PhysicsStats& Game::GetPhysicsStats(void) const {
+
+        return physics_stats_;
+    }
+
+
+    void Game::RunBenchmark(int frames, const std::string& dump_directory) {
+
+        // Warm-up frame: drawing requests the material variants, which are built before
+        // timing starts so that all frames draw the same. Its GPU time is dropped (some
+        // drivers report garbage for the first timer query)
+        GpuTimer gpu_timer;
+        std::vector<double> cpu_time, gpu_time;
+        resman_.FinishLoading();
+        gpu_timer.Begin();
+        scene_.Draw(&camera_);
+        gpu_timer.End();
+        resman_.ProcessUploads(0.0);
+        resman_.FinishLoading();
+        glFinish();
+        gpu_timer.Collect(gpu_time, true);
+        gpu_time.clear();
+
+        std::vector<unsigned char> pixels;
+        for (int frame = 0; frame < frames; ++frame) {
+            // CPU submit time: the work of a frame of MainLoop, with a fixed time step
+            double start = glfwGetTime();
+            scheduler_.RunTick(physics_dt_);
+
+            // Scripted camera: one orbit around the playing field over the run (set after
+            // the tick, which moves a first-person camera to the white ball)
+            float angle = 2.0f * glm::pi<float>() * frame / frames;
+            glm::vec3 eye(benchmark_orbit_radius_g * sin(angle), benchmark_orbit_height_g, benchmark_orbit_radius_g * cos(angle));
+            camera_.SetView(eye, camera_look_at_g, camera_up_g);
+            physics_stats_.EndFrame(1);
+            scheduler_.RunFrame(start);
+            gpu_timer.Begin();
+            scene_.Draw(&camera_);
+            gpu_timer.End();
+            cpu_time.push_back(glfwGetTime() - start);
+            gpu_timer.Collect(gpu_time, false);
+
+            if (!dump_directory.empty()) {
+                char filename[32];
+                snprintf(filename, sizeof(filename), "/frame_%04d.ppm", frame);
+                offscreen_target_.ReadPixels(pixels);
+                WritePPM(dump_directory + filename, offscreen_target_.GetWidth(), offscreen_target_.GetHeight(), pixels);
+            }
+        }
+        glFinish();
+        gpu_timer.Collect(gpu_time, true);
+
+        std::cout << frames << " frames at " << offscreen_target_.GetWidth() << "x" << offscreen_target_.GetHeight()
+                  << ", " << glGetString(GL_RENDERER) << std::endl;
+        PrintFrameTimes("CPU submit", cpu_time);
+        PrintFrameTimes("GPU", gpu_time);
+        PhysicsSnapshot physics;
+        physics_stats_.GetSnapshot(physics);
+        PrintPhysicsStats(physics);
+    }
+
+
+    void Game::CreateBallField(int num_balls) {
 
         // limit to requested number if necessary
-        int createCount = std::min(num_balls, (int)meshNames.size());
+        int createCount = std::min(num_balls, (int)(sizeof(ball_styles_g) / sizeof(ball_styles_g[0])));
 
         float cluster_radius = 60.0f;
         for (int i = 0; i < createCount; ++i) {
@@ -351,12 +627,9 @@ namespace game {
             ss << i;
             std::string name = "BallInstance" + ss.str();
 
-            // Pick the mesh name for this ball
-            std::string meshName = meshNames[i];
-
-            // Create ball instance using the color-specific mesh
-            // CreateBallInstance expects object_name and material name; object_name must be a Mesh resource
-            Ball* b = CreateBallInstance(name, meshName, "ObjectMaterial");
+            // Create ball instance on the shared sphere with the colors of its type
+            const BallStyle& style = ball_styles_g[i];
+            Ball* b = CreateBallInstance(name, "Sphere", "ObjectMaterial", style.color, style.stripe ? GradientColor : SolidColor);
 
             // Place roughly in a spherical cluster
             float theta = 2.0f * glm::pi<float>() * ((float)rand() / RAND_MAX);
@@ -371,8 +644,61 @@ namespace game {
     }
 
 
+    void Game::PhysicsTick(void* game, float dt) {
+
+        Game* g = static_cast<Game*>(game);
+        g->ProcessTickInput(dt);
+        g->UpdatePhysicsStep(dt);
+
+        // In first-person mode the camera follows the white ball (keeping its orientation,
+        // so the player aims by rotating the camera)
+        if (g->first_person_ && g->white_ball_) {
+            g->camera_.SetPosition(g->white_ball_->GetPosition());
+        }
+        g->scheduler_.Signal(g->tracer_update_);
+    }
+
+
+    void Game::TracerUpdate(void* game, float /* dt */) {
+
+        PROFILE_ZONE("Tracer");
+        static_cast<Game*>(game)->UpdateTracer();
+    }
+
+
+    void Game::StatsUpdate(void* game, float dt) {
+
+        Game* g = static_cast<Game*>(game);
+        g->stats_elapsed_ += dt;
+        if (g->stats_elapsed_ < 1.0 || !g->stats_packet_) {
+            return;
+        }
+        g->stats_elapsed_ = 0.0;
+
+        const CullStats& cull = g->scene_.GetCullStats();
+        const RenderStats& render = g->render_thread_.IsRunning() ? g->stats_packet_->queue.GetStats() : g->scene_.GetRenderStats();
+        std::stringstream title;
+        title << window_title_g << " - drawn " << cull.drawn << ", culled " << cull.culled
+              << ", draw calls " << render.draws << ", indices " << render.indices
+              << ", programs " << render.program_binds << ", buffers " << render.buffer_binds
+              << ", GPU memory " << g->resman_.GetMemoryUsage() / 1024 << " KB"
+              << ", evicted " << g->resman_.GetEvictions();
+#ifndef PROFILER_DISABLED
+        title << ", frame p50/p95/p99 " << std::fixed << std::setprecision(1)
+              << 1000.0 * Profiler::GetFrameTimePercentile(50.0) << "/"
+              << 1000.0 * Profiler::GetFrameTimePercentile(95.0) << "/"
+              << 1000.0 * Profiler::GetFrameTimePercentile(99.0) << " ms";
+#endif
+        glfwSetWindowTitle(g->window_, title.str().c_str());
+    }
+
+
     void Game::UpdatePhysicsStep(float dt) {
 
+        PROFILE_ZONE("Game::UpdatePhysicsStep");
+        physics_stats_.BeginStep();
+        PhysicsCounters& counters = physics_stats_.GetCounters();
+
         // Utility lambdas
         auto apply_deceleration = [this](glm::vec3& v, float dt) {
             float speed = glm::length(v);
@@ -402,10 +728,12 @@ namespace game {
                 if (pos[axis] - radius < -world_half_extent_) {
                     pos[axis] = -world_half_extent_ + radius;
                     vel[axis] = -vel[axis];
+                    counters.wall_hits++;
                 }
                 else if (pos[axis] + radius > world_half_extent_) {
                     pos[axis] = world_half_extent_ - radius;
                     vel[axis] = -vel[axis];
+                    counters.wall_hits++;
                 }
             }
             b->SetPosition(pos);
@@ -438,17 +766,20 @@ namespace game {
 
         // Determine whether any balls are still moving above the stop threshold and update physics_active_
         {
-            bool anyMoving = false;
             const float eps = physics_stop_threshold_;
             for (Ball* b : balls_) {
                 if (!b || b->IsPocketed()) continue;
                 if (glm::length(b->GetVelocity()) > eps) {
-                    anyMoving = true;
-                    break;
+                    counters.active_balls++;
+                }
+                else {
+                    counters.sleeping_balls++;
                 }
             }
-            physics_active_ = anyMoving;
+            physics_active_ = counters.active_balls > 0;
         }
+
+        physics_stats_.EndStep();
     }
 
 
@@ -461,7 +792,9 @@ namespace game {
         // NOTE: pocket spheres are scaled 3x larger than the computed pocket radius in SetupScene
         float pocket_sphere_world = white_ball_world_radius * pocket_radius_multiplier_ * 3.0f; // matches SetupScene scale
 
+        PhysicsCounters& counters = physics_stats_.GetCounters();
         for (const auto& p : pockets_) {
+            counters.pocket_tests++;
             float d = glm::length(pos - p);
             if (d <= (pocket_sphere_world + radius)) {
                 // collided with pocket guide sphere => remove from world
@@ -490,12 +823,13 @@ namespace game {
         float spawnLimit = world_half_extent_ - white_r - 1.0f;
         if (spawnLimit < 1.0f) spawnLimit = world_half_extent_; // fallback
 
-        static thread_local std::mt19937 rng((unsigned)std::time(nullptr));
         std::uniform_real_distribution<float> dist(-spawnLimit, spawnLimit);
 
         bool placed = false;
+        PhysicsCounters& counters = physics_stats_.GetCounters();
         for (int attempt = 0; attempt < maxAttempts; ++attempt) {
-            glm::vec3 candidate(dist(rng), dist(rng), dist(rng));
+            counters.respawn_attempts++;
+            glm::vec3 candidate(dist(rng_), dist(rng_), dist(rng_));
 
             // avoid pockets
             bool bad = false;
@@ -539,6 +873,8 @@ namespace game {
 
 
     void Game::HandleBallBallCollisions() {
+        PROFILE_ZONE("Game::HandleBallBallCollisions");
+        PhysicsCounters& counters = physics_stats_.GetCounters();
         for (size_t i = 0; i < balls_.size(); ++i) {
             Ball* A = balls_[i];
             if (!A || A->IsPocketed()) continue;
@@ -549,13 +885,19 @@ namespace game {
                 glm::vec3 pA = A->GetPosition();
                 glm::vec3 pB = B->GetPosition();
                 glm::vec3 d = pA - pB;
-                float dist = glm::length(d);
                 float rA = A->GetBaseRadius() * A->GetScale().x;
                 float rB = B->GetBaseRadius() * B->GetScale().x;
                 float minDist = rA + rB;
+
+                // Bounding boxes first: balls apart on any axis cannot touch
+                counters.broadphase_pairs++;
+                if (fabs(d.x) >= minDist || fabs(d.y) >= minDist || fabs(d.z) >= minDist) continue;
+                counters.narrowphase_tests++;
+                float dist = glm::length(d);
                 if (dist <= 0.0f) continue;
 
                 if (dist < minDist) {
+                    counters.contacts_resolved++;
                     // push apart to avoid sticking
                     glm::vec3 n = d / dist;
                     float penetration = minDist - dist;
@@ -583,6 +925,7 @@ namespace game {
 
 
     bool Game::ComputeTracerTarget(Ball*& outTarget, glm::vec3& outContact, glm::vec3& outResultantDir, float& outPredictedVelLen) {
+        PROFILE_ZONE("Game::ComputeTracerTarget");
         outTarget = nullptr;
         outPredictedVelLen = 0.0f;
 
@@ -809,12 +1152,71 @@ namespace game {
     }
 
 
-    void Game::ProcessContinuousInput(float dt) {
+    void Game::ProcessTickInput(float dt) {
+
+        PROFILE_ZONE("Game::ProcessTickInput");
+        tick_++;
+        tick_time_ += dt;
+
+        if (replaying_) {
+            // The events recorded at this tick (the keyboard is ignored until the log ends)
+            while (replay_next_ < input_log_.GetSize() && input_log_.Get(replay_next_).tick <= tick_) {
+                const InputRecord& record = input_log_.Get(replay_next_++);
+                HandleKeyEvent(record.key, record.action);
+            }
+            if (replay_next_ == input_log_.GetSize()) {
+                std::cout << "Replay finished at tick " << tick_ << std::endl;
+                replaying_ = false;
+            }
+        }
+        else {
+            // The events received before the end of this tick
+            while (input_.GetSize() > 0 && input_.Peek(0).time <= tick_time_) {
+                InputEvent event = input_.Peek(0);
+                input_.Pop();
+                if (!record_filename_.empty()) {
+                    InputRecord record = { tick_, event.key, event.action, event.mods };
+                    input_log_.Add(record);
+                }
+                HandleKeyEvent(event.key, event.action);
+            }
+        }
+
+        ProcessContinuousInput(key_down_, camera_, dt);
+    }
+
+
+    Camera Game::LatchCamera(double time) const {
 
-        if (!window_) return;
+        // Replay the keys queued after the last tick, each for the time it was held
+        Camera camera = camera_;
+        bool key_down[GLFW_KEY_LAST + 1];
+        std::copy(key_down_, key_down_ + GLFW_KEY_LAST + 1, key_down);
+        double t = tick_time_;
+        for (unsigned i = 0; i < input_.GetSize(); ++i) {
+            const InputEvent& event = input_.Peek(i);
+            if (event.time > time) break;
+            if (event.time > t) {
+                ProcessContinuousInput(key_down, camera, (float)(event.time - t));
+                t = event.time;
+            }
+            key_down[event.key] = (event.action == GLFW_PRESS);
+        }
+        if (time > t) {
+            ProcessContinuousInput(key_down, camera, (float)(time - t));
+        }
+
+        if (first_person_ && white_ball_) {
+            camera.SetPosition(white_ball_->GetPosition());
+        }
+        return camera;
+    }
+
+
+    void Game::ProcessContinuousInput(const bool* key_down, Camera& camera, float dt) const {
 
         // If right Alt is held, temporarily increase rotation speed
-        bool alt_left = (glfwGetKey(window_, GLFW_KEY_LEFT_ALT) == GLFW_PRESS);
+        bool alt_left = key_down[GLFW_KEY_LEFT_ALT];
         float effective_rotate_speed_deg = camera_rotate_speed_deg_;
         if (alt_left) effective_rotate_speed_deg *= 5.0f;
 
@@ -822,53 +1224,53 @@ namespace game {
         if (!first_person_) {
             // Movement (WASD + up/down)
             glm::vec3 move(0.0f);
-            if (glfwGetKey(window_, GLFW_KEY_W) == GLFW_PRESS) move += camera_.GetForward();
-            if (glfwGetKey(window_, GLFW_KEY_S) == GLFW_PRESS) move -= camera_.GetForward();
-            if (glfwGetKey(window_, GLFW_KEY_A) == GLFW_PRESS) move -= camera_.GetSide();
-            if (glfwGetKey(window_, GLFW_KEY_D) == GLFW_PRESS) move += camera_.GetSide();
-            if (glfwGetKey(window_, GLFW_KEY_SPACE) == GLFW_PRESS) move += camera_.GetUp();
-            if (glfwGetKey(window_, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS) move -= camera_.GetUp();
+            if (key_down[GLFW_KEY_W]) move += camera.GetForward();
+            if (key_down[GLFW_KEY_S]) move -= camera.GetForward();
+            if (key_down[GLFW_KEY_A]) move -= camera.GetSide();
+            if (key_down[GLFW_KEY_D]) move += camera.GetSide();
+            if (key_down[GLFW_KEY_SPACE]) move += camera.GetUp();
+            if (key_down[GLFW_KEY_LEFT_SHIFT]) move -= camera.GetUp();
 
             if (glm::length(move) > 0.0f) {
                 move = glm::normalize(move) * camera_move_speed_ * dt;
-                camera_.Translate(move);
+                camera.Translate(move);
             }
 
             // Rotation J/L yaw left/right
-            bool j = (glfwGetKey(window_, GLFW_KEY_J) == GLFW_PRESS);
-            bool l = (glfwGetKey(window_, GLFW_KEY_L) == GLFW_PRESS);
-            if (j && !l) camera_.Yaw(glm::radians(effective_rotate_speed_deg * dt));
-            else if (l && !j) camera_.Yaw(glm::radians(-effective_rotate_speed_deg * dt));
+            bool j = key_down[GLFW_KEY_J];
+            bool l = key_down[GLFW_KEY_L];
+            if (j && !l) camera.Yaw(glm::radians(effective_rotate_speed_deg * dt));
+            else if (l && !j) camera.Yaw(glm::radians(-effective_rotate_speed_deg * dt));
 
             // Look up/down I/K
-            bool i = (glfwGetKey(window_, GLFW_KEY_I) == GLFW_PRESS);
-            bool k = (glfwGetKey(window_, GLFW_KEY_K) == GLFW_PRESS);
-            if (i && !k) camera_.Pitch(glm::radians(effective_rotate_speed_deg * dt));
-            else if (k && !i) camera_.Pitch(glm::radians(-effective_rotate_speed_deg * dt));
+            bool i = key_down[GLFW_KEY_I];
+            bool k = key_down[GLFW_KEY_K];
+            if (i && !k) camera.Pitch(glm::radians(effective_rotate_speed_deg * dt));
+            else if (k && !i) camera.Pitch(glm::radians(-effective_rotate_speed_deg * dt));
 
             // Roll Q/E (Q = left-roll, E = right-roll)
-            bool q = (glfwGetKey(window_, GLFW_KEY_Q) == GLFW_PRESS);
-            bool e = (glfwGetKey(window_, GLFW_KEY_E) == GLFW_PRESS);
-            if (q && !e) camera_.Roll(glm::radians(effective_rotate_speed_deg * dt));
-            else if (e && !q) camera_.Roll(glm::radians(-effective_rotate_speed_deg * dt));
+            bool q = key_down[GLFW_KEY_Q];
+            bool e = key_down[GLFW_KEY_E];
+            if (q && !e) camera.Roll(glm::radians(effective_rotate_speed_deg * dt));
+            else if (e && !q) camera.Roll(glm::radians(-effective_rotate_speed_deg * dt));
         }
         else {
             // In first-person attached to white ball, allow yaw via J/L and look up/down via I/K (player aiming)
-            bool j = (glfwGetKey(window_, GLFW_KEY_J) == GLFW_PRESS);
-            bool l = (glfwGetKey(window_, GLFW_KEY_L) == GLFW_PRESS);
-            if (j && !l) camera_.Yaw(glm::radians(effective_rotate_speed_deg * dt));
-            else if (l && !j) camera_.Yaw(glm::radians(-effective_rotate_speed_deg * dt));
+            bool j = key_down[GLFW_KEY_J];
+            bool l = key_down[GLFW_KEY_L];
+            if (j && !l) camera.Yaw(glm::radians(effective_rotate_speed_deg * dt));
+            else if (l && !j) camera.Yaw(glm::radians(-effective_rotate_speed_deg * dt));
 
-            bool i = (glfwGetKey(window_, GLFW_KEY_I) == GLFW_PRESS);
-            bool k = (glfwGetKey(window_, GLFW_KEY_K) == GLFW_PRESS);
-            if (i && !k) camera_.Pitch(glm::radians(effective_rotate_speed_deg * dt));
-            else if (k && !i) camera_.Pitch(glm::radians(-effective_rotate_speed_deg * dt));
+            bool i = key_down[GLFW_KEY_I];
+            bool k = key_down[GLFW_KEY_K];
+            if (i && !k) camera.Pitch(glm::radians(effective_rotate_speed_deg * dt));
+            else if (k && !i) camera.Pitch(glm::radians(-effective_rotate_speed_deg * dt));
 
             // Roll Q/E in first-person as well (keeps controls consistent)
-            bool q = (glfwGetKey(window_, GLFW_KEY_Q) == GLFW_PRESS);
-            bool e = (glfwGetKey(window_, GLFW_KEY_E) == GLFW_PRESS);
-            if (q && !e) camera_.Roll(glm::radians(effective_rotate_speed_deg * dt));
-            else if (e && !q) camera_.Roll(glm::radians(-effective_rotate_speed_deg * dt));
+            bool q = key_down[GLFW_KEY_Q];
+            bool e = key_down[GLFW_KEY_E];
+            if (q && !e) camera.Roll(glm::radians(effective_rotate_speed_deg * dt));
+            else if (e && !q) camera.Roll(glm::radians(-effective_rotate_speed_deg * dt));
         }
     }
 
@@ -905,12 +1307,56 @@ namespace game {
         Game* game = (Game*)ptr;
         if (!game) return;
 
+        // Every key event may change the view; held keys keep the loop out of idle
+        if (action == GLFW_PRESS) {
+            game->keys_held_++;
+        }
+        else if (action == GLFW_RELEASE && game->keys_held_ > 0) {
+            game->keys_held_--;
+        }
+        game->redraw_ = true;
+
         // Quit game if 'Backspace' is pressed
         if (key == GLFW_KEY_BACKSPACE && action == GLFW_PRESS) {
             glfwSetWindowShouldClose(window, true);
             return;
         }
 
+        // Write the profiler's recent zones as a Chrome trace on 'F2'
+        if (key == GLFW_KEY_F2 && action == GLFW_PRESS) {
+            try {
+                Profiler::WriteChromeTrace(trace_filename_g);
+                std::cout << "Trace written to " << trace_filename_g << std::endl;
+            }
+            catch (std::exception& e) {
+                std::cerr << e.what() << std::endl;
+            }
+            return;
+        }
+
+        // Toggle impostor rendering of the balls and pocket guides on 'V' (single-press)
+        if (key == GLFW_KEY_V && action == GLFW_PRESS) {
+            game->scene_.SetImpostorMode(!game->scene_.IsImpostorMode());
+            return;
+        }
+
+        // Everything else is game input: queue it with its time, for the physics tick it falls
+        // in (while a log is replayed, the keyboard does not play)
+        if (action != GLFW_REPEAT && key >= 0 && key <= GLFW_KEY_LAST && !game->replaying_) {
+            InputEvent event = { glfwGetTime(), key, action, mods };
+            game->input_.Push(event);
+        }
+    }
+
+
+    void Game::HandleKeyEvent(int key, int action) {
+
+        // Keys of a replay log are not checked when it is read
+        if (key < 0 || key > GLFW_KEY_LAST) return;
+        if (action == GLFW_PRESS || action == GLFW_RELEASE) {
+            key_down_[key] = (action == GLFW_PRESS);
+        }
+
         // Helper: compute a stable horizontal forward (zero Y) from a candidate forward vector
         auto horizontal_forward = [](const glm::vec3& f) {
             glm::vec3 fh(f.x, 0.0f, f.z);
@@ -926,55 +1372,55 @@ namespace game {
         if (key == GLFW_KEY_C && action == GLFW_PRESS) {
 
             // If a shot is in progress (physics active), block toggling until balls stop
-            if (game->physics_active_) {
+            if (physics_active_) {
                 return;
             }
 
-            if (game->first_person_) {
+            if (first_person_) {
                 // leaving FIRST-PERSON -> enter THIRD-PERSON
-                game->stored_fp_pos_ = game->camera_.GetPosition();
-                game->stored_fp_ori_ = game->camera_.GetOrientation();
-                game->stored_fp_forward_ = game->camera_.GetForward();
-                game->has_stored_fp_ = true;
-                game->has_stored_fp_forward_ = true;
-
-                if (game->has_stored_third_) {
-                    game->camera_.SetPosition(game->stored_third_pos_);
-                    game->camera_.SetOrientation(game->stored_third_ori_);
+                stored_fp_pos_ = camera_.GetPosition();
+                stored_fp_ori_ = camera_.GetOrientation();
+                stored_fp_forward_ = camera_.GetForward();
+                has_stored_fp_ = true;
+                has_stored_fp_forward_ = true;
+
+                if (has_stored_third_) {
+                    camera_.SetPosition(stored_third_pos_);
+                    camera_.SetOrientation(stored_third_ori_);
                 }
-                else if (game->white_ball_) {
+                else if (white_ball_) {
                     // prefer stored FP forward to compute sensible behind-ball third-person placement
-                    glm::vec3 wbpos = game->white_ball_->GetPosition();
-                    glm::vec3 forward = game->has_stored_fp_forward_ ? game->stored_fp_forward_ : game->camera_.GetForward();
+                    glm::vec3 wbpos = white_ball_->GetPosition();
+                    glm::vec3 forward = has_stored_fp_forward_ ? stored_fp_forward_ : camera_.GetForward();
                     glm::vec3 fh = horizontal_forward(forward);
                     const float back_distance = 60.0f;
                     const float up_offset = 15.0f;
                     glm::vec3 new_cam_pos = wbpos - fh * back_distance + camera_up_g * up_offset;
                     // Look in the same horizontal direction as FP to avoid introducing unintended pitch.
-                    game->camera_.SetView(new_cam_pos, new_cam_pos + fh, camera_up_g);
+                    camera_.SetView(new_cam_pos, new_cam_pos + fh, camera_up_g);
                 }
 
-                game->stored_third_pos_ = game->camera_.GetPosition();
-                game->stored_third_ori_ = game->camera_.GetOrientation();
-                game->has_stored_third_ = true;
+                stored_third_pos_ = camera_.GetPosition();
+                stored_third_ori_ = camera_.GetOrientation();
+                has_stored_third_ = true;
 
-                game->first_person_ = false;
-                game->UpdateWhiteVisibility();
+                first_person_ = false;
+                UpdateWhiteVisibility();
             }
             else {
                 // leaving THIRD-PERSON -> enter FIRST-PERSON
-                game->stored_third_pos_ = game->camera_.GetPosition();
-                game->stored_third_ori_ = game->camera_.GetOrientation();
-                game->has_stored_third_ = true;
-
-                game->first_person_ = true;
-                if (game->white_ball_) {
-                    game->camera_.SetPosition(game->white_ball_->GetPosition());
-                    if (game->has_stored_fp_) {
-                        game->camera_.SetOrientation(game->stored_fp_ori_);
+                stored_third_pos_ = camera_.GetPosition();
+                stored_third_ori_ = camera_.GetOrientation();
+                has_stored_third_ = true;
+
+                first_person_ = true;
+                if (white_ball_) {
+                    camera_.SetPosition(white_ball_->GetPosition());
+                    if (has_stored_fp_) {
+                        camera_.SetOrientation(stored_fp_ori_);
                     }
                 }
-                game->UpdateWhiteVisibility();
+                UpdateWhiteVisibility();
             }
 
             return;
@@ -986,48 +1432,48 @@ namespace game {
             float power = static_cast<float>(p);
 
             // If shot originates from first-person, save the FP pose/orientation/forward
-            if (game->first_person_) {
-                game->stored_fp_pos_ = game->camera_.GetPosition();
-                game->stored_fp_ori_ = game->camera_.GetOrientation();
-                game->stored_fp_forward_ = game->camera_.GetForward();
-                game->has_stored_fp_ = true;
-                game->has_stored_fp_forward_ = true;
+            if (first_person_) {
+                stored_fp_pos_ = camera_.GetPosition();
+                stored_fp_ori_ = camera_.GetOrientation();
+                stored_fp_forward_ = camera_.GetForward();
+                has_stored_fp_ = true;
+                has_stored_fp_forward_ = true;
             }
 
             // Record intent to show after shot, but DO NOT make visible while still in first-person.
-            game->show_white_on_shot_ = true;
+            show_white_on_shot_ = true;
 
             // Determine shot direction: prefer stored FP forward if available (shot originated from FP),
             // otherwise use current camera forward.
             glm::vec3 shot_dir;
             const glm::vec3* shot_dir_ptr = nullptr;
-            if (game->has_stored_fp_forward_) {
-                shot_dir = game->stored_fp_forward_;
+            if (has_stored_fp_forward_) {
+                shot_dir = stored_fp_forward_;
                 shot_dir_ptr = &shot_dir;
             }
 
             // 1) Apply the shot first so white ball velocity is set (use override when available)
-            game->ShootWhiteBall(power, shot_dir_ptr);
+            ShootWhiteBall(power, shot_dir_ptr);
 
             // 2) Then switch to third-person camera if the shot originated in FP.
-            if (game->first_person_ && game->white_ball_) {
+            if (first_person_ && white_ball_) {
 
-                if (game->has_stored_third_) {
+                if (has_stored_third_) {
                     // restore the stored third-person pose
-                    game->camera_.SetPosition(game->stored_third_pos_);
-                    game->camera_.SetOrientation(game->stored_third_ori_);
+                    camera_.SetPosition(stored_third_pos_);
+                    camera_.SetOrientation(stored_third_ori_);
                 }
                 else {
                     // no stored third-person pose: compute default behind-ball placement using stored FP forward when possible
-                    glm::vec3 wbpos = game->white_ball_->GetPosition();
-                    glm::vec3 vel = game->white_ball_->GetVelocity();
+                    glm::vec3 wbpos = white_ball_->GetPosition();
+                    glm::vec3 vel = white_ball_->GetVelocity();
 
                     glm::vec3 forward;
                     if (glm::length(vel) > 1e-5f) {
                         forward = glm::normalize(vel);
                     }
                     else {
-                        forward = game->has_stored_fp_forward_ ? game->stored_fp_forward_ : game->camera_.GetForward();
+                        forward = has_stored_fp_forward_ ? stored_fp_forward_ : camera_.GetForward();
                     }
 
                     glm::vec3 fh = horizontal_forward(forward);
@@ -1035,19 +1481,19 @@ namespace game {
                     const float up_offset = 15.0f;
                     glm::vec3 new_cam_pos = wbpos - fh * back_distance + camera_up_g * up_offset;
                     // Look along the horizontal forward to avoid a downward pitch introduced by looking directly at the ball.
-                    game->camera_.SetView(new_cam_pos, new_cam_pos + fh, camera_up_g);
+                    camera_.SetView(new_cam_pos, new_cam_pos + fh, camera_up_g);
                 }
 
                 // Store current third-person pose so future toggles can restore it
-                game->stored_third_pos_ = game->camera_.GetPosition();
-                game->stored_third_ori_ = game->camera_.GetOrientation();
-                game->has_stored_third_ = true;
+                stored_third_pos_ = camera_.GetPosition();
+                stored_third_ori_ = camera_.GetOrientation();
+                has_stored_third_ = true;
 
                 // mark as third-person so MainLoop stops snapping camera to the white ball
-                game->first_person_ = false;
+                first_person_ = false;
 
                 // Update visibility (now in 3rd-person, white ball should be visible unless pocketed)
-                game->UpdateWhiteVisibility();
+                UpdateWhiteVisibility();
             }
 
             return;
@@ -1056,19 +1502,40 @@ namespace game {
 
 
     void Game::ResizeCallback(GLFWwindow* window, int width, int height) {
-        // Update GL viewport and forward the new size to the Game's camera projection
-        glViewport(0, 0, width, height);
+        // Forward the new size to the Game's camera projection; the next frame sets the
+        // viewport (on the thread that owns the context)
         void* ptr = glfwGetWindowUserPointer(window);
         Game* game = static_cast<Game*>(ptr);
         if (game) {
+            game->framebuffer_width_ = width;
+            game->framebuffer_height_ = height;
             game->camera_.SetProjection(camera_fov_g, camera_near_clip_distance_g, camera_far_clip_distance_g, width, height);
+            game->redraw_ = true;
+        }
+    }
+
+
+    void Game::RefreshCallback(GLFWwindow* window) {
+
+        // The window contents were damaged (e.g., uncovered) and must be drawn again
+        Game* game = static_cast<Game*>(glfwGetWindowUserPointer(window));
+        if (game) {
+            game->redraw_ = true;
         }
     }
 
 
+    bool Game::IsIdle(void) const {
+
+        return !redraw_ && !physics_active_ && keys_held_ == 0 && !scheduler_.NeedsFrame()
+            && input_.GetSize() == 0 && !replaying_;
+    }
+
+
     void Game::SetupScene(void) {
 
         scene_.SetBackgroundColor(viewport_background_color_g);
+        scene_.SetImpostorMaterial(resman_.GetResource("ImpostorMaterial"));
 
         // Create pocket positions (cube centered at origin; use world_half_extent_)
         pockets_.clear();
@@ -1094,12 +1561,12 @@ namespace game {
 
         // Create white ball (player)
         {
-            Resource* geom = resman_.GetResource("Sphere_White");
+            Resource* geom = resman_.GetResource("Sphere");
             Resource* mat = resman_.GetResource("ObjectMaterial");
             if (geom && mat) {
                 // Place the cue ball further back from the origin.
                 glm::vec3 cue_pos(-300.0f, 0.0f, 0.0f);
-                white_ball_ = CreateBallInstance("WhiteBall", "Sphere_White", "ObjectMaterial");
+                white_ball_ = CreateBallInstance("WhiteBall", "Sphere", "ObjectMaterial", white_ball_color_g, SolidColor);
                 white_ball_->SetPosition(cue_pos);
                 white_ball_->SetScale(glm::vec3(10.0f)); // ball radius = base * 10 units
                 white_ball_->SetVelocity(glm::vec3(0.0f));
@@ -1120,9 +1587,9 @@ namespace game {
             }
         }
 
-        // Create pocket guide spheres at each pocket (instances of the Pocket_Sphere mesh)
+        // Create pocket guide spheres at each pocket (instances of the shared sphere mesh)
         {
-            Resource* sphereGeom = resman_.GetResource("Pocket_Sphere");
+            Resource* sphereGeom = resman_.GetResource("Sphere");
             Resource* mat = resman_.GetResource("ObjectMaterial");
             if (sphereGeom && mat && white_ball_) {
                 // Compute world pocket guide scale from white ball size and configured pocket multiplier
@@ -1140,6 +1607,9 @@ namespace game {
                     sn->SetPosition(p);
                     // Uniform scale to make sphere radius ~ pocket_radius * 3
                     sn->SetScale(glm::vec3(scale_factor));
+                    // Darker grey
+                    sn->SetBaseColor(pocket_color_g);
+                    sn->SetColorMode(SolidColor);
                     // Ensure visible
                     sn->SetVisible(true);
                 }
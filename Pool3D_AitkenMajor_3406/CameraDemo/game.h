@@ -2,6 +2,7 @@
 #define GAME_H_
 
 #include <exception>
+#include <random>
 #include <string>
 #include <vector>
 #define GLEW_STATIC
@@ -12,6 +13,13 @@
 #include "resource_manager.h"
 #include "camera.h"
 #include "ball.h"
+#include "object_pool.h"
+#include "offscreen.h"
+#include "profiler.h"
+#include "physics_stats.h"
+#include "render_thread.h"
+#include "update_scheduler.h"
+#include "input_queue.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
@@ -37,23 +45,46 @@ namespace game {
         ~Game();
         // Call Init() before calling any other method
         void Init(void);
+        // Alternative to Init() for benchmarks: no window, render into a
+        // width x height framebuffer through an offscreen context
+        void InitHeadless(int width, int height);
         // Set up resources for the game
         void SetupResources(void);
         // Set up initial scene
         void SetupScene(void);
         // Run the game: keep the application active
         void MainLoop(void);
+        // Submit frames from a render thread in MainLoop, overlapped with building the
+        // next frame (on by default); off, everything runs on the calling thread
+        void SetThreadedRendering(bool threaded);
+        // Render 'frames' frames with a scripted camera (one orbit of the playing field) and
+        // print the CPU submit and GPU times. If 'dump_directory' is not empty, each
+        // frame is also written there as frame_NNNN.ppm (reading back stalls the GPU)
+        void RunBenchmark(int frames, const std::string &dump_directory);
+        // Counters and step durations of the physics (snapshots can be taken from any thread)
+        const PhysicsStats &GetPhysicsStats(void) const;
+        // Write the key events of MainLoop, with the physics tick of each, to 'filename'
+        // when it returns
+        void RecordInput(const std::string &filename);
+        // Play the key events of a recorded log in MainLoop instead of the keyboard's
+        // (throws std::ios_base::failure)
+        void ReplayInput(const std::string &filename);
 
     private:
         // GLFW window
         GLFWwindow* window_;
 
-        // Scene graph containing all nodes to render
-        SceneGraph scene_;
+        // Context and render target of the headless mode
+        OffscreenContext offscreen_context_;
+        OffscreenTarget offscreen_target_;
 
-        // Resources available to the game
+        // Resources available to the game (declared first: the nodes of the scene graph
+        // release their references when they are destroyed)
         ResourceManager resman_;
 
+        // Scene graph containing all nodes to render
+        SceneGraph scene_;
+
         // Camera abstraction
         Camera camera_;
 
@@ -90,6 +121,8 @@ namespace game {
 
         // All balls (including white_ball_ in the vector or stored separately)
         std::vector<Ball*> balls_;
+        // Storage of the balls (the scene graph only references them)
+        ObjectPool<Ball> ball_pool_;
 
         // Pocket positions and pocket radius multiplier
         std::vector<glm::vec3> pockets_;
@@ -103,6 +136,8 @@ namespace game {
         bool physics_active_;
         // Threshold (units/sec) under which velocities are considered stopped
         float physics_stop_threshold_;
+        // Work and duration of the physics steps
+        PhysicsStats physics_stats_;
 
         // World bounds (cube half-extent)
         float world_half_extent_;
@@ -115,16 +150,52 @@ namespace game {
         float camera_rotate_speed_deg_;
 
         // Helpers: create ball instances and fields
-        Ball* CreateBallInstance(std::string entity_name, std::string object_name, std::string material_name);
+        // color/mode: material parameters of the ball on the shared sphere mesh
+        Ball* CreateBallInstance(std::string entity_name, std::string object_name, std::string material_name, const glm::vec3& color, ColorMode mode);
         void CreateBallField(int num_balls = 15);
         // Update white-ball visibility according to current camera mode / pocketed state
         void UpdateWhiteVisibility(void);
 
         // Physics update step
         void UpdatePhysicsStep(float dt);
-
-        // Continuous input handling
-        void ProcessContinuousInput(float dt);
+        // Fixed-tick update of the scheduler: applies the input of the tick, then runs UpdatePhysicsStep
+        static void PhysicsTick(void* game, float dt);
+        // Event update of the scheduler, signaled by each tick (ticks move the camera and balls)
+        static void TracerUpdate(void* game, float dt);
+        UpdateId tracer_update_;
+        // Slow update of the scheduler: reports drawn/culled node counts and render stats in
+        // the window title once per second
+        static void StatsUpdate(void* game, float dt);
+        double stats_elapsed_; // Seconds since the title was refreshed
+        const RenderPacket* stats_packet_; // Packet of a drawn frame the render thread is done with (null: none yet)
+
+        // Updates of the systems and nodes, each at the rate it registered
+        UpdateScheduler scheduler_;
+
+        // Input: key events are queued with their time by KeyCallback and consumed by the
+        // physics tick they fall in, so shots and camera moves do not depend on the frame rate
+        InputQueue input_;
+        bool key_down_[GLFW_KEY_LAST + 1]; // Keys held, as of the last tick
+        uint64_t tick_; // Physics ticks run by MainLoop
+        double tick_time_; // Time up to which input was consumed (end of the last tick)
+        // Replay log being recorded or played
+        InputLog input_log_;
+        std::string record_filename_; // Empty: not recording
+        bool replaying_;
+        size_t replay_next_; // Next record to play
+        // Random numbers of the simulation (white ball respawns), seeded with seed_: the
+        // fixed default, or the seed of the log being replayed. It is written to a recorded log
+        unsigned seed_;
+        std::mt19937 rng_;
+        // Consume the events up to the end of the tick and move the camera with the held keys
+        void ProcessTickInput(float dt);
+        // Apply a key event of the game (shots, camera mode)
+        void HandleKeyEvent(int key, int action);
+        // Continuous input handling: move 'camera' for 'dt' seconds with the keys in 'key_down'
+        void ProcessContinuousInput(const bool* key_down, Camera& camera, float dt) const;
+        // Camera to draw from at 'time': the camera of the last tick, moved on with the keys
+        // queued since (late latching, so a frame shows the input received while it was built)
+        Camera LatchCamera(double time) const;
 
         // Apply shot impulse to white ball. If override_dir != nullptr, use that direction (world-space).
         void ShootWhiteBall(float power, const glm::vec3* override_dir = nullptr);
@@ -137,6 +208,22 @@ namespace game {
         // Methods to handle events (single-press)
         static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
         static void ResizeCallback(GLFWwindow* window, int width, int height);
+        static void RefreshCallback(GLFWwindow* window);
+
+        // Idle mode: MainLoop waits for events instead of drawing while nothing changes
+        bool redraw_; // Input, a resize or damage since the last frame
+        int keys_held_; // Keys pressed and not released
+        // True when the last frame is still up to date: no ball moves, no key is held
+        // and nothing asked for a redraw
+        bool IsIdle(void) const;
+
+        // Framebuffer size, applied by the next frame submitted
+        int framebuffer_width_;
+        int framebuffer_height_;
+        // Resources still to upload after the last UploadResources
+        int pending_uploads_;
+        // Upload built resources for a while (on the thread that owns the context)
+        void UploadResources(void);
 
         // Tracer scene node (single instance reused each frame)
         SceneNode* tracer_node_;
@@ -147,7 +234,7 @@ namespace game {
         // Debug: when true the code in MainLoop will force-draw the tracer in front of the camera.
         // Keep false for normal gameplay to avoid overdraw/hangs.
         bool tracer_debug_draw_;
-        // Update tracer each frame
+        // Aim the tracer from the camera and the balls (see TracerUpdate)
         void UpdateTracer();
 
         // Extracted helpers (new)
@@ -161,6 +248,10 @@ namespace game {
         bool ComputeTracerTarget(Ball*& outTarget, glm::vec3& outContact, glm::vec3& outResultantDir, float& outPredictedVelLen);
         void ConfigureTracerNode(const glm::vec3& contact, const glm::vec3& resultantDir, float length);
 
+        // Render thread of MainLoop (owns the context while it runs)
+        bool threaded_rendering_;
+        RenderThread render_thread_;
+
     }; // class Game
 
 } // namespace game
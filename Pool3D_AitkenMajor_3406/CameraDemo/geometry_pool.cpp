@@ -0,0 +1,156 @@
+#include <algorithm>
+
+#include "geometry_pool.h"
+
+namespace game {
+
+// Initial buffer sizes (bytes); buffers double when full
+const size_t pool_initial_vertex_bytes_g = 256 * 1024;
+const size_t pool_initial_index_bytes_g = 128 * 1024;
+
+GeometryPool::GeometryPool(GLsizei stride, RenderBackend *backend){
+
+    backend_ = backend;
+    stride_ = stride;
+    vertex_end_ = 0;
+    index_end_ = 0;
+    array_buffer_ = 0;
+    element_array_buffer_ = 0;
+    array_buffer_capacity_ = 0;
+    element_array_buffer_capacity_ = 0;
+}
+
+
+GeometryPool::~GeometryPool(){
+}
+
+
+void GeometryPool::Add(const void *vertex, GLsizei vertex_num, const GLushort *index, GLsizei index_num, GLint &base_vertex, GLuint &first_index){
+
+    if (!array_buffer_){
+        array_buffer_ = backend_->CreateBuffer();
+        element_array_buffer_ = backend_->CreateBuffer();
+        array_buffer_capacity_ = pool_initial_vertex_bytes_g;
+        element_array_buffer_capacity_ = pool_initial_index_bytes_g;
+        backend_->BindBuffer(GL_ARRAY_BUFFER, array_buffer_);
+        backend_->BufferData(GL_ARRAY_BUFFER, array_buffer_capacity_, NULL, GL_STATIC_DRAW);
+        backend_->BindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer_);
+        backend_->BufferData(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer_capacity_, NULL, GL_STATIC_DRAW);
+    }
+
+    size_t vertex_start = Allocate(free_vertex_, vertex_num, vertex_end_);
+    size_t index_start = Allocate(free_index_, index_num, index_end_);
+    base_vertex = (GLint) vertex_start;
+    first_index = (GLuint) index_start;
+
+    Upload(GL_ARRAY_BUFFER, array_buffer_, array_buffer_capacity_, vertex_end_ * stride_, vertex_start * stride_, (size_t) vertex_num * stride_, vertex);
+    vertex_end_ = std::max(vertex_end_, vertex_start + vertex_num);
+    Upload(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer_, element_array_buffer_capacity_, index_end_ * sizeof(GLushort), index_start * sizeof(GLushort), (size_t) index_num * sizeof(GLushort), index);
+    index_end_ = std::max(index_end_, index_start + index_num);
+}
+
+
+void GeometryPool::Remove(GLint base_vertex, GLsizei vertex_num, GLuint first_index, GLsizei index_num){
+
+    // The data stays in the buffers until the space is reused
+    vertex_end_ = Free(free_vertex_, base_vertex, vertex_num, vertex_end_);
+    index_end_ = Free(free_index_, first_index, index_num, index_end_);
+}
+
+
+void GeometryPool::Clear(void){
+
+    if (array_buffer_){
+        backend_->DeleteBuffer(array_buffer_);
+        backend_->DeleteBuffer(element_array_buffer_);
+    }
+    array_buffer_ = 0;
+    element_array_buffer_ = 0;
+    array_buffer_capacity_ = 0;
+    element_array_buffer_capacity_ = 0;
+    vertex_end_ = 0;
+    index_end_ = 0;
+    free_vertex_.clear();
+    free_index_.clear();
+}
+
+
+void GeometryPool::Upload(GLenum target, GLuint &buffer, size_t &capacity, size_t used, size_t offset, size_t size, const void *data){
+
+    if (offset + size > capacity){
+        // Copy the meshes to a larger buffer on the GPU; the old one is deleted once
+        // the draws using it are done
+        while (capacity < offset + size){
+            capacity *= 2;
+        }
+        GLuint grown = backend_->CreateBuffer();
+        backend_->BindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        backend_->BufferData(GL_COPY_WRITE_BUFFER, capacity, NULL, GL_STATIC_DRAW);
+        if (used > 0){
+            backend_->BindBuffer(GL_COPY_READ_BUFFER, buffer);
+            backend_->CopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+        }
+        backend_->DeleteBuffer(buffer);
+        buffer = grown;
+    }
+    backend_->BindBuffer(target, buffer);
+    backend_->BufferSubData(target, offset, size, data);
+}
+
+
+size_t GeometryPool::Allocate(std::vector<Range> &free, size_t size, size_t end){
+
+    for (size_t i = 0; i < free.size(); i++){
+        if (free[i].size >= size){
+            size_t start = free[i].start;
+            free[i].start += size;
+            free[i].size -= size;
+            if (free[i].size == 0){
+                free.erase(free.begin() + i);
+            }
+            return start;
+        }
+    }
+    return end;
+}
+
+
+size_t GeometryPool::Free(std::vector<Range> &free, size_t start, size_t size, size_t end){
+
+    // Insert in order, merging with the neighbours
+    size_t i = 0;
+    while (i < free.size() && free[i].start < start){
+        i++;
+    }
+    Range range = { start, size };
+    free.insert(free.begin() + i, range);
+    if (i + 1 < free.size() && free[i].start + free[i].size == free[i + 1].start){
+        free[i].size += free[i + 1].size;
+        free.erase(free.begin() + i + 1);
+    }
+    if (i > 0 && free[i - 1].start + free[i - 1].size == free[i].start){
+        free[i - 1].size += free[i].size;
+        free.erase(free.begin() + i);
+    }
+
+    // Free space at the end is simply not in use any more
+    if (!free.empty() && free.back().start + free.back().size == end){
+        end = free.back().start;
+        free.pop_back();
+    }
+    return end;
+}
+
+
+GLuint GeometryPool::GetArrayBuffer(void) const {
+
+    return array_buffer_;
+}
+
+
+GLuint GeometryPool::GetElementArrayBuffer(void) const {
+
+    return element_array_buffer_;
+}
+
+} // namespace game
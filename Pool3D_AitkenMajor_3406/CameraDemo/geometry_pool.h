@@ -0,0 +1,73 @@
+#ifndef GEOMETRY_POOL_H_
+#define GEOMETRY_POOL_H_
+
+#include <cstddef>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "render_backend.h"
+
+namespace game {
+
+    // Class that sub-allocates static meshes from one vertex buffer and one
+    // 16-bit index buffer, so meshes can be drawn without rebinding buffers.
+    // All meshes in a pool share the same vertex stride
+    class GeometryPool {
+
+        public:
+            // Constructor and destructor; the buffers are made through 'backend'
+            GeometryPool(GLsizei stride, RenderBackend *backend);
+            ~GeometryPool();
+
+            // Add a mesh, in space freed by Remove or at the end; indices are relative to its
+            // first vertex (base_vertex). first_index is the offset of the mesh in the index
+            // buffer, in indices. The data is uploaded from where it is and not kept; when a
+            // buffer is full it is replaced by a larger copy, so the buffer names can change
+            void Add(const void *vertex, GLsizei vertex_num, const GLushort *index, GLsizei index_num, GLint &base_vertex, GLuint &first_index);
+            // Free the space of a mesh added earlier (the buffers keep their size)
+            void Remove(GLint base_vertex, GLsizei vertex_num, GLuint first_index, GLsizei index_num);
+            // Delete the buffers and all meshes (needs the GL context)
+            void Clear(void);
+
+            // Buffers holding all meshes (created by the first Add, replaced when they grow)
+            GLuint GetArrayBuffer(void) const;
+            GLuint GetElementArrayBuffer(void) const;
+
+        private:
+            RenderBackend *backend_;
+            GLsizei stride_; // Size of a vertex in bytes
+
+            // End of the used part of the buffers (vertices and indices)
+            size_t vertex_end_;
+            size_t index_end_;
+
+            // Freed ranges (in vertices and in indices), sorted and merged
+            struct Range {
+                size_t start;
+                size_t size;
+            };
+            std::vector<Range> free_vertex_;
+            std::vector<Range> free_index_;
+
+            GLuint array_buffer_;
+            GLuint element_array_buffer_;
+            size_t array_buffer_capacity_; // Allocated sizes in bytes
+            size_t element_array_buffer_capacity_;
+
+            // Copy 'size' bytes of 'data' to 'offset' in 'buffer' (bound to 'target'). If the
+            // range ends past 'capacity', the buffer is first replaced by one large enough,
+            // with its first 'used' bytes copied on the GPU
+            void Upload(GLenum target, GLuint &buffer, size_t &capacity, size_t used, size_t offset, size_t size, const void *data);
+            // First free range of 'size' elements, taken out of 'free' ('end' if none fits)
+            static size_t Allocate(std::vector<Range> &free, size_t size, size_t end);
+            // Return a range to 'free'; the elements at 'end' are dropped from the list
+            // and the new end returned
+            static size_t Free(std::vector<Range> &free, size_t start, size_t size, size_t end);
+
+    }; // class GeometryPool
+
+} // namespace game
+
+#endif // GEOMETRY_POOL_H_
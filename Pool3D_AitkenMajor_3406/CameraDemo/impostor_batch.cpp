@@ -0,0 +1,99 @@
+#include <cstring>
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/type_ptr.hpp>
+
+#include "impostor_batch.h"
+
+namespace game {
+
+// Floats per instance: center (3), radius (1), color (3), gradient flag (1)
+const int impostor_instance_att_g = 8;
+
+ImpostorBatch::ImpostorBatch(void){
+
+    quad_buffer_ = 0;
+}
+
+
+ImpostorBatch::~ImpostorBatch(){
+}
+
+
+void ImpostorBatch::Clear(void){
+
+    instance_.clear();
+}
+
+
+void ImpostorBatch::Add(const glm::vec3 &center, float radius, const glm::vec3 &color, bool gradient_to_white){
+
+    instance_.push_back(center.x);
+    instance_.push_back(center.y);
+    instance_.push_back(center.z);
+    instance_.push_back(radius);
+    instance_.push_back(color.x);
+    instance_.push_back(color.y);
+    instance_.push_back(color.z);
+    instance_.push_back(gradient_to_white ? 1.0f : 0.0f);
+}
+
+
+int ImpostorBatch::GetSize(void) const {
+
+    return (int) (instance_.size() / impostor_instance_att_g);
+}
+
+
+void ImpostorBatch::Submit(RenderBackend *backend, Camera *camera, GLuint program, StreamBuffer *stream){
+
+    int count = GetSize();
+    if (count == 0){
+        return;
+    }
+
+    // Corners of the quad, drawn as a triangle strip (created on first use)
+    if (!quad_buffer_){
+        const GLfloat corner[] = { -1.0f, -1.0f,  1.0f, -1.0f,  -1.0f, 1.0f,  1.0f, 1.0f };
+        quad_buffer_ = backend->CreateBuffer();
+        backend->BindBuffer(GL_ARRAY_BUFFER, quad_buffer_);
+        backend->BufferData(GL_ARRAY_BUFFER, sizeof(corner), corner, GL_STATIC_DRAW);
+    }
+
+    backend->UseProgram(program);
+    camera->SetupShader(program, backend);
+    GLint eye_var = backend->GetUniformLocation(program, "eye_position");
+    backend->SetUniform(eye_var, camera->GetPosition());
+
+    // Per-vertex quad corner
+    GLint vertex_att = backend->GetAttribLocation(program, "vertex");
+    backend->BindBuffer(GL_ARRAY_BUFFER, quad_buffer_);
+    backend->VertexAttribPointer(vertex_att, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), 0);
+    backend->EnableVertexAttribArray(vertex_att);
+
+    // Copy the instance data into this frame's region of the stream buffer
+    GLsizeiptr size = (GLsizeiptr) (instance_.size() * sizeof(GLfloat));
+    GLintptr offset;
+    std::memcpy(stream->Allocate(size, offset), instance_.data(), size);
+    stream->Flush();
+    backend->BindBuffer(GL_ARRAY_BUFFER, stream->GetBuffer());
+
+    // Per-instance attributes advance once per quad
+    GLint sphere_att = backend->GetAttribLocation(program, "sphere");
+    GLint material_att = backend->GetAttribLocation(program, "material");
+    backend->VertexAttribPointer(sphere_att, 4, GL_FLOAT, GL_FALSE, impostor_instance_att_g * sizeof(GLfloat), offset);
+    backend->EnableVertexAttribArray(sphere_att);
+    backend->VertexAttribDivisor(sphere_att, 1);
+    backend->VertexAttribPointer(material_att, 4, GL_FLOAT, GL_FALSE, impostor_instance_att_g * sizeof(GLfloat), offset + 4 * sizeof(GLfloat));
+    backend->EnableVertexAttribArray(material_att);
+    backend->VertexAttribDivisor(material_att, 1);
+
+    backend->DrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count, 0);
+
+    // Divisors are global state (no vertex array object): restore them for the mesh path
+    backend->VertexAttribDivisor(sphere_att, 0);
+    backend->VertexAttribDivisor(material_att, 0);
+    backend->DisableVertexAttribArray(sphere_att);
+    backend->DisableVertexAttribArray(material_att);
+}
+
+} // namespace game
@@ -0,0 +1,46 @@
+#ifndef IMPOSTOR_BATCH_H_
+#define IMPOSTOR_BATCH_H_
+
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include "camera.h"
+#include "stream_buffer.h"
+#include "render_backend.h"
+
+namespace game {
+
+    // Class that draws spheres as ray-cast impostors: one camera-facing quad
+    // per sphere, all submitted with a single instanced draw
+    class ImpostorBatch {
+
+        public:
+            // Constructor and destructor
+            ImpostorBatch(void);
+            ~ImpostorBatch();
+
+            // Remove all collected spheres (keeps allocated memory)
+            void Clear(void);
+            // Add a sphere in world space, with the shading of CreateColoredSphere
+            void Add(const glm::vec3 &center, float radius, const glm::vec3 &color, bool gradient_to_white);
+            // Number of collected spheres
+            int GetSize(void) const;
+
+            // Draw all collected spheres with the impostor shader program through 'backend';
+            // instance data is streamed through 'stream'
+            void Submit(RenderBackend *backend, Camera *camera, GLuint program, StreamBuffer *stream);
+
+        private:
+            // Per-instance data: center (3), radius (1), color (3), gradient flag (1)
+            std::vector<GLfloat> instance_;
+
+            GLuint quad_buffer_; // Corners of the unit quad
+
+    }; // class ImpostorBatch
+
+} // namespace game
+
+#endif // IMPOSTOR_BATCH_H_
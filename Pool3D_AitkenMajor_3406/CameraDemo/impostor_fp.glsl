@@ -0,0 +1,42 @@
+#version 130
+
+// Attributes passed from the vertex shader
+in vec3 ray_target;
+flat in vec4 sphere_interp;
+flat in vec4 material_interp;
+
+// Uniform (global) buffer
+uniform mat4 view_mat;
+uniform mat4 projection_mat;
+uniform vec3 eye_position;
+
+
+void main() 
+{
+    // Intersect the eye ray through this fragment with the sphere
+    vec3 center = sphere_interp.xyz;
+    float radius = sphere_interp.w;
+    vec3 dir = normalize(ray_target - eye_position);
+    vec3 oc = eye_position - center;
+    float b = dot(oc, dir);
+    float c = dot(oc, oc) - radius * radius;
+    float h = b * b - c;
+    if (h < 0.0) {
+        discard;
+    }
+    vec3 hit = eye_position + dir * (-b - sqrt(h));
+    vec3 normal = (hit - center) / radius;
+
+    // Same coloring as CreateColoredSphere: solid, or interpolated towards white from normal.y
+    vec3 color = material_interp.rgb;
+    if (material_interp.a > 0.5) {
+        float t = clamp(0.5 * (1.0 - normal.y), 0.0, 1.0);
+        color = mix(color, vec3(1.0), t);
+    }
+
+    // Depth of the hit point, not of the quad (default depth range [0, 1])
+    vec4 clip = projection_mat * view_mat * vec4(hit, 1.0);
+    gl_FragDepth = 0.5 * (clip.z / clip.w) + 0.5;
+
+    gl_FragColor = vec4(color, 1.0);
+}
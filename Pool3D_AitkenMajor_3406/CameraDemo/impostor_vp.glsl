@@ -0,0 +1,50 @@
+#version 130
+
+// Vertex buffer: corner of the unit quad
+in vec2 vertex;
+
+// Per-instance attributes
+in vec4 sphere; // World center (xyz) and radius (w)
+in vec4 material; // Base color (rgb) and gradient-to-white flag (a)
+
+// Uniform (global) buffer
+uniform mat4 view_mat;
+uniform mat4 projection_mat;
+uniform vec3 eye_position;
+
+// Attributes forwarded to the fragment shader
+out vec3 ray_target;
+flat out vec4 sphere_interp;
+flat out vec4 material_interp;
+
+
+void main()
+{
+    vec3 center = sphere.xyz;
+    float radius = sphere.w;
+
+    // Quad through the center, facing the eye, large enough to cover the
+    // silhouette of the sphere as seen from the eye
+    vec3 to_center = center - eye_position;
+    float dist = length(to_center);
+    vec3 forward = to_center / dist;
+    vec3 camera_up = vec3(view_mat[0][1], view_mat[1][1], view_mat[2][1]);
+    vec3 side = cross(forward, camera_up);
+    if (dot(side, side) < 1e-6) {
+        side = vec3(view_mat[0][0], view_mat[1][0], view_mat[2][0]);
+    }
+    side = normalize(side);
+    vec3 up = cross(side, forward);
+
+    // Eye inside the sphere: collapse the quad
+    float extent = 0.0;
+    if (dist > radius * 1.0001) {
+        extent = radius * dist / sqrt(dist * dist - radius * radius);
+    }
+
+    ray_target = center + (vertex.x * side + vertex.y * up) * extent;
+    gl_Position = projection_mat * view_mat * vec4(ray_target, 1.0);
+
+    sphere_interp = sphere;
+    material_interp = material;
+}
@@ -0,0 +1,147 @@
+#include <fstream>
+#include <sstream>
+
+#include "input_queue.h"
+
+namespace game {
+
+InputQueue::InputQueue(void){
+
+    head_.store(0, std::memory_order_relaxed);
+    tail_.store(0, std::memory_order_relaxed);
+    dropped_.store(0, std::memory_order_relaxed);
+}
+
+
+InputQueue::~InputQueue(){
+}
+
+
+bool InputQueue::Push(const InputEvent &event){
+
+    unsigned head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= input_queue_size_g){
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    event_[head % input_queue_size_g] = event;
+    // Publish the event after it is written
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+
+unsigned InputQueue::GetSize(void) const {
+
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_relaxed);
+}
+
+
+const InputEvent &InputQueue::Peek(unsigned index) const {
+
+    return event_[(tail_.load(std::memory_order_relaxed) + index) % input_queue_size_g];
+}
+
+
+void InputQueue::Pop(void){
+
+    // Hand the slot back to the producer once the event was read
+    tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+
+unsigned InputQueue::GetDropped(void) const {
+
+    return dropped_.load(std::memory_order_relaxed);
+}
+
+
+InputLog::InputLog(void){
+
+    seed_ = 0;
+}
+
+
+InputLog::~InputLog(){
+}
+
+
+void InputLog::Add(const InputRecord &record){
+
+    record_.push_back(record);
+}
+
+
+void InputLog::Clear(void){
+
+    record_.clear();
+}
+
+
+size_t InputLog::GetSize(void) const {
+
+    return record_.size();
+}
+
+
+const InputRecord &InputLog::Get(size_t index) const {
+
+    return record_[index];
+}
+
+
+void InputLog::SetSeed(unsigned seed){
+
+    seed_ = seed;
+}
+
+
+unsigned InputLog::GetSeed(void) const {
+
+    return seed_;
+}
+
+
+void InputLog::Save(const std::string &filename) const {
+
+    std::ofstream f(filename.c_str());
+    if (f.fail()){
+        throw(std::ios_base::failure(std::string("Error opening file ")+filename));
+    }
+    f << "seed " << seed_ << "\n";
+    for (const InputRecord &r : record_){
+        f << r.tick << " " << r.key << " " << r.action << " " << r.mods << "\n";
+    }
+    f.close();
+    if (f.fail()){
+        throw(std::ios_base::failure(std::string("Error writing file ")+filename));
+    }
+}
+
+
+void InputLog::Load(const std::string &filename){
+
+    std::ifstream f(filename.c_str());
+    if (f.fail()){
+        throw(std::ios_base::failure(std::string("Error opening file ")+filename));
+    }
+    record_.clear();
+    std::string line, word;
+    // The seed comes first
+    if (!std::getline(f, line) || !(std::stringstream(line) >> word >> seed_) || word != "seed"){
+        throw(std::ios_base::failure(std::string("Missing seed in input log ")+filename));
+    }
+    while (std::getline(f, line)){
+        if (line.empty()){
+            continue;
+        }
+        std::stringstream ss(line);
+        InputRecord r;
+        if (!(ss >> r.tick >> r.key >> r.action >> r.mods) || (!record_.empty() && r.tick < record_.back().tick)){
+            throw(std::ios_base::failure(std::string("Invalid input log line in ")+filename+": "+line));
+        }
+        record_.push_back(r);
+    }
+}
+
+} // namespace game
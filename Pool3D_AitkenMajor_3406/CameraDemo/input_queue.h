@@ -0,0 +1,87 @@
+#ifndef INPUT_QUEUE_H_
+#define INPUT_QUEUE_H_
+
+#include <cstdint>
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace game {
+
+    // Events the input queue holds before it drops new ones
+    const unsigned input_queue_size_g = 256;
+
+    // Key event with the time it was received (seconds of glfwGetTime)
+    struct InputEvent {
+        double time;
+        int key;
+        int action; // GLFW_PRESS or GLFW_RELEASE
+        int mods;
+    };
+
+    // Key event of a replay log, with the physics tick that consumed it
+    struct InputRecord {
+        uint64_t tick;
+        int key;
+        int action;
+        int mods;
+    };
+
+    // Lock-free ring of input events with one producer (the window callbacks) and one
+    // consumer (the game). A full queue drops new events and counts them
+    class InputQueue {
+
+        public:
+            InputQueue(void);
+            ~InputQueue();
+
+            // Producer: add an event (false if the queue is full)
+            bool Push(const InputEvent &event);
+
+            // Consumer: number of queued events, the 'index'-th oldest one (index < GetSize)
+            // and removal of the oldest one
+            unsigned GetSize(void) const;
+            const InputEvent &Peek(unsigned index) const;
+            void Pop(void);
+
+            // Events dropped because the queue was full
+            unsigned GetDropped(void) const;
+
+        private:
+            InputEvent event_[input_queue_size_g];
+            std::atomic<unsigned> head_; // Events pushed; the next one goes to head_ % size
+            std::atomic<unsigned> tail_; // Events popped
+            std::atomic<unsigned> dropped_;
+
+    }; // class InputQueue
+
+    // Key events in the order the physics ticks consumed them. Replaying them at the same
+    // ticks reproduces the camera moves and shots of a session
+    class InputLog {
+
+        public:
+            InputLog(void);
+            ~InputLog();
+
+            void Add(const InputRecord &record);
+            void Clear(void);
+            size_t GetSize(void) const;
+            const InputRecord &Get(size_t index) const;
+            // Seed of the game's random numbers during the session
+            void SetSeed(unsigned seed);
+            unsigned GetSeed(void) const;
+
+            // Write or read the log as text: a "seed N" line, then one event per line
+            // (throw std::ios_base::failure)
+            void Save(const std::string &filename) const;
+            void Load(const std::string &filename);
+
+        private:
+            std::vector<InputRecord> record_;
+            unsigned seed_;
+
+    }; // class InputLog
+
+} // namespace game
+
+#endif // INPUT_QUEUE_H_
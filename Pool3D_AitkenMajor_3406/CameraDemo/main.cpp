@@ -9,6 +9,9 @@
 
 #include <iostream>
 #include <exception>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include "game.h"
 
 // Macro for printing exceptions
@@ -16,20 +19,65 @@
 	std::cerr << exception_object.what() << std::endl
 
 // Main function that builds and runs the game
-int main(void){
+// Benchmark: CameraDemo --headless [--size WIDTHxHEIGHT] [--frames N] [--dump DIRECTORY]
+// Game without the render thread: CameraDemo --single-thread
+// Record the key events of a game, or replay them: CameraDemo --record FILE, CameraDemo --replay FILE
+int main(int argc, char *argv[]){
     game::Game app; // Game application
 
+    // Command line: headless benchmark settings
+    bool headless = false;
+    int width = 1280, height = 720;
+    int frames = 300;
+    std::string dump_directory;
+    std::string replay_file;
+    for (int i = 1; i < argc; i++){
+        if (!strcmp(argv[i], "--headless")){
+            headless = true;
+        } else if (!strcmp(argv[i], "--size") && i + 1 < argc){
+            if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0){
+                std::cerr << "Invalid size " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--frames") && i + 1 < argc){
+            frames = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--dump") && i + 1 < argc){
+            dump_directory = argv[++i];
+        } else if (!strcmp(argv[i], "--single-thread")){
+            app.SetThreadedRendering(false);
+        } else if (!strcmp(argv[i], "--record") && i + 1 < argc){
+            app.RecordInput(argv[++i]);
+        } else if (!strcmp(argv[i], "--replay") && i + 1 < argc){
+            replay_file = argv[++i];
+        } else {
+            std::cerr << "Unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
     try {
         // Initialize game
-        app.Init();
+        if (headless){
+            app.InitHeadless(width, height);
+        } else {
+            app.Init();
+        }
         // Setup the main resources and scene in the game
         app.SetupResources();
         app.SetupScene();
-        // Run game
-        app.MainLoop();
+        if (!replay_file.empty()){
+            app.ReplayInput(replay_file);
+        }
+        // Run game, or render the benchmark frames
+        if (headless){
+            app.RunBenchmark(frames, dump_directory);
+        } else {
+            app.MainLoop();
+        }
     }
     catch (std::exception &e){
         PrintException(e);
+        return 1;
     }
 
     return 0;
@@ -2,10 +2,17 @@
 
 // Vertex buffer
 in vec3 vertex;
+in vec2 normal; // Octahedral encoding
 in vec3 color;
 
+// Per-draw data (constant values, or per instance with multi-draw indirect)
+in mat4 world_mat;
+// Material of the node: base color (rgb). The color mode is a compile-time feature:
+// vertex color by default, SOLID_COLOR: base color, GRADIENT_COLOR: base color blended
+// toward white along -Y
+in vec4 material;
+
 // Uniform (global) buffer
-uniform mat4 world_mat;
 uniform mat4 view_mat;
 uniform mat4 projection_mat;
 
@@ -13,9 +20,30 @@ uniform mat4 projection_mat;
 out vec4 color_interp;
 
 
+// Unit normal from its octahedral encoding (see OctahedralEncode)
+vec3 DecodeNormal(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        vec2 s = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+        n.xy = (1.0 - abs(n.yx)) * s;
+    }
+    return normalize(n);
+}
+
 void main()
 {
     gl_Position = projection_mat * view_mat * world_mat * vec4(vertex, 1.0);
 
-    color_interp = vec4(color, 1.0);
+#if defined(GRADIENT_COLOR)
+    // Stripe-like gradient: more white toward the -Y pole of the object
+    float t = clamp(0.5 * (1.0 - DecodeNormal(normal).y), 0.0, 1.0);
+    vec3 base = mix(material.rgb, vec3(1.0), t);
+#elif defined(SOLID_COLOR)
+    vec3 base = material.rgb;
+#else
+    vec3 base = color;
+#endif
+
+    color_interp = vec4(base, 1.0);
 }
@@ -0,0 +1,443 @@
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <glm/gtc/constants.hpp>
+
+#include "mesh_generator.h"
+#include "mesh_optimizer.h"
+
+namespace game {
+
+void PackMesh(const GLfloat *vertex, GLuint vertex_num, const GLuint *face, GLsizei index_num, MeshData &mesh){
+
+    // Convert the generator vertices to the compact layout
+    PackVertices(vertex, vertex_num, mesh.vertex, mesh.position_offset, mesh.position_scale);
+    const GLsizei stride = packed_vertex_format_g.stride;
+
+    // Merge duplicates (seams, poles), then order the triangles for the vertex cache
+    // and the vertices for the fetch
+    mesh.index.assign(face, face + index_num);
+    mesh.source_vertex_num = vertex_num;
+    mesh.source_index_num = index_num;
+    mesh.source_acmr = ComputeACMR(mesh.index, vertex_num);
+    WeldVertices(mesh.vertex, stride, packed_weld_key_size_g, mesh.index);
+    OptimizeVertexCache(mesh.index, (GLuint) (mesh.vertex.size() / stride));
+    OptimizeVertexFetch(mesh.vertex, stride, mesh.index);
+}
+
+
+void GenerateSphere(float radius, int num_samples_theta, int num_samples_phi, MeshData &mesh){
+
+    // Create a sphere using a well-known parameterization
+
+    // Number of vertices and faces to be created
+    const GLuint vertex_num = num_samples_theta*num_samples_phi;
+    const GLuint face_num = num_samples_theta*(num_samples_phi-1)*2;
+
+    // Number of attributes for vertices and faces
+    const int vertex_att = 11;
+    const int face_att = 3;
+
+    // Data buffers 
+    GLfloat *vertex = NULL;
+    GLuint *face = NULL;
+
+    // Allocate memory for buffers
+    try {
+        vertex = new GLfloat[vertex_num * vertex_att]; // 11 attributes per vertex: 3D position (3), 3D normal (3), RGB color (3), 2D texture coordinates (2)
+        face = new GLuint[face_num * face_att]; // 3 indices per face
+    }
+    catch  (std::exception &e){
+        throw e;
+    }
+
+    // Create vertices 
+    float theta, phi; // Angles for parametric equation
+    glm::vec3 vertex_position;
+    glm::vec3 vertex_normal;
+    glm::vec3 vertex_color;
+    glm::vec2 vertex_coord;
+   
+    for (int i = 0; i < num_samples_theta; i++){
+            
+        theta = 2.0*glm::pi<GLfloat>()*i/(num_samples_theta-1); // angle theta
+            
+        for (int j = 0; j < num_samples_phi; j++){
+                    
+            phi = glm::pi<GLfloat>()*j/(num_samples_phi-1); // angle phi
+
+            // Define position, normal and color of vertex
+            vertex_normal = glm::vec3(cos(theta)*sin(phi), sin(theta)*sin(phi), -cos(phi));
+            // We need z = -cos(phi) to make sure that the z coordinate runs from -1 to 1 as phi runs from 0 to pi
+            // Otherwise, the normal will be inverted
+            vertex_position = glm::vec3(vertex_normal.x*radius, 
+                                        vertex_normal.y*radius, 
+                                        vertex_normal.z*radius),
+            vertex_color = glm::vec3(((float)i)/((float)num_samples_theta), 1.0-((float)j)/((float)num_samples_phi), ((float)j)/((float)num_samples_phi));
+            vertex_coord = glm::vec2(((float)i)/((float)num_samples_theta), 1.0-((float)j)/((float)num_samples_phi));
+
+            // Add vectors to the data buffer
+            for (int k = 0; k < 3; k++){
+                vertex[(i*num_samples_phi+j)*vertex_att + k] = vertex_position[k];
+                vertex[(i*num_samples_phi+j)*vertex_att + k + 3] = vertex_normal[k];
+                vertex[(i*num_samples_phi+j)*vertex_att + k + 6] = vertex_color[k];
+            }
+            vertex[(i*num_samples_phi+j)*vertex_att + 9] = vertex_coord[0];
+            vertex[(i*num_samples_phi+j)*vertex_att + 10] = vertex_coord[1];
+        }
+    }
+
+    // Create faces
+    for (int i = 0; i < num_samples_theta; i++){
+        for (int j = 0; j < (num_samples_phi-1); j++){
+            // Two triangles per quad
+            glm::vec3 t1(((i + 1) % num_samples_theta)*num_samples_phi + j, 
+                         i*num_samples_phi + (j + 1),
+                         i*num_samples_phi + j);
+            glm::vec3 t2(((i + 1) % num_samples_theta)*num_samples_phi + j, 
+                         ((i + 1) % num_samples_theta)*num_samples_phi + (j + 1), 
+                         i*num_samples_phi + (j + 1));
+            // Add two triangles to the data buffer
+            for (int k = 0; k < 3; k++){
+                face[(i*(num_samples_phi-1)+j)*face_att*2 + k] = (GLuint) t1[k];
+                face[(i*(num_samples_phi-1)+j)*face_att*2 + k + face_att] = (GLuint) t2[k];
+            }
+        }
+    }
+
+    // Pack and optimize for the vertex cache
+    PackMesh(vertex, vertex_num, face, face_num * face_att, mesh);
+
+    // Free data buffers
+    delete [] vertex;
+    delete [] face;
+}
+
+
+void GenerateColoredSphere(const glm::vec3 &color, bool gradient_to_white, float radius, int num_samples_theta, int num_samples_phi, MeshData &mesh) {
+
+    // Create a sphere using a parametric parameterization, identical topology to CreateSphere
+    const GLuint vertex_num = num_samples_theta * num_samples_phi;
+    const GLuint face_num = num_samples_theta * (num_samples_phi - 1) * 2;
+    const int vertex_att = 11;
+    const int face_att = 3;
+
+    GLfloat *vertex = NULL;
+    GLuint *face = NULL;
+
+    try {
+        vertex = new GLfloat[vertex_num * vertex_att];
+        face = new GLuint[face_num * face_att];
+    }
+    catch (std::exception &e) {
+        throw e;
+    }
+
+    float theta, phi;
+    glm::vec3 vertex_position;
+    glm::vec3 vertex_normal;
+    glm::vec3 vertex_color;
+    glm::vec2 vertex_coord;
+
+    for (int i = 0; i < num_samples_theta; i++) {
+        theta = 2.0f * glm::pi<GLfloat>() * i / (num_samples_theta - 1);
+        for (int j = 0; j < num_samples_phi; j++) {
+            phi = glm::pi<GLfloat>() * j / (num_samples_phi - 1);
+
+            vertex_normal = glm::vec3(cos(theta) * sin(phi), sin(theta) * sin(phi), -cos(phi));
+            vertex_position = glm::vec3(vertex_normal.x * radius, vertex_normal.y * radius, vertex_normal.z * radius);
+
+            // Choose color: either solid 'color' or interpolated towards white
+            if (!gradient_to_white) {
+                vertex_color = color;
+            } else {
+                // Interpolate toward white based on the hemisphere: more white near +Y surface
+                // t in [0,1], compute from normal.y so poles interpolate more to white
+                float t = glm::clamp(0.5f * (1.0f - vertex_normal.y), 0.0f, 1.0f);
+                vertex_color = (1.0f - t) * color + t * glm::vec3(1.0f);
+            }
+
+            vertex_coord = glm::vec2(((float)i) / ((float)num_samples_theta), 1.0f - ((float)j) / ((float)num_samples_phi));
+
+            for (int k = 0; k < 3; k++) {
+                vertex[(i * num_samples_phi + j) * vertex_att + k] = vertex_position[k];
+                vertex[(i * num_samples_phi + j) * vertex_att + k + 3] = vertex_normal[k];
+                vertex[(i * num_samples_phi + j) * vertex_att + k + 6] = vertex_color[k];
+            }
+            vertex[(i * num_samples_phi + j) * vertex_att + 9] = vertex_coord[0];
+            vertex[(i * num_samples_phi + j) * vertex_att + 10] = vertex_coord[1];
+        }
+    }
+
+    // Create faces (same as CreateSphere)
+    for (int i = 0; i < num_samples_theta; i++) {
+        for (int j = 0; j < (num_samples_phi - 1); j++) {
+            glm::vec3 t1(((i + 1) % num_samples_theta) * num_samples_phi + j,
+                         i * num_samples_phi + (j + 1),
+                         i * num_samples_phi + j);
+            glm::vec3 t2(((i + 1) % num_samples_theta) * num_samples_phi + j,
+                         ((i + 1) % num_samples_theta) * num_samples_phi + (j + 1),
+                         i * num_samples_phi + (j + 1));
+            for (int k = 0; k < 3; k++) {
+                face[(i * (num_samples_phi - 1) + j) * face_att * 2 + k] = (GLuint)t1[k];
+                face[(i * (num_samples_phi - 1) + j) * face_att * 2 + k + face_att] = (GLuint)t2[k];
+            }
+        }
+    }
+
+    // Pack and optimize for the vertex cache
+    PackMesh(vertex, vertex_num, face, face_num * face_att, mesh);
+
+    delete[] vertex;
+    delete[] face;
+}
+
+
+void GenerateTorus(float loop_radius, float circle_radius, int num_loop_samples, int num_circle_samples, MeshData &mesh) {
+
+    // Increase torus loop radius by 50% to make diameter 50% larger
+    float loopR = loop_radius * torus_loop_scale_g;
+    float tubeR = circle_radius;
+
+    // Number of vertices and faces
+    const GLuint vertex_num = num_loop_samples * num_circle_samples;
+    const GLuint face_num = num_loop_samples * num_circle_samples * 2;
+
+    // Attributes: position(3), normal(3), color(3), texcoord(2)
+    const int vertex_att = 11;
+    const int face_att = 3;
+
+    GLfloat* vertex = nullptr;
+    GLuint* face = nullptr;
+
+    try {
+        vertex = new GLfloat[vertex_num * vertex_att];
+        face = new GLuint[face_num * face_att];
+    }
+    catch (std::exception &e) {
+        throw e;
+    }
+
+    // Build vertices
+    for (int i = 0; i < num_loop_samples; ++i) {
+        float u = 2.0f * glm::pi<float>() * i / num_loop_samples; // loop angle
+        float cu = cos(u), su = sin(u);
+        for (int j = 0; j < num_circle_samples; ++j) {
+            float v = 2.0f * glm::pi<float>() * j / num_circle_samples; // tube angle
+            float cv = cos(v), sv = sin(v);
+
+            // Position using scaled loopR and tubeR
+            float x = (loopR + tubeR * cv) * cu;
+            float y = (loopR + tubeR * cv) * su;
+            float z = tubeR * sv;
+
+            // Normal: vector from tube center to surface point (normalized)
+            glm::vec3 n = glm::normalize(glm::vec3(cu * cv, su * cv, sv));
+
+            // Color: slightly darker grey for guides
+            glm::vec3 color = glm::vec3(0.3f, 0.3f, 0.3f);
+
+            // Texcoords
+            float s = (float)i / (float)num_loop_samples;
+            float t = (float)j / (float)num_circle_samples;
+
+            int idx = (i * num_circle_samples + j) * vertex_att;
+            vertex[idx + 0] = x;
+            vertex[idx + 1] = y;
+            vertex[idx + 2] = z;
+            vertex[idx + 3] = n.x;
+            vertex[idx + 4] = n.y;
+            vertex[idx + 5] = n.z;
+            vertex[idx + 6] = color.x;
+            vertex[idx + 7] = color.y;
+            vertex[idx + 8] = color.z;
+            vertex[idx + 9] = s;
+            vertex[idx + 10] = t;
+        }
+    }
+
+    // Build faces (two triangles per quad, wrapping on both dimensions)
+    int fidx = 0;
+    for (int i = 0; i < num_loop_samples; ++i) {
+        int inext = (i + 1) % num_loop_samples;
+        for (int j = 0; j < num_circle_samples; ++j) {
+            int jnext = (j + 1) % num_circle_samples;
+
+            // indices of quad corners
+            GLuint a = i * num_circle_samples + j;
+            GLuint b = inext * num_circle_samples + j;
+            GLuint c = inext * num_circle_samples + jnext;
+            GLuint d = i * num_circle_samples + jnext;
+
+            // triangle 1: a, b, d
+            face[fidx * face_att + 0] = a;
+            face[fidx * face_att + 1] = b;
+            face[fidx * face_att + 2] = d;
+            ++fidx;
+
+            // triangle 2: b, c, d
+            face[fidx * face_att + 0] = b;
+            face[fidx * face_att + 1] = c;
+            face[fidx * face_att + 2] = d;
+            ++fidx;
+        }
+    }
+
+    // Pack and optimize for the vertex cache
+    PackMesh(vertex, vertex_num, face, face_num * face_att, mesh);
+
+    // Free CPU memory
+    delete[] vertex;
+    delete[] face;
+}
+
+
+void GenerateBox(float width, float height, float depth, MeshData &mesh) {
+
+    // Box centered at origin, depth along +Z. We'll create 8 vertices and 12 triangles.
+    const int vertex_att = 11;
+    const int face_att = 3;
+
+    const GLuint vertex_num = 8;
+    const GLuint face_num = 12;
+
+    GLfloat *vertex = nullptr;
+    GLuint *face = nullptr;
+
+    try {
+        vertex = new GLfloat[vertex_num * vertex_att];
+        face = new GLuint[face_num * face_att];
+    } catch (std::exception &e) {
+        throw e;
+    }
+
+    float hx = width * 0.5f;
+    float hy = height * 0.5f;
+    float hz = depth * 0.5f;
+
+    // Define 8 corner positions
+    glm::vec3 positions[8] = {
+        glm::vec3(-hx, -hy, -hz),
+        glm::vec3( hx, -hy, -hz),
+        glm::vec3( hx,  hy, -hz),
+        glm::vec3(-hx,  hy, -hz),
+        glm::vec3(-hx, -hy,  hz),
+        glm::vec3( hx, -hy,  hz),
+        glm::vec3( hx,  hy,  hz),
+        glm::vec3(-hx,  hy,  hz)
+    };
+
+    // Per-vertex normals (we'll assign averaged normals per face corners to keep it simple)
+    glm::vec3 normals[8] = {
+        glm::vec3(-1,-1,-1),
+        glm::vec3( 1,-1,-1),
+        glm::vec3( 1, 1,-1),
+        glm::vec3(-1, 1,-1),
+        glm::vec3(-1,-1, 1),
+        glm::vec3( 1,-1, 1),
+        glm::vec3( 1, 1, 1),
+        glm::vec3(-1, 1, 1)
+    };
+    for (int i = 0; i < 8; ++i) normals[i] = glm::normalize(normals[i]);
+
+    // Color: white (alpha handled by shader if supported)
+    glm::vec3 color(1.0f, 1.0f, 1.0f);
+
+    // Texcoords (not important)
+    glm::vec2 uvs[8] = {
+        glm::vec2(0.0f,0.0f), glm::vec2(1.0f,0.0f), glm::vec2(1.0f,1.0f), glm::vec2(0.0f,1.0f),
+        glm::vec2(0.0f,0.0f), glm::vec2(1.0f,0.0f), glm::vec2(1.0f,1.0f), glm::vec2(0.0f,1.0f)
+    };
+
+    // Fill vertex buffer (position, normal, color, uv)
+    for (int i = 0; i < 8; ++i) {
+        int idx = i * vertex_att;
+        vertex[idx + 0] = positions[i].x;
+        vertex[idx + 1] = positions[i].y;
+        vertex[idx + 2] = positions[i].z;
+        vertex[idx + 3] = normals[i].x;
+        vertex[idx + 4] = normals[i].y;
+        vertex[idx + 5] = normals[i].z;
+        vertex[idx + 6] = color.x;
+        vertex[idx + 7] = color.y;
+        vertex[idx + 8] = color.z;
+        vertex[idx + 9] = uvs[i].x;
+        vertex[idx + 10] = uvs[i].y;
+    }
+
+    // Index order (12 triangles)
+    GLuint inds[36] = {
+        // back face (-Z)
+        0,1,2, 0,2,3,
+        // front face (+Z)
+        4,6,5, 4,7,6,
+        // left face (-X)
+        0,3,7, 0,7,4,
+        // right face (+X)
+        1,5,6, 1,6,2,
+        // bottom face (-Y)
+        0,4,5, 0,5,1,
+        // top face (+Y)
+        3,2,6, 3,6,7
+    };
+
+    for (GLuint i = 0; i < face_num * face_att; ++i) face[i] = inds[i];
+
+    // Pack and optimize for the vertex cache
+    PackMesh(vertex, vertex_num, face, face_num * face_att, mesh);
+
+    delete[] vertex;
+    delete[] face;
+}
+
+
+void GetSphereLevels(int num_samples_theta, int num_samples_phi, std::vector<int> &level_theta, std::vector<int> &level_phi){
+
+    level_theta.clear();
+    level_phi.clear();
+    for (int level = 0; ; level++){
+        int theta = num_samples_theta >> level;
+        int phi = num_samples_phi >> level;
+        if (level > 0 && (theta < lod_min_samples_g || phi < lod_min_samples_g)){
+            break;
+        }
+        level_theta.push_back(theta);
+        level_phi.push_back(phi);
+    }
+}
+
+
+// Descriptions print floats with all their digits, so only equal parameters give equal text
+
+std::string DescribeSphere(float radius, int num_samples_theta, int num_samples_phi){
+
+    char text[128];
+    snprintf(text, sizeof(text), "sphere %.9g %d %d", radius, num_samples_theta, num_samples_phi);
+    return text;
+}
+
+
+std::string DescribeColoredSphere(const glm::vec3 &color, bool gradient_to_white, float radius, int num_samples_theta, int num_samples_phi){
+
+    char text[128];
+    snprintf(text, sizeof(text), "colored_sphere %.9g %.9g %.9g %d %.9g %d %d", color.x, color.y, color.z, gradient_to_white ? 1 : 0, radius, num_samples_theta, num_samples_phi);
+    return text;
+}
+
+
+std::string DescribeTorus(float loop_radius, float circle_radius, int num_loop_samples, int num_circle_samples){
+
+    char text[128];
+    snprintf(text, sizeof(text), "torus %.9g %.9g %d %d", loop_radius, circle_radius, num_loop_samples, num_circle_samples);
+    return text;
+}
+
+
+std::string DescribeBox(float width, float height, float depth){
+
+    char text[128];
+    snprintf(text, sizeof(text), "box %.9g %.9g %.9g", width, height, depth);
+    return text;
+}
+
+} // namespace game
@@ -0,0 +1,71 @@
+#ifndef MESH_GENERATOR_H_
+#define MESH_GENERATOR_H_
+
+#include <string>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include "vertex_format.h"
+
+namespace game {
+
+    // Procedural meshes, generated without a GL context (used by the resource manager
+    // on worker threads and by the asset pack builder)
+
+    // Mesh in packed_vertex_format_g, welded and reordered for the vertex cache
+    struct MeshData {
+        std::vector<unsigned char> vertex;
+        std::vector<GLuint> index;
+        glm::vec3 position_offset; // Dequantization of the stored positions
+        glm::vec3 position_scale;
+        // Size and cache efficiency of the mesh as generated
+        GLuint source_vertex_num;
+        GLsizei source_index_num;
+        float source_acmr;
+    };
+
+    // Packed mesh stored elsewhere (asset pack, compiled-in data) and used in place
+    struct MeshView {
+        const void *vertex; // packed_vertex_format_g
+        GLuint vertex_num;
+        const void *index;
+        GLsizei index_num;
+        GLenum index_type; // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+        glm::vec3 position_offset; // Dequantization of the stored positions
+        glm::vec3 position_scale;
+
+        MeshView(void) : vertex(NULL), vertex_num(0), index(NULL), index_num(0), index_type(GL_UNSIGNED_SHORT) {}
+    };
+
+    // Coarsest level of detail of a sphere keeps at least this many samples per angle
+    const int lod_min_samples_g = 6;
+    // The torus loop radius is enlarged by 50% to make the diameter 50% larger
+    const float torus_loop_scale_g = 1.5f;
+
+    // Pack the vertices (float_vertex_att_g floats each) and indices of a generated mesh,
+    // and weld and reorder them for the vertex cache
+    void PackMesh(const GLfloat *vertex, GLuint vertex_num, const GLuint *face, GLsizei index_num, MeshData &mesh);
+
+    // Generators of single meshes
+    void GenerateSphere(float radius, int num_samples_theta, int num_samples_phi, MeshData &mesh);
+    void GenerateColoredSphere(const glm::vec3 &color, bool gradient_to_white, float radius, int num_samples_theta, int num_samples_phi, MeshData &mesh);
+    void GenerateTorus(float loop_radius, float circle_radius, int num_loop_samples, int num_circle_samples, MeshData &mesh);
+    void GenerateBox(float width, float height, float depth, MeshData &mesh);
+
+    // Sample counts of the levels of detail of a sphere, full detail first: each level
+    // halves the samples until fewer than lod_min_samples_g would remain
+    void GetSphereLevels(int num_samples_theta, int num_samples_phi, std::vector<int> &level_theta, std::vector<int> &level_phi);
+
+    // Canonical description of a generated mesh; asset packs store pre-generated meshes
+    // under the hash of this string, so a mesh is only reused for the same parameters
+    std::string DescribeSphere(float radius, int num_samples_theta, int num_samples_phi);
+    std::string DescribeColoredSphere(const glm::vec3 &color, bool gradient_to_white, float radius, int num_samples_theta, int num_samples_phi);
+    std::string DescribeTorus(float loop_radius, float circle_radius, int num_loop_samples, int num_circle_samples);
+    std::string DescribeBox(float width, float height, float depth);
+
+} // namespace game
+
+#endif // MESH_GENERATOR_H_
@@ -0,0 +1,239 @@
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+#include "mesh_optimizer.h"
+
+namespace game {
+
+// Parameters of the Forsyth vertex scoring
+const int forsyth_cache_size_g = 32; // Modelled LRU cache size
+const float forsyth_decay_power_g = 1.5f; // Falloff of the score with the cache position
+const float forsyth_last_tri_score_g = 0.75f; // Score of the vertices of the last triangle
+const float forsyth_valence_scale_g = 2.0f; // Boost of vertices with few remaining triangles
+const float forsyth_valence_power_g = 0.5f;
+
+
+void WeldVertices(std::vector<unsigned char> &vertex, GLsizei stride, GLsizei key_size, std::vector<GLuint> &index){
+
+    const GLuint vertex_num = (GLuint) (vertex.size() / stride);
+
+    // Map every vertex to the first vertex with the same key
+    std::unordered_map<std::string, GLuint> unique;
+    std::vector<GLuint> remap(vertex_num);
+    std::vector<unsigned char> welded;
+    welded.reserve(vertex.size());
+    for (GLuint i = 0; i < vertex_num; i++){
+        const unsigned char *v = vertex.data() + i * stride;
+        std::string key((const char *) v, key_size);
+        auto found = unique.find(key);
+        if (found != unique.end()){
+            remap[i] = found->second;
+        }
+        else {
+            GLuint new_index = (GLuint) unique.size();
+            unique[key] = new_index;
+            remap[i] = new_index;
+            welded.insert(welded.end(), v, v + stride);
+        }
+    }
+    vertex.swap(welded);
+
+    // Remap the triangles, dropping the ones that collapsed to a line or a point
+    size_t out = 0;
+    for (size_t t = 0; t + 2 < index.size(); t += 3){
+        GLuint a = remap[index[t]];
+        GLuint b = remap[index[t + 1]];
+        GLuint c = remap[index[t + 2]];
+        if (a == b || b == c || c == a){
+            continue;
+        }
+        index[out++] = a;
+        index[out++] = b;
+        index[out++] = c;
+    }
+    index.resize(out);
+}
+
+
+// Score of a vertex from its position in the modelled cache (-1: not cached)
+// and the number of triangles still to be emitted that use it
+static float VertexScore(int cache_position, int remaining_triangles){
+
+    if (remaining_triangles == 0){
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cache_position >= 0){
+        if (cache_position < 3){
+            // Vertices of the triangle just emitted: fixed score, so the strip does not
+            // simply continue from the newest edge
+            score = forsyth_last_tri_score_g;
+        }
+        else {
+            float scale = 1.0f / (forsyth_cache_size_g - 3);
+            score = pow(1.0f - (cache_position - 3) * scale, forsyth_decay_power_g);
+        }
+    }
+
+    // Finish off vertices with few triangles left, to avoid isolated triangles later
+    score += forsyth_valence_scale_g * pow((float) remaining_triangles, -forsyth_valence_power_g);
+    return score;
+}
+
+
+void OptimizeVertexCache(std::vector<GLuint> &index, GLuint vertex_num){
+
+    const size_t tri_num = index.size() / 3;
+    if (tri_num < 2){
+        return;
+    }
+
+    // Triangles using each vertex; the first remaining[v] entries are not emitted yet
+    std::vector<int> remaining(vertex_num, 0);
+    for (size_t i = 0; i < tri_num * 3; i++){
+        remaining[index[i]]++;
+    }
+    std::vector<size_t> offset(vertex_num + 1, 0);
+    for (GLuint v = 0; v < vertex_num; v++){
+        offset[v + 1] = offset[v] + remaining[v];
+    }
+    std::vector<GLuint> adjacency(tri_num * 3);
+    std::vector<size_t> fill(offset.begin(), offset.end() - 1);
+    for (size_t t = 0; t < tri_num; t++){
+        for (int k = 0; k < 3; k++){
+            adjacency[fill[index[t * 3 + k]]++] = (GLuint) t;
+        }
+    }
+
+    // Initial scores
+    std::vector<int> cache_position(vertex_num, -1);
+    std::vector<float> vertex_score(vertex_num);
+    for (GLuint v = 0; v < vertex_num; v++){
+        vertex_score[v] = VertexScore(-1, remaining[v]);
+    }
+    std::vector<float> triangle_score(tri_num);
+    std::vector<bool> emitted(tri_num, false);
+    for (size_t t = 0; t < tri_num; t++){
+        triangle_score[t] = vertex_score[index[t * 3]] + vertex_score[index[t * 3 + 1]] + vertex_score[index[t * 3 + 2]];
+    }
+
+    std::vector<GLuint> cache;
+    std::vector<GLuint> new_cache;
+    std::vector<GLuint> output;
+    output.reserve(tri_num * 3);
+
+    long best = -1;
+    for (size_t n = 0; n < tri_num; n++){
+
+        // No candidate around the cache: take the best remaining triangle
+        if (best < 0){
+            float best_score = -1.0f;
+            for (size_t t = 0; t < tri_num; t++){
+                if (!emitted[t] && triangle_score[t] > best_score){
+                    best_score = triangle_score[t];
+                    best = (long) t;
+                }
+            }
+        }
+
+        // Emit the triangle and take it out of the adjacency of its vertices
+        emitted[best] = true;
+        const GLuint *tri = &index[best * 3];
+        output.insert(output.end(), tri, tri + 3);
+        for (int k = 0; k < 3; k++){
+            GLuint v = tri[k];
+            GLuint *list = &adjacency[offset[v]];
+            for (int j = 0; j < remaining[v]; j++){
+                if (list[j] == (GLuint) best){
+                    list[j] = list[remaining[v] - 1];
+                    break;
+                }
+            }
+            remaining[v]--;
+        }
+
+        // Move its vertices to the front of the cache
+        new_cache.assign(tri, tri + 3);
+        for (size_t c = 0; c < cache.size(); c++){
+            if (cache[c] != tri[0] && cache[c] != tri[1] && cache[c] != tri[2]){
+                new_cache.push_back(cache[c]);
+            }
+        }
+        cache.swap(new_cache);
+
+        // Update the scores of the cached vertices and of the ones pushed out
+        for (size_t c = 0; c < cache.size(); c++){
+            GLuint v = cache[c];
+            cache_position[v] = (c < (size_t) forsyth_cache_size_g) ? (int) c : -1;
+            vertex_score[v] = VertexScore(cache_position[v], remaining[v]);
+        }
+
+        // Rescore the triangles around those vertices; the next triangle is the best one
+        // that uses a cached vertex
+        best = -1;
+        float best_score = -1.0f;
+        for (size_t c = 0; c < cache.size(); c++){
+            GLuint v = cache[c];
+            for (int j = 0; j < remaining[v]; j++){
+                GLuint t = adjacency[offset[v] + j];
+                float score = vertex_score[index[t * 3]] + vertex_score[index[t * 3 + 1]] + vertex_score[index[t * 3 + 2]];
+                triangle_score[t] = score;
+                if (cache_position[v] >= 0 && score > best_score){
+                    best_score = score;
+                    best = (long) t;
+                }
+            }
+        }
+        if (cache.size() > (size_t) forsyth_cache_size_g){
+            cache.resize(forsyth_cache_size_g);
+        }
+    }
+
+    index.swap(output);
+}
+
+
+void OptimizeVertexFetch(std::vector<unsigned char> &vertex, GLsizei stride, std::vector<GLuint> &index){
+
+    const GLuint vertex_num = (GLuint) (vertex.size() / stride);
+    const GLuint unused = (GLuint) -1;
+
+    // Number the vertices by first use; unreferenced vertices are dropped
+    std::vector<GLuint> remap(vertex_num, unused);
+    std::vector<unsigned char> ordered;
+    ordered.reserve(vertex.size());
+    GLuint next = 0;
+    for (size_t i = 0; i < index.size(); i++){
+        GLuint v = index[i];
+        if (remap[v] == unused){
+            remap[v] = next++;
+            ordered.insert(ordered.end(), vertex.begin() + v * stride, vertex.begin() + (v + 1) * stride);
+        }
+        index[i] = remap[v];
+    }
+    vertex.swap(ordered);
+}
+
+
+float ComputeACMR(const std::vector<GLuint> &index, GLuint vertex_num, int cache_size){
+
+    if (index.size() < 3){
+        return 0.0f;
+    }
+
+    // A vertex is in the FIFO while fewer than cache_size misses followed its own
+    std::vector<long> miss_time(vertex_num, -(long) cache_size - 1);
+    long misses = 0;
+    for (size_t i = 0; i < index.size(); i++){
+        GLuint v = index[i];
+        if (misses - miss_time[v] >= cache_size){
+            miss_time[v] = ++misses;
+        }
+    }
+    return (float) misses / (float) (index.size() / 3);
+}
+
+} // namespace game
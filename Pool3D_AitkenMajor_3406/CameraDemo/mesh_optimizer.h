@@ -0,0 +1,32 @@
+#ifndef MESH_OPTIMIZER_H_
+#define MESH_OPTIMIZER_H_
+
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+namespace game {
+
+    // Post-processing of indexed triangle meshes before they are uploaded.
+    // Vertices are opaque blocks of 'stride' bytes; indices are triangle lists
+
+    // Merge vertices whose first 'key_size' bytes are identical and drop the
+    // triangles that become degenerate
+    void WeldVertices(std::vector<unsigned char> &vertex, GLsizei stride, GLsizei key_size, std::vector<GLuint> &index);
+
+    // Reorder triangles so consecutive triangles reuse recently transformed
+    // vertices (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+    void OptimizeVertexCache(std::vector<GLuint> &index, GLuint vertex_num);
+
+    // Reorder vertices in the order they are first referenced, so the
+    // vertex fetch walks memory sequentially
+    void OptimizeVertexFetch(std::vector<unsigned char> &vertex, GLsizei stride, std::vector<GLuint> &index);
+
+    // Average cache miss ratio: vertices transformed per triangle with a FIFO
+    // post-transform cache of 'cache_size' entries (0.5 is ideal, 3 is no reuse)
+    float ComputeACMR(const std::vector<GLuint> &index, GLuint vertex_num, int cache_size = 16);
+
+} // namespace game
+
+#endif // MESH_OPTIMIZER_H_
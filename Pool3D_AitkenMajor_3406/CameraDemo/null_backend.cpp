@@ -0,0 +1,508 @@
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+#include <fstream>
+
+#include "null_backend.h"
+
+namespace game {
+
+// Hash of uploaded data in the record (FNV-1a)
+static unsigned long long HashBytes(const void *data, size_t size){
+
+    unsigned long long hash = 0xcbf29ce484222325ULL;
+    const unsigned char *byte = (const unsigned char *) data;
+    for (size_t i = 0; i < size; i++){
+        hash = (hash ^ byte[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+
+NullBackend::NullBackend(void){
+
+    recording_ = false;
+    supported_[MultiDrawIndirectFeature] = true;
+    supported_[BufferStorageFeature] = false;
+    supported_[SyncFeature] = true;
+    supported_[TimerQueryFeature] = false;
+    next_buffer_ = 1;
+    next_fence_ = 1;
+    next_query_ = 1;
+    ResetCounters();
+}
+
+
+NullBackend::~NullBackend(){
+}
+
+
+void NullBackend::SetSupported(BackendFeature feature, bool supported){
+
+    supported_[feature] = supported;
+}
+
+
+const BackendCounters &NullBackend::GetCounters(void) const {
+
+    return counters_;
+}
+
+
+void NullBackend::ResetCounters(void){
+
+    std::memset(&counters_, 0, sizeof(counters_));
+}
+
+
+bool NullBackend::Count(bool state_change){
+
+    counters_.calls++;
+    if (state_change){
+        counters_.state_changes++;
+    }
+    return recording_;
+}
+
+
+void NullBackend::Record(const char *format, ...){
+
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    record_ += line;
+    record_ += '\n';
+}
+
+
+std::vector<unsigned char> &NullBackend::GetBound(GLenum target, size_t end){
+
+    std::vector<unsigned char> &data = buffer_[binding_[target]];
+    if (data.size() < end){
+        data.resize(end);
+    }
+    return data;
+}
+
+
+const char *NullBackend::TargetName(GLenum target){
+
+    switch (target){
+        case GL_ARRAY_BUFFER: return "ARRAY_BUFFER";
+        case GL_ELEMENT_ARRAY_BUFFER: return "ELEMENT_ARRAY_BUFFER";
+        case GL_DRAW_INDIRECT_BUFFER: return "DRAW_INDIRECT_BUFFER";
+        case GL_COPY_READ_BUFFER: return "COPY_READ_BUFFER";
+        case GL_COPY_WRITE_BUFFER: return "COPY_WRITE_BUFFER";
+        default: return "BUFFER";
+    }
+}
+
+
+std::string NullBackend::AttributeName(GLuint location) const {
+
+    if (location / 4 >= attribute_name_.size()){
+        return std::to_string(location);
+    }
+    std::string name = attribute_name_[location / 4];
+    if (location % 4){
+        name += "+" + std::to_string(location % 4);
+    }
+    return name;
+}
+
+
+std::string NullBackend::UniformName(GLint location) const {
+
+    if (location < 0 || location >= (GLint) uniform_name_.size()){
+        return std::to_string(location);
+    }
+    return uniform_name_[location];
+}
+
+
+bool NullBackend::Supports(BackendFeature feature) const {
+
+    return supported_[feature];
+}
+
+
+void NullBackend::Clear(const glm::vec4 &color){
+
+    if (Count(false)){
+        Record("Clear %g %g %g %g", color.x, color.y, color.z, color.w);
+    }
+}
+
+
+void NullBackend::SetBlending(bool enable){
+
+    if (Count(true)){
+        Record("Blending %s", enable ? "on" : "off");
+    }
+}
+
+
+void NullBackend::SetViewport(GLint x, GLint y, GLsizei width, GLsizei height){
+
+    if (Count(true)){
+        Record("Viewport %d %d %d %d", x, y, width, height);
+    }
+}
+
+
+void NullBackend::UseProgram(GLuint program){
+
+    counters_.program_binds++;
+    if (Count(true)){
+        Record("UseProgram %u", program);
+    }
+}
+
+
+GLint NullBackend::GetUniformLocation(GLuint program, const char *name){
+
+    auto found = uniform_location_.emplace(name, (GLint) uniform_name_.size());
+    if (found.second){
+        uniform_name_.push_back(name);
+    }
+    if (Count(false)){
+        Record("GetUniformLocation %u %s", program, name);
+    }
+    return found.first->second;
+}
+
+
+GLint NullBackend::GetAttribLocation(GLuint program, const char *name){
+
+    auto found = attribute_location_.emplace(name, (GLint) attribute_name_.size() * 4);
+    if (found.second){
+        attribute_name_.push_back(name);
+    }
+    if (Count(false)){
+        Record("GetAttribLocation %u %s", program, name);
+    }
+    return found.first->second;
+}
+
+
+void NullBackend::SetUniform(GLint location, float value){
+
+    if (Count(true)){
+        Record("Uniform %s %g", UniformName(location).c_str(), value);
+    }
+}
+
+
+void NullBackend::SetUniform(GLint location, const glm::vec3 &value){
+
+    if (Count(true)){
+        Record("Uniform %s %g %g %g", UniformName(location).c_str(), value.x, value.y, value.z);
+    }
+}
+
+
+void NullBackend::SetUniform(GLint location, const glm::mat4 &value){
+
+    if (Count(true)){
+        Record("Uniform %s %g %g %g %g  %g %g %g %g  %g %g %g %g  %g %g %g %g", UniformName(location).c_str(),
+            value[0][0], value[0][1], value[0][2], value[0][3], value[1][0], value[1][1], value[1][2], value[1][3],
+            value[2][0], value[2][1], value[2][2], value[2][3], value[3][0], value[3][1], value[3][2], value[3][3]);
+    }
+}
+
+
+GLuint NullBackend::CreateBuffer(void){
+
+    GLuint buffer = next_buffer_++;
+    buffer_[buffer];
+    if (Count(false)){
+        Record("CreateBuffer %u", buffer);
+    }
+    return buffer;
+}
+
+
+void NullBackend::DeleteBuffer(GLuint buffer){
+
+    buffer_.erase(buffer);
+    if (Count(false)){
+        Record("DeleteBuffer %u", buffer);
+    }
+}
+
+
+void NullBackend::BindBuffer(GLenum target, GLuint buffer){
+
+    binding_[target] = buffer;
+    counters_.buffer_binds++;
+    if (Count(true)){
+        Record("BindBuffer %s %u", TargetName(target), buffer);
+    }
+}
+
+
+void NullBackend::BufferData(GLenum target, GLsizeiptr size, const void *data, GLenum /* usage */){
+
+    std::vector<unsigned char> &contents = GetBound(target, 0);
+    contents.assign(size, 0);
+    if (data){
+        std::memcpy(contents.data(), data, size);
+        counters_.uploaded_bytes += size;
+    }
+    if (Count(false)){
+        Record("BufferData %s %ld %016llx", TargetName(target), (long) size, data ? HashBytes(data, size) : 0ULL);
+    }
+}
+
+
+void NullBackend::BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data){
+
+    std::vector<unsigned char> &contents = GetBound(target, offset + size);
+    std::memcpy(contents.data() + offset, data, size);
+    counters_.uploaded_bytes += size;
+    if (Count(false)){
+        Record("BufferSubData %s %ld %ld %016llx", TargetName(target), (long) offset, (long) size, HashBytes(data, size));
+    }
+}
+
+
+void NullBackend::CopyBufferSubData(GLenum read_target, GLenum write_target, GLintptr read_offset, GLintptr write_offset, GLsizeiptr size){
+
+    // Data stays on the GPU, so it is not counted as uploaded
+    std::vector<unsigned char> &source = GetBound(read_target, read_offset + size);
+    std::vector<unsigned char> &destination = GetBound(write_target, write_offset + size);
+    std::memmove(destination.data() + write_offset, source.data() + read_offset, size);
+    if (Count(false)){
+        Record("CopyBufferSubData %s %s %ld %ld %ld", TargetName(read_target), TargetName(write_target), (long) read_offset, (long) write_offset, (long) size);
+    }
+}
+
+
+void NullBackend::BufferStorage(GLenum target, GLsizeiptr size, GLbitfield flags){
+
+    GetBound(target, 0).assign(size, 0);
+    if (Count(false)){
+        Record("BufferStorage %s %ld %x", TargetName(target), (long) size, flags);
+    }
+}
+
+
+void *NullBackend::MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr size, GLbitfield access){
+
+    std::vector<unsigned char> &contents = GetBound(target, offset + size);
+    MappedRange range = { offset, size };
+    mapped_[target] = range;
+    if (access & GL_MAP_WRITE_BIT){
+        counters_.uploaded_bytes += size;
+    }
+    if (Count(false)){
+        Record("MapBufferRange %s %ld %ld %x", TargetName(target), (long) offset, (long) size, access);
+    }
+    return contents.data() + offset;
+}
+
+
+void NullBackend::UnmapBuffer(GLenum target){
+
+    MappedRange range = mapped_[target];
+    mapped_.erase(target);
+    if (Count(false)){
+        // The data written through the mapping
+        std::vector<unsigned char> &contents = GetBound(target, range.offset + range.size);
+        Record("UnmapBuffer %s %016llx", TargetName(target), HashBytes(contents.data() + range.offset, range.size));
+    }
+}
+
+
+GLsync NullBackend::FenceSync(void){
+
+    GLsync fence = (GLsync) next_fence_++;
+    if (Count(false)){
+        Record("FenceSync %lu", (unsigned long) (uintptr_t) fence);
+    }
+    return fence;
+}
+
+
+bool NullBackend::WaitSync(GLsync fence, GLuint64 /* timeout */){
+
+    if (Count(false)){
+        Record("WaitSync %lu", (unsigned long) (uintptr_t) fence);
+    }
+    return true;
+}
+
+
+void NullBackend::DeleteSync(GLsync fence){
+
+    if (Count(false)){
+        Record("DeleteSync %lu", (unsigned long) (uintptr_t) fence);
+    }
+}
+
+
+GLuint NullBackend::CreateQuery(void){
+
+    GLuint query = next_query_++;
+    query_[query] = 0;
+    if (Count(false)){
+        Record("CreateQuery %u", query);
+    }
+    return query;
+}
+
+
+void NullBackend::DeleteQuery(GLuint query){
+
+    query_.erase(query);
+    if (Count(false)){
+        Record("DeleteQuery %u", query);
+    }
+}
+
+
+void NullBackend::QueryTimestamp(GLuint query){
+
+    query_[query] = GetTimestamp();
+    if (Count(false)){
+        Record("QueryTimestamp %u", query);
+    }
+}
+
+
+bool NullBackend::GetQueryResult(GLuint query, GLuint64 &result, bool /* wait */){
+
+    result = query_[query];
+    return true;
+}
+
+
+GLuint64 NullBackend::GetTimestamp(void){
+
+    return (GLuint64) counters_.calls * 1000;
+}
+
+
+void NullBackend::VertexAttribPointer(GLuint location, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLintptr offset){
+
+    if (Count(true)){
+        Record("VertexAttribPointer %s %d %x %d %d %ld", AttributeName(location).c_str(), size, type, normalized, stride, (long) offset);
+    }
+}
+
+
+void NullBackend::EnableVertexAttribArray(GLuint location){
+
+    if (Count(true)){
+        Record("EnableVertexAttribArray %s", AttributeName(location).c_str());
+    }
+}
+
+
+void NullBackend::DisableVertexAttribArray(GLuint location){
+
+    if (Count(true)){
+        Record("DisableVertexAttribArray %s", AttributeName(location).c_str());
+    }
+}
+
+
+void NullBackend::VertexAttribDivisor(GLuint location, GLuint divisor){
+
+    if (Count(true)){
+        Record("VertexAttribDivisor %s %u", AttributeName(location).c_str(), divisor);
+    }
+}
+
+
+void NullBackend::VertexAttrib(GLuint location, const glm::vec4 &value){
+
+    if (Count(true)){
+        Record("VertexAttrib %s %g %g %g %g", AttributeName(location).c_str(), value.x, value.y, value.z, value.w);
+    }
+}
+
+
+void NullBackend::DrawArrays(GLenum mode, GLint first, GLsizei count){
+
+    counters_.draws++;
+    counters_.commands++;
+    if (Count(false)){
+        Record("DrawArrays %x %d %d", mode, first, count);
+    }
+}
+
+
+void NullBackend::DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instance_count, GLuint base_instance){
+
+    counters_.draws++;
+    counters_.commands++;
+    if (Count(false)){
+        Record("DrawArraysInstanced %x %d %d %d %u", mode, first, count, instance_count, base_instance);
+    }
+}
+
+
+void NullBackend::DrawElements(GLenum mode, GLsizei count, GLenum type, GLintptr offset){
+
+    counters_.draws++;
+    counters_.commands++;
+    counters_.indices += count;
+    if (Count(false)){
+        Record("DrawElements %x %d %x %ld", mode, count, type, (long) offset);
+    }
+}
+
+
+void NullBackend::MultiDrawElementsIndirect(GLenum mode, GLenum type, GLintptr offset, GLsizei draw_count){
+
+    // Commands of five GLuint: count, instance count, first index, base vertex, base instance
+    const size_t command_size = 5 * sizeof(GLuint);
+    std::vector<unsigned char> &contents = GetBound(GL_DRAW_INDIRECT_BUFFER, offset + draw_count * command_size);
+    bool record = Count(false);
+    if (record){
+        Record("MultiDrawElementsIndirect %x %x %ld %d", mode, type, (long) offset, draw_count);
+    }
+    for (GLsizei i = 0; i < draw_count; i++){
+        GLuint command[5];
+        std::memcpy(command, contents.data() + offset + i * command_size, command_size);
+        counters_.indices += (size_t) command[0] * command[1];
+        if (record){
+            Record("  %u %u %u %d %u", command[0], command[1], command[2], (GLint) command[3], command[4]);
+        }
+    }
+    counters_.draws++;
+    counters_.commands += draw_count;
+}
+
+
+RecordingBackend::RecordingBackend(void){
+
+    recording_ = true;
+}
+
+
+const std::string &RecordingBackend::GetRecording(void) const {
+
+    return record_;
+}
+
+
+void RecordingBackend::ClearRecording(void){
+
+    record_.clear();
+}
+
+
+void RecordingBackend::SaveRecording(const std::string &filename) const {
+
+    std::ofstream f(filename.c_str());
+    if (f.fail()){
+        throw(std::ios_base::failure(std::string("Error opening file ")+filename));
+    }
+    f << record_;
+}
+
+} // namespace game
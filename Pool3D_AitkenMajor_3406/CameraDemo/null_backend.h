@@ -0,0 +1,145 @@
+#ifndef NULL_BACKEND_H_
+#define NULL_BACKEND_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "render_backend.h"
+
+namespace game {
+
+    // Work submitted to a NullBackend since its counters were reset
+    struct BackendCounters {
+        int calls; // All commands
+        int draws; // Draw calls (a multi-draw call counts once)
+        int commands; // Meshes drawn (a multi-draw call draws several)
+        size_t indices; // Indices read by indexed draws
+        int state_changes; // Program, buffer, blending, attribute and uniform changes
+        int program_binds;
+        int buffer_binds;
+        size_t uploaded_bytes; // Data given to buffers, and buffer ranges mapped for writing
+    };
+
+    // Backend that executes nothing and needs no GL context: it counts the commands,
+    // and keeps buffer contents in memory so mapped writes and indirect draws work.
+    // Locations are made up per name. By default it reports multi-draw indirect and
+    // fences but no buffer storage, so streamed data is mapped (and counted) per allocation,
+    // and no timer queries (when enabled, the GPU clock advances one microsecond per command)
+    class NullBackend : public RenderBackend {
+
+        public:
+            NullBackend(void);
+            ~NullBackend();
+
+            // Choose the features reported, to exercise each path of the renderer
+            void SetSupported(BackendFeature feature, bool supported);
+            const BackendCounters &GetCounters(void) const;
+            void ResetCounters(void);
+
+            bool Supports(BackendFeature feature) const;
+
+            void Clear(const glm::vec4 &color);
+            void SetBlending(bool enable);
+            void SetViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+            void UseProgram(GLuint program);
+            GLint GetUniformLocation(GLuint program, const char *name);
+            GLint GetAttribLocation(GLuint program, const char *name);
+            void SetUniform(GLint location, float value);
+            void SetUniform(GLint location, const glm::vec3 &value);
+            void SetUniform(GLint location, const glm::mat4 &value);
+
+            GLuint CreateBuffer(void);
+            void DeleteBuffer(GLuint buffer);
+            void BindBuffer(GLenum target, GLuint buffer);
+            void BufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+            void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data);
+            void CopyBufferSubData(GLenum read_target, GLenum write_target, GLintptr read_offset, GLintptr write_offset, GLsizeiptr size);
+            void BufferStorage(GLenum target, GLsizeiptr size, GLbitfield flags);
+            void *MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr size, GLbitfield access);
+            void UnmapBuffer(GLenum target);
+
+            GLsync FenceSync(void);
+            bool WaitSync(GLsync fence, GLuint64 timeout);
+            void DeleteSync(GLsync fence);
+
+            GLuint CreateQuery(void);
+            void DeleteQuery(GLuint query);
+            void QueryTimestamp(GLuint query);
+            bool GetQueryResult(GLuint query, GLuint64 &result, bool wait);
+            GLuint64 GetTimestamp(void);
+
+            void VertexAttribPointer(GLuint location, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLintptr offset);
+            void EnableVertexAttribArray(GLuint location);
+            void DisableVertexAttribArray(GLuint location);
+            void VertexAttribDivisor(GLuint location, GLuint divisor);
+            void VertexAttrib(GLuint location, const glm::vec4 &value);
+
+            void DrawArrays(GLenum mode, GLint first, GLsizei count);
+            void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instance_count, GLuint base_instance);
+            void DrawElements(GLenum mode, GLsizei count, GLenum type, GLintptr offset);
+            void MultiDrawElementsIndirect(GLenum mode, GLenum type, GLintptr offset, GLsizei draw_count);
+
+        protected:
+            // Commands are also written to record_, one per line (see RecordingBackend)
+            bool recording_;
+            std::string record_;
+
+        private:
+            bool supported_[NumFeatures];
+            BackendCounters counters_;
+
+            // Buffer contents, the buffer bound to each target and the range mapped on it
+            std::unordered_map<GLuint, std::vector<unsigned char> > buffer_;
+            std::unordered_map<GLenum, GLuint> binding_;
+            struct MappedRange {
+                GLintptr offset;
+                GLsizeiptr size;
+            };
+            std::unordered_map<GLenum, MappedRange> mapped_;
+            GLuint next_buffer_;
+            uintptr_t next_fence_;
+            std::unordered_map<GLuint, GLuint64> query_; // Timestamp of each query
+            GLuint next_query_;
+
+            // Made-up locations: each uniform name gets one, each attribute name four
+            // (a matrix attribute takes consecutive locations)
+            std::unordered_map<std::string, GLint> uniform_location_;
+            std::unordered_map<std::string, GLint> attribute_location_;
+            std::vector<std::string> uniform_name_;
+            std::vector<std::string> attribute_name_;
+
+            // Count a command; returns true if it must be recorded
+            bool Count(bool state_change);
+            // Append a line to record_
+            void Record(const char *format, ...);
+            // Contents of the buffer bound to 'target', grown to hold 'end' bytes
+            std::vector<unsigned char> &GetBound(GLenum target, size_t end);
+            // Names for the record
+            static const char *TargetName(GLenum target);
+            std::string AttributeName(GLuint location) const;
+            std::string UniformName(GLint location) const;
+
+    }; // class NullBackend
+
+    // Null backend that also writes the command stream as text, one command per line,
+    // with hashes of the data uploaded. Two recordings of a frame can be diffed to see
+    // how a change to the renderer affects what it submits
+    class RecordingBackend : public NullBackend {
+
+        public:
+            RecordingBackend(void);
+
+            // Commands recorded since the last ClearRecording
+            const std::string &GetRecording(void) const;
+            void ClearRecording(void);
+            // Write the recording to a file (throws std::ios_base::failure)
+            void SaveRecording(const std::string &filename) const;
+
+    }; // class RecordingBackend
+
+} // namespace game
+
+#endif // NULL_BACKEND_H_
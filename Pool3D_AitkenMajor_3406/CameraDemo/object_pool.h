@@ -0,0 +1,152 @@
+#ifndef OBJECT_POOL_H_
+#define OBJECT_POOL_H_
+
+#include <vector>
+#include <utility>
+#include <new>
+
+namespace game {
+
+    // Reference to an object of an ObjectPool<T>. The generation tells a live object
+    // apart from a newer one created in the same slot; generation 0 is the null handle
+    template <typename T>
+    struct Handle {
+        unsigned index;
+        unsigned generation;
+
+        Handle(void) : index(0), generation(0) {}
+        Handle(unsigned i, unsigned g) : index(i), generation(g) {}
+        bool IsNull(void) const { return generation == 0; }
+        bool operator==(const Handle& other) const { return index == other.index && generation == other.generation; }
+        bool operator!=(const Handle& other) const { return !(*this == other); }
+    };
+
+    // Objects of type T stored in fixed blocks of BlockSize slots. Blocks are never moved,
+    // so pointers stay valid until the object is destroyed, and freed slots are reused
+    template <typename T, unsigned BlockSize = 64>
+    class ObjectPool {
+
+        private:
+            struct Slot {
+                alignas(T) unsigned char storage[sizeof(T)]; // First member: a T* is also a Slot*
+                unsigned generation; // Incremented when the object is destroyed
+                unsigned next_free; // Next slot of the free list
+                bool live;
+            };
+
+            std::vector<Slot *> block_;
+            unsigned free_; // First free slot (no_slot: none)
+            unsigned size_; // Number of live objects
+            unsigned slot_num_; // Number of slots in use or freed
+
+            static const unsigned no_slot = (unsigned) -1;
+
+            Slot &GetSlot(unsigned index) const { return block_[index / BlockSize][index % BlockSize]; }
+            static T *GetObject(Slot &slot) { return reinterpret_cast<T *>(slot.storage); }
+
+            // Copying would duplicate ownership of the objects
+            ObjectPool(const ObjectPool &);
+            ObjectPool &operator=(const ObjectPool &);
+
+        public:
+            ObjectPool(void) : free_(no_slot), size_(0), slot_num_(0) {}
+
+            ~ObjectPool() {
+                Clear();
+                for (Slot *block : block_) {
+                    delete[] block;
+                }
+            }
+
+            // Construct an object in a free slot
+            template <typename... Args>
+            Handle<T> Create(Args&&... args) {
+                unsigned index;
+                if (free_ != no_slot) {
+                    index = free_;
+                }
+                else {
+                    if (slot_num_ == block_.size() * BlockSize) {
+                        Slot *block = new Slot[BlockSize];
+                        for (unsigned i = 0; i < BlockSize; i++) {
+                            block[i].generation = 1;
+                            block[i].live = false;
+                        }
+                        block_.push_back(block);
+                    }
+                    index = slot_num_;
+                }
+
+                // Constructors may throw: the slot is only taken once the object exists
+                Slot &slot = GetSlot(index);
+                new (slot.storage) T(std::forward<Args>(args)...);
+                if (index == free_) {
+                    free_ = slot.next_free;
+                }
+                else {
+                    slot_num_++;
+                }
+                slot.live = true;
+                size_++;
+                return Handle<T>(index, slot.generation);
+            }
+
+            // Object referenced by 'handle' (null if it was destroyed)
+            T *Get(Handle<T> handle) const {
+                if (handle.IsNull() || handle.index >= slot_num_) return nullptr;
+                Slot &slot = GetSlot(handle.index);
+                if (!slot.live || slot.generation != handle.generation) return nullptr;
+                return GetObject(slot);
+            }
+
+            // Handle of an object created by this pool
+            Handle<T> GetHandle(const T *object) const {
+                const Slot *slot = reinterpret_cast<const Slot *>(object);
+                for (unsigned b = 0; b < block_.size(); b++) {
+                    if (slot >= block_[b] && slot < block_[b] + BlockSize) {
+                        return Handle<T>(b * BlockSize + (unsigned) (slot - block_[b]), slot->generation);
+                    }
+                }
+                return Handle<T>();
+            }
+
+            // Destroy the object; handles to it become stale
+            void Destroy(Handle<T> handle) {
+                if (!Get(handle)) return;
+                Slot &slot = GetSlot(handle.index);
+                GetObject(slot)->~T();
+                slot.live = false;
+                slot.generation = (slot.generation + 1) ? slot.generation + 1 : 1;
+                slot.next_free = free_;
+                free_ = handle.index;
+                size_--;
+            }
+
+            // Destroy all objects (the blocks are kept)
+            void Clear(void) {
+                for (unsigned i = 0; i < slot_num_; i++) {
+                    Slot &slot = GetSlot(i);
+                    if (slot.live) {
+                        Destroy(Handle<T>(i, slot.generation));
+                    }
+                }
+            }
+
+            // Call f(T&) on the live objects, in memory order
+            template <typename F>
+            void ForEach(F f) const {
+                for (unsigned i = 0; i < slot_num_; i++) {
+                    Slot &slot = GetSlot(i);
+                    if (slot.live) {
+                        f(*GetObject(slot));
+                    }
+                }
+            }
+
+            unsigned Size(void) const { return size_; }
+
+    }; // class ObjectPool
+
+} // namespace game
+
+#endif // OBJECT_POOL_H_
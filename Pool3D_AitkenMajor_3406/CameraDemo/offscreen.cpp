@@ -0,0 +1,258 @@
+#include <stdexcept>
+#include <fstream>
+#ifdef HAVE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include "offscreen.h"
+
+namespace game {
+
+// Frames a GPU time may lag behind before collecting it waits
+const int gpu_timer_queries_g = 4;
+
+
+OffscreenContext::OffscreenContext(void){
+
+    display_ = NULL;
+    context_ = NULL;
+}
+
+
+OffscreenContext::~OffscreenContext(){
+}
+
+
+void OffscreenContext::Create(void){
+
+#ifdef HAVE_EGL
+    // Surfaceless platform: no window system needed. Fall back to the default display
+    EGLDisplay display = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (get_platform_display){
+        display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    if (display == EGL_NO_DISPLAY){
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)){
+        throw(std::runtime_error(std::string("Could not initialize EGL")));
+    }
+
+    // Desktop OpenGL with the compatibility profile, like the windowed context
+    const EGLint config_attributes[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig config = NULL;
+    EGLint config_num = 0;
+    eglChooseConfig(display, config_attributes, &config, 1, &config_num);
+    eglBindAPI(EGL_OPENGL_API);
+    EGLContext context = eglCreateContext(display, (config_num > 0) ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, NULL);
+    if (context == EGL_NO_CONTEXT){
+        eglTerminate(display);
+        throw(std::runtime_error(std::string("Could not create an EGL context")));
+    }
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)){
+        eglDestroyContext(display, context);
+        eglTerminate(display);
+        throw(std::runtime_error(std::string("Could not make the EGL context current (no surfaceless support)")));
+    }
+    display_ = display;
+    context_ = context;
+#else
+    throw(std::runtime_error(std::string("Headless mode needs a build with EGL")));
+#endif
+}
+
+
+void OffscreenContext::Destroy(void){
+
+#ifdef HAVE_EGL
+    if (context_){
+        eglMakeCurrent((EGLDisplay) display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext((EGLDisplay) display_, (EGLContext) context_);
+        eglTerminate((EGLDisplay) display_);
+    }
+#endif
+    display_ = NULL;
+    context_ = NULL;
+}
+
+
+bool OffscreenContext::IsCreated(void) const {
+
+    return context_ != NULL;
+}
+
+
+OffscreenTarget::OffscreenTarget(void){
+
+    framebuffer_ = 0;
+    color_buffer_ = 0;
+    depth_buffer_ = 0;
+    width_ = 0;
+    height_ = 0;
+}
+
+
+OffscreenTarget::~OffscreenTarget(){
+}
+
+
+void OffscreenTarget::Create(int width, int height){
+
+    width_ = width;
+    height_ = height;
+
+    glGenRenderbuffers(1, &color_buffer_);
+    glBindRenderbuffer(GL_RENDERBUFFER, color_buffer_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &depth_buffer_);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth_buffer_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+    glGenFramebuffers(1, &framebuffer_);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_buffer_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_buffer_);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE){
+        throw(std::runtime_error(std::string("Incomplete offscreen framebuffer")));
+    }
+}
+
+
+void OffscreenTarget::Destroy(void){
+
+    if (framebuffer_){
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &framebuffer_);
+        glDeleteRenderbuffers(1, &color_buffer_);
+        glDeleteRenderbuffers(1, &depth_buffer_);
+    }
+    framebuffer_ = 0;
+    color_buffer_ = 0;
+    depth_buffer_ = 0;
+}
+
+
+int OffscreenTarget::GetWidth(void) const {
+
+    return width_;
+}
+
+
+int OffscreenTarget::GetHeight(void) const {
+
+    return height_;
+}
+
+
+void OffscreenTarget::ReadPixels(std::vector<unsigned char> &rgba) const {
+
+    rgba.resize((size_t) width_ * height_ * 4);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_);
+    glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+}
+
+
+GpuTimer::GpuTimer(void){
+
+    first_ = 0;
+    count_ = 0;
+}
+
+
+GpuTimer::~GpuTimer(){
+
+    if (!query_.empty()){
+        glDeleteQueries((GLsizei) query_.size(), query_.data());
+    }
+}
+
+
+// Timer queries are core in OpenGL 3.3
+static bool HasTimerQueries(void){
+
+    return GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+}
+
+
+void GpuTimer::Begin(void){
+
+    if (!HasTimerQueries()){
+        return;
+    }
+    if (query_.empty()){
+        query_.resize(gpu_timer_queries_g);
+        glGenQueries((GLsizei) query_.size(), query_.data());
+    }
+
+    // All queries in flight: wait for the oldest and keep its time for Collect
+    if (count_ == (int) query_.size()){
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(query_[first_], GL_QUERY_RESULT, &elapsed);
+        ready_.push_back(elapsed * 1e-9);
+        first_ = (first_ + 1) % query_.size();
+        count_--;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, query_[(first_ + count_) % query_.size()]);
+}
+
+
+void GpuTimer::End(void){
+
+    if (!HasTimerQueries()){
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    count_++;
+}
+
+
+void GpuTimer::Collect(std::vector<double> &time, bool wait){
+
+    time.insert(time.end(), ready_.begin(), ready_.end());
+    ready_.clear();
+    while (count_ > 0){
+        GLuint query = query_[first_];
+        if (!wait){
+            GLint available = 0;
+            glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available){
+                break;
+            }
+        }
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+        time.push_back(elapsed * 1e-9);
+        first_ = (first_ + 1) % query_.size();
+        count_--;
+    }
+}
+
+
+void WritePPM(const std::string &filename, int width, int height, const std::vector<unsigned char> &rgba){
+
+    std::ofstream f(filename.c_str(), std::ios::out | std::ios::binary);
+    if (f.fail()){
+        throw(std::ios_base::failure(std::string("Error opening file ")+filename));
+    }
+    f << "P6\n" << width << " " << height << "\n255\n";
+
+    // Images are stored top row first
+    std::vector<unsigned char> row(width * 3);
+    for (int y = height - 1; y >= 0; y--){
+        const unsigned char *src = rgba.data() + (size_t) y * width * 4;
+        for (int x = 0; x < width; x++){
+            row[x * 3] = src[x * 4];
+            row[x * 3 + 1] = src[x * 4 + 1];
+            row[x * 3 + 2] = src[x * 4 + 2];
+        }
+        f.write((const char *) row.data(), row.size());
+    }
+    if (!f){
+        throw(std::ios_base::failure(std::string("Error writing file ")+filename));
+    }
+}
+
+} // namespace game
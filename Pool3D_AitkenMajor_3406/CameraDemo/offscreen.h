@@ -0,0 +1,87 @@
+#ifndef OFFSCREEN_H_
+#define OFFSCREEN_H_
+
+#include <string>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+namespace game {
+
+    // GL context without a window or display: EGL on the surfaceless platform, which
+    // Mesa (including llvmpipe) provides on hosts without a GPU. Needs a build with EGL
+    class OffscreenContext {
+
+        public:
+            OffscreenContext(void);
+            ~OffscreenContext();
+
+            // Create the context and make it current (throws std::runtime_error)
+            void Create(void);
+            // Release the context (the destructor does not: call before exiting)
+            void Destroy(void);
+            bool IsCreated(void) const;
+
+        private:
+            void *display_; // EGLDisplay and EGLContext
+            void *context_;
+
+    }; // class OffscreenContext
+
+    // Framebuffer object with color and depth renderbuffers, to render without a window
+    class OffscreenTarget {
+
+        public:
+            OffscreenTarget(void);
+            ~OffscreenTarget();
+
+            // Create the framebuffer and bind it for drawing (throws std::runtime_error)
+            void Create(int width, int height);
+            // Delete the GL objects (needs the context)
+            void Destroy(void);
+            int GetWidth(void) const;
+            int GetHeight(void) const;
+            // RGBA pixels of the color buffer, bottom row first
+            void ReadPixels(std::vector<unsigned char> &rgba) const;
+
+        private:
+            GLuint framebuffer_;
+            GLuint color_buffer_;
+            GLuint depth_buffer_;
+            int width_;
+            int height_;
+
+    }; // class OffscreenTarget
+
+    // GPU time of frames from timer queries. Results are collected frames later, so
+    // measuring does not make the CPU wait for the GPU. Without timer queries (before
+    // OpenGL 3.3 and ARB_timer_query) no times are reported
+    class GpuTimer {
+
+        public:
+            GpuTimer(void);
+            ~GpuTimer();
+
+            // Time the GL commands between Begin and End (once per frame)
+            void Begin(void);
+            void End(void);
+            // Append the times (seconds) of the frames whose results are available;
+            // with 'wait', of all frames measured
+            void Collect(std::vector<double> &time, bool wait);
+
+        private:
+            std::vector<GLuint> query_; // Ring of queries
+            int first_; // Oldest query still to collect
+            int count_; // Queries issued and not collected
+            std::vector<double> ready_; // Times read by Begin, not yet collected
+
+    }; // class GpuTimer
+
+    // Write RGBA pixels (bottom row first) as a binary PPM image, for comparing frames
+    // against golden images (throws std::ios_base::failure)
+    void WritePPM(const std::string &filename, int width, int height, const std::vector<unsigned char> &rgba);
+
+} // namespace game
+
+#endif // OFFSCREEN_H_
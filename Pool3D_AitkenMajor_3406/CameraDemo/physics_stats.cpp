@@ -0,0 +1,139 @@
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#include "physics_stats.h"
+#include "profiler.h"
+
+namespace game {
+
+PhysicsStats::PhysicsStats(void){
+
+    sequence_ = 0;
+    Reset();
+}
+
+
+PhysicsStats::~PhysicsStats(){
+}
+
+
+void PhysicsStats::Reset(void){
+
+    BeginWrite();
+    std::memset(&published_, 0, sizeof(published_));
+    EndWrite();
+    std::memset(&counters_, 0, sizeof(counters_));
+    std::fill(window_, window_ + physics_window_steps_g, 0.0);
+    window_next_ = 0;
+    window_sum_ = 0.0;
+    step_start_ = 0;
+}
+
+
+void PhysicsStats::BeginStep(void){
+
+    std::memset(&counters_, 0, sizeof(counters_));
+    step_start_ = Profiler::Now();
+}
+
+
+PhysicsCounters &PhysicsStats::GetCounters(void){
+
+    return counters_;
+}
+
+
+void PhysicsStats::EndStep(void){
+
+    double duration = (Profiler::Now() - step_start_) * 1e-9;
+
+    // Window: the new duration replaces the oldest once the window is full
+    bool full = published_.window_steps == physics_window_steps_g;
+    double oldest = window_[window_next_];
+    window_[window_next_] = duration;
+    window_next_ = (window_next_ + 1) % physics_window_steps_g;
+    window_sum_ += duration - (full ? oldest : 0.0);
+    double window_max = std::max(published_.window_max, duration);
+    if (full && oldest >= published_.window_max){
+        // The longest step left the window
+        window_max = *std::max_element(window_, window_ + physics_window_steps_g);
+    }
+
+    BeginWrite();
+    published_.last = counters_;
+    PhysicsCounters &total = published_.total;
+    total.active_balls += counters_.active_balls;
+    total.sleeping_balls += counters_.sleeping_balls;
+    total.broadphase_pairs += counters_.broadphase_pairs;
+    total.narrowphase_tests += counters_.narrowphase_tests;
+    total.contacts_resolved += counters_.contacts_resolved;
+    total.wall_hits += counters_.wall_hits;
+    total.pocket_tests += counters_.pocket_tests;
+    total.respawn_attempts += counters_.respawn_attempts;
+    published_.steps++;
+    published_.last_duration = duration;
+    published_.max_duration = std::max(published_.max_duration, duration);
+    if (full){
+        published_.histogram[GetHistogramBin(oldest)]--;
+    }
+    else {
+        published_.window_steps++;
+    }
+    published_.histogram[GetHistogramBin(duration)]++;
+    published_.window_mean = window_sum_ / published_.window_steps;
+    published_.window_max = window_max;
+    EndWrite();
+}
+
+
+void PhysicsStats::EndFrame(int substeps){
+
+    BeginWrite();
+    published_.substeps = substeps;
+    EndWrite();
+}
+
+
+void PhysicsStats::BeginWrite(void){
+
+    sequence_.store(sequence_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+
+void PhysicsStats::EndWrite(void){
+
+    sequence_.store(sequence_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+
+void PhysicsStats::GetSnapshot(PhysicsSnapshot &snapshot) const {
+
+    uint32_t before, after;
+    do {
+        before = sequence_.load(std::memory_order_acquire);
+        std::memcpy(&snapshot, &published_, sizeof(snapshot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = sequence_.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
+
+
+int PhysicsStats::GetHistogramBin(double duration){
+
+    double microseconds = duration * 1e6;
+    if (microseconds < 2.0){
+        return 0;
+    }
+    int bin = (int) std::log2(microseconds);
+    return std::min(bin, physics_histogram_bins_g - 1);
+}
+
+
+double PhysicsStats::GetBinStart(int bin){
+
+    return bin == 0 ? 0.0 : std::ldexp(1e-6, bin);
+}
+
+} // namespace game
@@ -0,0 +1,90 @@
+#ifndef PHYSICS_STATS_H_
+#define PHYSICS_STATS_H_
+
+#include <cstdint>
+#include <atomic>
+
+namespace game {
+
+    // Bins of the step duration histogram: bin i counts steps of [2^i, 2^(i+1))
+    // microseconds; the first bin also counts shorter steps, the last longer ones
+    const int physics_histogram_bins_g = 16;
+    // Steps in the rolling window of the histogram (about 8.5 s at 120 Hz)
+    const int physics_window_steps_g = 1024;
+
+    // Work done by one physics step (64-bit, as the same struct holds the totals)
+    struct PhysicsCounters {
+        uint64_t active_balls; // In play and moving above the stop threshold
+        uint64_t sleeping_balls; // In play and at rest
+        uint64_t broadphase_pairs; // Pairs of balls in play
+        uint64_t narrowphase_tests; // Pairs whose bounding boxes overlap (distance computed)
+        uint64_t contacts_resolved; // Overlapping pairs pushed apart
+        uint64_t wall_hits; // Velocity components reflected by the walls
+        uint64_t pocket_tests; // Ball-pocket distance tests
+        uint64_t respawn_attempts; // Positions tried for the pocketed white ball
+    };
+
+    // State of the statistics at one time, copied out without allocating
+    struct PhysicsSnapshot {
+        PhysicsCounters last; // Latest step
+        PhysicsCounters total; // Sums over all steps since the reset
+        uint64_t steps; // Steps since the reset
+        int substeps; // Steps run in the latest frame
+        double last_duration; // Latest step (seconds)
+        double max_duration; // Longest step since the reset (seconds)
+        // Durations of the rolling window (the latest window_steps steps)
+        int window_steps;
+        double window_mean; // Seconds
+        double window_max; // Seconds
+        int histogram[physics_histogram_bins_g];
+    };
+
+    // Per-step physics counters and rolling histograms of step duration. The physics
+    // (one thread) fills the counters between BeginStep and EndStep; GetSnapshot can be
+    // polled from any thread at any rate: it copies a fixed-size snapshot published
+    // under a sequence counter, so neither side locks or allocates
+    class PhysicsStats {
+
+        public:
+            PhysicsStats(void);
+            ~PhysicsStats();
+
+            // Start a step: zero the counters and its timer
+            void BeginStep(void);
+            // Counters of the step in progress
+            PhysicsCounters &GetCounters(void);
+            // Finish the step and publish its counters and duration
+            void EndStep(void);
+            // Publish the number of steps run in the frame
+            void EndFrame(int substeps);
+            // Forget all steps
+            void Reset(void);
+
+            void GetSnapshot(PhysicsSnapshot &snapshot) const;
+
+            // Bin of a step duration (seconds), and the lower bound of a bin (seconds)
+            static int GetHistogramBin(double duration);
+            static double GetBinStart(int bin);
+
+        private:
+            PhysicsCounters counters_; // Step in progress
+            uint64_t step_start_;
+
+            // Durations of the window (a ring; the oldest is overwritten next)
+            double window_[physics_window_steps_g];
+            int window_next_;
+            double window_sum_;
+
+            // Odd while published_ is being written
+            std::atomic<uint32_t> sequence_;
+            PhysicsSnapshot published_;
+
+            // Bracket the changes to published_ (readers retry a copy made meanwhile)
+            void BeginWrite(void);
+            void EndWrite(void);
+
+    }; // class PhysicsStats
+
+} // namespace game
+
+#endif // PHYSICS_STATS_H_
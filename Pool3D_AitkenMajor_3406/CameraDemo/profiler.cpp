@@ -0,0 +1,305 @@
+#include <chrono>
+#include <mutex>
+#include <memory>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+
+#include "profiler.h"
+
+namespace game {
+
+// Zones kept per thread (a power of two)
+const size_t profile_ring_size_g = 16384;
+// Frames in the rolling frame-time statistics
+const size_t profile_frame_window_g = 256;
+// GPU zones waiting for results beyond this are dropped (the results never came)
+const size_t gpu_profile_pending_g = 256;
+// Interval between GPU clock calibrations (ns)
+const uint64_t gpu_profile_calibration_g = 1000000000;
+
+// Registered rings (never freed: threads may exit while the rings are read)
+static std::mutex profile_registry_mutex_g;
+static std::vector<std::unique_ptr<ProfileRing> > profile_ring_g;
+static thread_local ProfileRing *profile_thread_ring_g = NULL;
+
+// Rolling frame times (main thread only)
+static double profile_frame_time_g[profile_frame_window_g];
+static size_t profile_frame_count_g = 0;
+static uint64_t profile_last_frame_g = 0;
+
+
+ProfileRing::ProfileRing(const std::string &name) : name_(name), event_(profile_ring_size_g), head_(0){
+}
+
+
+void ProfileRing::Push(const char *name, uint64_t start, uint64_t end){
+
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    ProfileEvent &event = event_[head & (profile_ring_size_g - 1)];
+    event.name = name;
+    event.start = start;
+    event.end = end;
+    head_.store(head + 1, std::memory_order_release);
+}
+
+
+void ProfileRing::Read(std::vector<ProfileEvent> &event) const {
+
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t first = (head > profile_ring_size_g) ? head - profile_ring_size_g : 0;
+    size_t begin = event.size();
+    for (uint64_t i = first; i < head; i++){
+        event.push_back(event_[i & (profile_ring_size_g - 1)]);
+    }
+
+    // The writer may have wrapped over the oldest entries while they were copied
+    // (the entry being written when the copy ended included)
+    uint64_t later = head_.load(std::memory_order_acquire);
+    if (later + 1 > first + profile_ring_size_g){
+        size_t lost = (size_t) std::min<uint64_t>(later + 1 - profile_ring_size_g - first, head - first);
+        event.erase(event.begin() + begin, event.begin() + begin + lost);
+    }
+}
+
+
+const std::string &ProfileRing::GetName(void) const {
+
+    return name_;
+}
+
+
+void ProfileRing::SetName(const std::string &name){
+
+    name_ = name;
+}
+
+
+uint64_t Profiler::Now(void){
+
+    return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+ProfileRing *Profiler::Register(const std::string &name){
+
+    std::lock_guard<std::mutex> lock(profile_registry_mutex_g);
+    std::string track = name;
+    if (track.empty()){
+        track = "Thread " + std::to_string(profile_ring_g.size());
+    }
+    profile_ring_g.push_back(std::unique_ptr<ProfileRing>(new ProfileRing(track)));
+    return profile_ring_g.back().get();
+}
+
+
+ProfileRing *Profiler::GetThreadRing(void){
+
+    if (!profile_thread_ring_g){
+        profile_thread_ring_g = Register("");
+    }
+    return profile_thread_ring_g;
+}
+
+
+void Profiler::Record(const char *name, uint64_t start, uint64_t end){
+
+    GetThreadRing()->Push(name, start, end);
+}
+
+
+void Profiler::SetThreadName(const std::string &name){
+
+    ProfileRing *ring = GetThreadRing();
+    std::lock_guard<std::mutex> lock(profile_registry_mutex_g);
+    ring->SetName(name);
+}
+
+
+ProfileRing *Profiler::CreateTrack(const std::string &name){
+
+    return Register(name);
+}
+
+
+void Profiler::EndFrame(void){
+
+    uint64_t now = Now();
+    if (profile_last_frame_g){
+        profile_frame_time_g[profile_frame_count_g % profile_frame_window_g] = (now - profile_last_frame_g) * 1e-9;
+        profile_frame_count_g++;
+    }
+    profile_last_frame_g = now;
+}
+
+
+void Profiler::RestartFrame(void){
+
+    profile_last_frame_g = Now();
+}
+
+
+double Profiler::GetFrameTimePercentile(double percentile){
+
+    size_t n = std::min(profile_frame_count_g, profile_frame_window_g);
+    if (n == 0){
+        return 0.0;
+    }
+    double time[profile_frame_window_g];
+    std::copy(profile_frame_time_g, profile_frame_time_g + n, time);
+
+    // Nearest rank
+    size_t rank = (size_t) (percentile / 100.0 * n + 0.999999);
+    rank = std::min(std::max<size_t>(rank, 1), n) - 1;
+    std::nth_element(time, time + rank, time + n);
+    return time[rank];
+}
+
+
+void Profiler::WriteChromeTrace(const std::string &filename){
+
+    // Copy the rings first, so the file is written without holding the registry
+    std::vector<std::string> track;
+    std::vector<std::vector<ProfileEvent> > event;
+    {
+        std::lock_guard<std::mutex> lock(profile_registry_mutex_g);
+        for (const auto &ring : profile_ring_g){
+            track.push_back(ring->GetName());
+            event.push_back(std::vector<ProfileEvent>());
+            ring->Read(event.back());
+        }
+    }
+
+    // Times relative to the oldest zone, in microseconds
+    uint64_t origin = UINT64_MAX;
+    for (const auto &e : event){
+        for (const ProfileEvent &zone : e){
+            origin = std::min(origin, zone.start);
+        }
+    }
+
+    std::ofstream f(filename.c_str());
+    if (f.fail()){
+        throw(std::ios_base::failure(std::string("Error opening file ")+filename));
+    }
+    f << "{\"traceEvents\":[\n";
+    bool first = true;
+    char line[256];
+    for (size_t t = 0; t < track.size(); t++){
+        snprintf(line, sizeof(line), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            first ? "" : ",\n", (int) t, track[t].c_str());
+        f << line;
+        first = false;
+        for (const ProfileEvent &zone : event[t]){
+            snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                zone.name, (int) t, (zone.start - origin) * 1e-3, (zone.end - zone.start) * 1e-3);
+            f << line;
+        }
+    }
+    f << "\n]}\n";
+    if (!f){
+        throw(std::ios_base::failure(std::string("Error writing file ")+filename));
+    }
+}
+
+
+GpuProfiler::GpuProfiler(void){
+
+    backend_ = NULL;
+    track_ = NULL;
+    offset_ = 0;
+    calibrated_ = 0;
+}
+
+
+GpuProfiler::~GpuProfiler(){
+
+    // The context may already be gone when the owner is destroyed
+    if (backend_ && (backend_ != GetGLBackend() || glfwGetCurrentContext())){
+        for (const PendingZone &zone : pending_){
+            backend_->DeleteQuery(zone.query[0]);
+            backend_->DeleteQuery(zone.query[1]);
+        }
+        for (GLuint query : free_query_){
+            backend_->DeleteQuery(query);
+        }
+    }
+}
+
+
+GLuint GpuProfiler::GetQuery(RenderBackend *backend){
+
+    if (free_query_.empty()){
+        return backend->CreateQuery();
+    }
+    GLuint query = free_query_.back();
+    free_query_.pop_back();
+    return query;
+}
+
+
+void GpuProfiler::BeginFrame(RenderBackend *backend){
+
+    if (!backend->Supports(TimerQueryFeature)){
+        return;
+    }
+    backend_ = backend;
+    if (!track_){
+        track_ = Profiler::CreateTrack("GPU");
+    }
+
+    // GPU timestamps are mapped to the profiler clock
+    uint64_t now = Profiler::Now();
+    if (!calibrated_ || now - calibrated_ > gpu_profile_calibration_g){
+        offset_ = (int64_t) Profiler::Now() - (int64_t) backend->GetTimestamp();
+        calibrated_ = now;
+    }
+
+    // Zones complete in order; stop at the first without results
+    size_t done = 0;
+    while (done < pending_.size() && pending_.size() - done > open_.size()){
+        PendingZone &zone = pending_[done];
+        GLuint64 start, end;
+        if (!backend->GetQueryResult(zone.query[1], end, false) && pending_.size() - done <= gpu_profile_pending_g){
+            break;
+        }
+        backend->GetQueryResult(zone.query[0], start, true);
+        backend->GetQueryResult(zone.query[1], end, true);
+        track_->Push(zone.name, (uint64_t) ((int64_t) start + offset_), (uint64_t) ((int64_t) end + offset_));
+        free_query_.push_back(zone.query[0]);
+        free_query_.push_back(zone.query[1]);
+        done++;
+    }
+    pending_.erase(pending_.begin(), pending_.begin() + done);
+    for (size_t &open : open_){
+        open -= done;
+    }
+}
+
+
+void GpuProfiler::Begin(RenderBackend *backend, const char *name){
+
+    if (!backend->Supports(TimerQueryFeature)){
+        return;
+    }
+    PendingZone zone;
+    zone.name = name;
+    zone.query[0] = GetQuery(backend);
+    zone.query[1] = GetQuery(backend);
+    backend->QueryTimestamp(zone.query[0]);
+    open_.push_back(pending_.size());
+    pending_.push_back(zone);
+}
+
+
+void GpuProfiler::End(RenderBackend *backend){
+
+    if (!backend->Supports(TimerQueryFeature) || open_.empty()){
+        return;
+    }
+    backend->QueryTimestamp(pending_[open_.back()].query[1]);
+    open_.pop_back();
+}
+
+} // namespace game
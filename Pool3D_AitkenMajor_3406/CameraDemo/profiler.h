@@ -0,0 +1,148 @@
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <cstdint>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "render_backend.h"
+
+// Scoped zones: PROFILE_ZONE("name") times the enclosing block on the calling thread,
+// PROFILE_GPU_ZONE(gpu_profiler, backend, "name") the GL commands it issues. Names must
+// be string literals (only the pointer is stored). Building with PROFILER_DISABLED
+// removes the zones entirely
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#ifndef PROFILER_DISABLED
+#define PROFILE_ZONE(name) game::ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#define PROFILE_GPU_ZONE(profiler, backend, name) game::GpuProfileZone PROFILE_CONCAT(gpu_profile_zone_, __LINE__)(profiler, backend, name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_GPU_ZONE(profiler, backend, name)
+#endif
+
+namespace game {
+
+    // One timed zone (nanoseconds of the profiler clock)
+    struct ProfileEvent {
+        const char *name;
+        uint64_t start;
+        uint64_t end;
+    };
+
+    // Fixed-size ring of the latest zones of one thread. Only its thread writes
+    // it, without locks; readers copy it and drop the entries overwritten meanwhile
+    class ProfileRing {
+
+        public:
+            ProfileRing(const std::string &name);
+
+            void Push(const char *name, uint64_t start, uint64_t end);
+            // Append the zones currently in the ring, oldest first
+            void Read(std::vector<ProfileEvent> &event) const;
+            const std::string &GetName(void) const;
+            void SetName(const std::string &name);
+
+        private:
+            std::string name_; // Track name in the trace
+            std::vector<ProfileEvent> event_;
+            std::atomic<uint64_t> head_; // Zones pushed so far; the next one goes to head_ % size
+
+    }; // class ProfileRing
+
+    // Frame profiler: per-thread zone rings, rolling frame-time statistics and
+    // Chrome trace export (chrome://tracing, Perfetto)
+    class Profiler {
+
+        public:
+            // Current time of the profiler clock (ns)
+            static uint64_t Now(void);
+            // Record a zone of the calling thread
+            static void Record(const char *name, uint64_t start, uint64_t end);
+            // Name the calling thread's track in the trace
+            static void SetThreadName(const std::string &name);
+            // Ring of a track not tied to a thread (e.g., the GPU); lives until exit
+            static ProfileRing *CreateTrack(const std::string &name);
+
+            // Mark the end of a frame (main thread): its duration enters the statistics
+            static void EndFrame(void);
+            // Start timing the current frame now (time spent idle is not part of a frame)
+            static void RestartFrame(void);
+            // Percentile (0-100) of the durations of the last frames, in seconds
+            static double GetFrameTimePercentile(double percentile);
+
+            // Write the zones in the rings as Chrome trace JSON (throws std::ios_base::failure)
+            static void WriteChromeTrace(const std::string &filename);
+
+        private:
+            // Ring of the calling thread, created and registered on first use
+            static ProfileRing *GetThreadRing(void);
+            // Add a ring to the trace (an empty name is replaced with "Thread N")
+            static ProfileRing *Register(const std::string &name);
+
+    }; // class Profiler
+
+    // Times the enclosing scope on the calling thread (use PROFILE_ZONE)
+    class ProfileZone {
+
+        public:
+            ProfileZone(const char *name) : name_(name), start_(Profiler::Now()) {}
+            ~ProfileZone() { Profiler::Record(name_, start_, Profiler::Now()); }
+
+        private:
+            const char *name_;
+            uint64_t start_;
+
+    }; // class ProfileZone
+
+    // GPU zones from timestamp queries, shown as a "GPU" track. Results are read a few
+    // frames later, so timing never makes the CPU wait for the GPU. Does nothing if
+    // the backend has no timer queries
+    class GpuProfiler {
+
+        public:
+            GpuProfiler(void);
+            ~GpuProfiler();
+
+            // Collect the zones of earlier frames that are done; call once per frame,
+            // before the first zone
+            void BeginFrame(RenderBackend *backend);
+            // Time the commands issued between Begin and End (use PROFILE_GPU_ZONE)
+            void Begin(RenderBackend *backend, const char *name);
+            void End(RenderBackend *backend);
+
+        private:
+            // Zone waiting for its queries
+            struct PendingZone {
+                const char *name;
+                GLuint query[2]; // Start and end timestamps
+            };
+            std::vector<PendingZone> pending_; // Oldest first
+            std::vector<size_t> open_; // Zones begun and not ended (indices into pending_)
+            std::vector<GLuint> free_query_;
+            RenderBackend *backend_; // Backend the queries belong to
+            ProfileRing *track_;
+            int64_t offset_; // Profiler clock minus GPU clock (ns)
+            uint64_t calibrated_; // Profiler time of the last calibration
+
+            GLuint GetQuery(RenderBackend *backend);
+
+    }; // class GpuProfiler
+
+    // Times the GL commands of the enclosing scope (use PROFILE_GPU_ZONE)
+    class GpuProfileZone {
+
+        public:
+            GpuProfileZone(GpuProfiler *profiler, RenderBackend *backend, const char *name) : profiler_(profiler), backend_(backend) { profiler_->Begin(backend_, name); }
+            ~GpuProfileZone() { profiler_->End(backend_); }
+
+        private:
+            GpuProfiler *profiler_;
+            RenderBackend *backend_;
+
+    }; // class GpuProfileZone
+
+} // namespace game
+
+#endif // PROFILER_H_
@@ -0,0 +1,269 @@
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/type_ptr.hpp>
+
+#include "render_backend.h"
+
+namespace game {
+
+RenderBackend *GetGLBackend(void){
+
+    static GLBackend backend;
+    return &backend;
+}
+
+
+bool GLBackend::Supports(BackendFeature feature) const {
+
+    switch (feature){
+        case MultiDrawIndirectFeature:
+            return GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+        case BufferStorageFeature:
+            return GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+        case SyncFeature:
+            return GLEW_VERSION_3_2 || GLEW_ARB_sync;
+        case TimerQueryFeature:
+            return GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+        default:
+            return false;
+    }
+}
+
+
+void GLBackend::Clear(const glm::vec4 &color){
+
+    glClearColor(color.x, color.y, color.z, color.w);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+
+void GLBackend::SetBlending(bool enable){
+
+    if (enable){
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+    else {
+        glDisable(GL_BLEND);
+    }
+}
+
+
+void GLBackend::SetViewport(GLint x, GLint y, GLsizei width, GLsizei height){
+
+    glViewport(x, y, width, height);
+}
+
+
+void GLBackend::UseProgram(GLuint program){
+
+    glUseProgram(program);
+}
+
+
+GLint GLBackend::GetUniformLocation(GLuint program, const char *name){
+
+    return glGetUniformLocation(program, name);
+}
+
+
+GLint GLBackend::GetAttribLocation(GLuint program, const char *name){
+
+    return glGetAttribLocation(program, name);
+}
+
+
+void GLBackend::SetUniform(GLint location, float value){
+
+    glUniform1f(location, value);
+}
+
+
+void GLBackend::SetUniform(GLint location, const glm::vec3 &value){
+
+    glUniform3f(location, value.x, value.y, value.z);
+}
+
+
+void GLBackend::SetUniform(GLint location, const glm::mat4 &value){
+
+    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+
+GLuint GLBackend::CreateBuffer(void){
+
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    return buffer;
+}
+
+
+void GLBackend::DeleteBuffer(GLuint buffer){
+
+    glDeleteBuffers(1, &buffer);
+}
+
+
+void GLBackend::BindBuffer(GLenum target, GLuint buffer){
+
+    glBindBuffer(target, buffer);
+}
+
+
+void GLBackend::BufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage){
+
+    glBufferData(target, size, data, usage);
+}
+
+
+void GLBackend::BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data){
+
+    glBufferSubData(target, offset, size, data);
+}
+
+
+void GLBackend::CopyBufferSubData(GLenum read_target, GLenum write_target, GLintptr read_offset, GLintptr write_offset, GLsizeiptr size){
+
+    glCopyBufferSubData(read_target, write_target, read_offset, write_offset, size);
+}
+
+
+void GLBackend::BufferStorage(GLenum target, GLsizeiptr size, GLbitfield flags){
+
+    glBufferStorage(target, size, NULL, flags);
+}
+
+
+void *GLBackend::MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr size, GLbitfield access){
+
+    return glMapBufferRange(target, offset, size, access);
+}
+
+
+void GLBackend::UnmapBuffer(GLenum target){
+
+    glUnmapBuffer(target);
+}
+
+
+GLsync GLBackend::FenceSync(void){
+
+    return glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+
+bool GLBackend::WaitSync(GLsync fence, GLuint64 timeout){
+
+    // A failed wait counts as done, so callers do not spin on it
+    return glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout) != GL_TIMEOUT_EXPIRED;
+}
+
+
+void GLBackend::DeleteSync(GLsync fence){
+
+    glDeleteSync(fence);
+}
+
+
+GLuint GLBackend::CreateQuery(void){
+
+    GLuint query;
+    glGenQueries(1, &query);
+    return query;
+}
+
+
+void GLBackend::DeleteQuery(GLuint query){
+
+    glDeleteQueries(1, &query);
+}
+
+
+void GLBackend::QueryTimestamp(GLuint query){
+
+    glQueryCounter(query, GL_TIMESTAMP);
+}
+
+
+bool GLBackend::GetQueryResult(GLuint query, GLuint64 &result, bool wait){
+
+    if (!wait){
+        GLint available;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available){
+            return false;
+        }
+    }
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &result);
+    return true;
+}
+
+
+GLuint64 GLBackend::GetTimestamp(void){
+
+    GLint64 timestamp;
+    glGetInteger64v(GL_TIMESTAMP, &timestamp);
+    return (GLuint64) timestamp;
+}
+
+
+void GLBackend::VertexAttribPointer(GLuint location, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLintptr offset){
+
+    glVertexAttribPointer(location, size, type, normalized, stride, (void *) offset);
+}
+
+
+void GLBackend::EnableVertexAttribArray(GLuint location){
+
+    glEnableVertexAttribArray(location);
+}
+
+
+void GLBackend::DisableVertexAttribArray(GLuint location){
+
+    glDisableVertexAttribArray(location);
+}
+
+
+void GLBackend::VertexAttribDivisor(GLuint location, GLuint divisor){
+
+    glVertexAttribDivisor(location, divisor);
+}
+
+
+void GLBackend::VertexAttrib(GLuint location, const glm::vec4 &value){
+
+    glVertexAttrib4f(location, value.x, value.y, value.z, value.w);
+}
+
+
+void GLBackend::DrawArrays(GLenum mode, GLint first, GLsizei count){
+
+    glDrawArrays(mode, first, count);
+}
+
+
+void GLBackend::DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instance_count, GLuint base_instance){
+
+    // The base instance needs OpenGL 4.2 (ARB_base_instance)
+    if (base_instance == 0){
+        glDrawArraysInstanced(mode, first, count, instance_count);
+    }
+    else {
+        glDrawArraysInstancedBaseInstance(mode, first, count, instance_count, base_instance);
+    }
+}
+
+
+void GLBackend::DrawElements(GLenum mode, GLsizei count, GLenum type, GLintptr offset){
+
+    glDrawElements(mode, count, type, (void *) offset);
+}
+
+
+void GLBackend::MultiDrawElementsIndirect(GLenum mode, GLenum type, GLintptr offset, GLsizei draw_count){
+
+    glMultiDrawElementsIndirect(mode, type, (void *) offset, draw_count, 0);
+}
+
+} // namespace game
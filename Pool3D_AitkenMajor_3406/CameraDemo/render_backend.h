@@ -0,0 +1,140 @@
+#ifndef RENDER_BACKEND_H_
+#define RENDER_BACKEND_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+namespace game {
+
+    // Optional features the renderer uses when the backend supports them
+    typedef enum Capability { MultiDrawIndirectFeature = 0, BufferStorageFeature, SyncFeature, TimerQueryFeature, NumFeatures } BackendFeature;
+
+    // Commands issued to draw a frame and to store meshes, in terms of GL. The renderer
+    // (scene graph, render queue, impostors, stream buffer, geometry pool) issues them
+    // through a backend instead of calling GL, so a frame can be counted or recorded
+    // without a context (see null_backend.h). Shader programs are still built with GL
+    class RenderBackend {
+
+        public:
+            // Inline, so null backends link without the GL backend (and GLEW)
+            virtual ~RenderBackend() {}
+
+            virtual bool Supports(BackendFeature feature) const = 0;
+
+            // Clear the color (to 'color') and depth buffers
+            virtual void Clear(const glm::vec4 &color) = 0;
+            // Alpha blending (source alpha, one minus source alpha)
+            virtual void SetBlending(bool enable) = 0;
+            // Area of the framebuffer drawn to, in pixels
+            virtual void SetViewport(GLint x, GLint y, GLsizei width, GLsizei height) = 0;
+
+            // Programs and their uniforms
+            virtual void UseProgram(GLuint program) = 0;
+            virtual GLint GetUniformLocation(GLuint program, const char *name) = 0;
+            virtual GLint GetAttribLocation(GLuint program, const char *name) = 0;
+            virtual void SetUniform(GLint location, float value) = 0;
+            virtual void SetUniform(GLint location, const glm::vec3 &value) = 0;
+            virtual void SetUniform(GLint location, const glm::mat4 &value) = 0;
+
+            // Buffers; data and storage calls apply to the buffer bound to 'target'
+            virtual GLuint CreateBuffer(void) = 0;
+            virtual void DeleteBuffer(GLuint buffer) = 0;
+            virtual void BindBuffer(GLenum target, GLuint buffer) = 0;
+            virtual void BufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage) = 0;
+            virtual void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data) = 0;
+            // Copy between the buffers bound to two targets, on the GPU
+            virtual void CopyBufferSubData(GLenum read_target, GLenum write_target, GLintptr read_offset, GLintptr write_offset, GLsizeiptr size) = 0;
+            // Immutable storage (BufferStorageFeature)
+            virtual void BufferStorage(GLenum target, GLsizeiptr size, GLbitfield flags) = 0;
+            virtual void *MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr size, GLbitfield access) = 0;
+            virtual void UnmapBuffer(GLenum target) = 0;
+
+            // Fences (SyncFeature): WaitSync returns true once the GPU passed the fence,
+            // waiting at most 'timeout' nanoseconds
+            virtual GLsync FenceSync(void) = 0;
+            virtual bool WaitSync(GLsync fence, GLuint64 timeout) = 0;
+            virtual void DeleteSync(GLsync fence) = 0;
+
+            // Timestamp queries (TimerQueryFeature), in nanoseconds of the GPU clock.
+            // GetQueryResult returns false if the result is not available yet and
+            // 'wait' is false; GetTimestamp returns the GPU time now
+            virtual GLuint CreateQuery(void) = 0;
+            virtual void DeleteQuery(GLuint query) = 0;
+            virtual void QueryTimestamp(GLuint query) = 0;
+            virtual bool GetQueryResult(GLuint query, GLuint64 &result, bool wait) = 0;
+            virtual GLuint64 GetTimestamp(void) = 0;
+
+            // Vertex attributes; pointers are offsets into the bound array buffer
+            virtual void VertexAttribPointer(GLuint location, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLintptr offset) = 0;
+            virtual void EnableVertexAttribArray(GLuint location) = 0;
+            virtual void DisableVertexAttribArray(GLuint location) = 0;
+            virtual void VertexAttribDivisor(GLuint location, GLuint divisor) = 0;
+            // Constant value of a disabled attribute
+            virtual void VertexAttrib(GLuint location, const glm::vec4 &value) = 0;
+
+            // Draws; offsets are in bytes into the bound element array and indirect buffers
+            virtual void DrawArrays(GLenum mode, GLint first, GLsizei count) = 0;
+            virtual void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instance_count, GLuint base_instance) = 0;
+            virtual void DrawElements(GLenum mode, GLsizei count, GLenum type, GLintptr offset) = 0;
+            virtual void MultiDrawElementsIndirect(GLenum mode, GLenum type, GLintptr offset, GLsizei draw_count) = 0;
+
+    }; // class RenderBackend
+
+    // Backend that forwards the commands to the current GL context
+    class GLBackend : public RenderBackend {
+
+        public:
+            bool Supports(BackendFeature feature) const;
+
+            void Clear(const glm::vec4 &color);
+            void SetBlending(bool enable);
+            void SetViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+            void UseProgram(GLuint program);
+            GLint GetUniformLocation(GLuint program, const char *name);
+            GLint GetAttribLocation(GLuint program, const char *name);
+            void SetUniform(GLint location, float value);
+            void SetUniform(GLint location, const glm::vec3 &value);
+            void SetUniform(GLint location, const glm::mat4 &value);
+
+            GLuint CreateBuffer(void);
+            void DeleteBuffer(GLuint buffer);
+            void BindBuffer(GLenum target, GLuint buffer);
+            void BufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+            void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data);
+            void CopyBufferSubData(GLenum read_target, GLenum write_target, GLintptr read_offset, GLintptr write_offset, GLsizeiptr size);
+            void BufferStorage(GLenum target, GLsizeiptr size, GLbitfield flags);
+            void *MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr size, GLbitfield access);
+            void UnmapBuffer(GLenum target);
+
+            GLsync FenceSync(void);
+            bool WaitSync(GLsync fence, GLuint64 timeout);
+            void DeleteSync(GLsync fence);
+
+            GLuint CreateQuery(void);
+            void DeleteQuery(GLuint query);
+            void QueryTimestamp(GLuint query);
+            bool GetQueryResult(GLuint query, GLuint64 &result, bool wait);
+            GLuint64 GetTimestamp(void);
+
+            void VertexAttribPointer(GLuint location, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLintptr offset);
+            void EnableVertexAttribArray(GLuint location);
+            void DisableVertexAttribArray(GLuint location);
+            void VertexAttribDivisor(GLuint location, GLuint divisor);
+            void VertexAttrib(GLuint location, const glm::vec4 &value);
+
+            void DrawArrays(GLenum mode, GLint first, GLsizei count);
+            void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instance_count, GLuint base_instance);
+            void DrawElements(GLenum mode, GLsizei count, GLenum type, GLintptr offset);
+            void MultiDrawElementsIndirect(GLenum mode, GLenum type, GLintptr offset, GLsizei draw_count);
+
+    }; // class GLBackend
+
+    // The GL backend shared by all renderers (it has no state of its own)
+    RenderBackend *GetGLBackend(void);
+
+} // namespace game
+
+#endif // RENDER_BACKEND_H_
@@ -0,0 +1,30 @@
+#ifndef RENDER_PACKET_H_
+#define RENDER_PACKET_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "camera.h"
+#include "render_queue.h"
+#include "impostor_batch.h"
+
+namespace game {
+
+    // Everything needed to draw one frame. SceneGraph::BuildPacket fills it without
+    // GL calls and SceneGraph::SubmitPacket issues it later, possibly on a render thread
+    // while the next frame is built. It holds copies of the node and camera state; the
+    // resources of its draws must stay loaded until it is submitted
+    struct RenderPacket {
+        Camera camera; // The frame is seen from a copy of the camera
+        glm::vec3 background_color;
+        GLsizei viewport_width; // Framebuffer size (0: keep the current viewport)
+        GLsizei viewport_height;
+        RenderQueue queue; // Sorted mesh draws; its stats are those of the last submission
+        ImpostorBatch impostors; // Spheres drawn as impostors
+        GLuint impostor_material; // Impostor shader program (0: no impostors)
+    };
+
+} // namespace game
+
+#endif // RENDER_PACKET_H_
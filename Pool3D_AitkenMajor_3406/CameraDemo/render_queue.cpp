@@ -0,0 +1,437 @@
+#include <cstring>
+#include <algorithm>
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/type_ptr.hpp>
+
+#include "render_queue.h"
+#include "scene_node.h"
+#include "resource.h"
+
+namespace game {
+
+// Floats of per-draw data: world matrix (16), material (4)
+const int render_instance_att_g = 20;
+
+RenderQueue::RenderQueue(void){
+
+    stats_.draws = 0;
+    stats_.commands = 0;
+    stats_.indices = 0;
+    stats_.program_binds = 0;
+    stats_.buffer_binds = 0;
+    backend_ = NULL;
+}
+
+
+RenderQueue::~RenderQueue(){
+}
+
+
+void RenderQueue::Clear(void){
+
+    item_.clear();
+    entry_.clear();
+}
+
+
+void RenderQueue::Push(RenderPass pass, const SceneNode *node, const Resource *mesh, GLuint program, const glm::mat4 &world, float view_depth){
+
+    RenderItem item;
+    item.mesh = mesh;
+    item.program = program;
+    item.mode = node->GetMode();
+    item.material = node->GetMaterialParameters();
+    item.world = world;
+
+    SortEntry entry;
+    // Pooled meshes share their buffers, so the key groups draws by mesh instead; the
+    // submission checks the buffers themselves for binds
+    entry.key = MakeKey(pass, program, mesh->GetId(), view_depth);
+    entry.index = (GLuint) item_.size();
+
+    item_.push_back(item);
+    entry_.push_back(entry);
+}
+
+
+GLuint64 RenderQueue::MakeKey(RenderPass pass, GLuint program, GLuint mesh, float view_depth){
+
+    // Objects behind the camera all sort as nearest
+    if (!(view_depth > 0.0f)){
+        view_depth = 0.0f;
+    }
+
+    // The bit pattern of a non-negative float increases with its value,
+    // so it can be sorted as an integer
+    GLuint depth;
+    std::memcpy(&depth, &view_depth, sizeof(depth));
+
+    // Transparent geometry is drawn back-to-front
+    if (pass == TransparentPass){
+        depth = ~depth;
+    }
+
+    return ((GLuint64) (pass & 0xF) << 60) |
+           ((GLuint64) (program & 0xFFF) << 48) |
+           ((GLuint64) (mesh & 0xFFFF) << 32) |
+           (GLuint64) depth;
+}
+
+
+void RenderQueue::Sort(void){
+
+    RadixSort();
+}
+
+
+void RenderQueue::RadixSort(void){
+
+    const size_t n = entry_.size();
+    if (n < 2){
+        return;
+    }
+    scratch_.resize(n);
+
+    // Build the histograms of all eight digits in a single pass
+    size_t count[8][256];
+    std::memset(count, 0, sizeof(count));
+    for (size_t i = 0; i < n; i++){
+        GLuint64 key = entry_[i].key;
+        for (int d = 0; d < 8; d++){
+            count[d][(key >> (d * 8)) & 0xFF]++;
+        }
+    }
+
+    SortEntry *src = entry_.data();
+    SortEntry *dst = scratch_.data();
+    for (int d = 0; d < 8; d++){
+
+        // Skip digits shared by every key (e.g., the pass when all draws are opaque)
+        int shift = d * 8;
+        if (count[d][(src[0].key >> shift) & 0xFF] == n){
+            continue;
+        }
+
+        // Exclusive prefix sum gives the first output slot of each bucket
+        size_t offset[256];
+        size_t sum = 0;
+        for (int b = 0; b < 256; b++){
+            offset[b] = sum;
+            sum += count[d][b];
+        }
+
+        // Stable scatter
+        for (size_t i = 0; i < n; i++){
+            dst[offset[(src[i].key >> shift) & 0xFF]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+
+    // Make sure the sorted result ends up in entry_
+    if (src != entry_.data()){
+        std::memcpy(entry_.data(), src, n * sizeof(SortEntry));
+    }
+}
+
+
+void RenderQueue::Submit(RenderBackend *backend, Camera *camera, StreamBuffer *stream){
+
+    stats_.draws = 0;
+    stats_.commands = 0;
+    stats_.indices = 0;
+    stats_.program_binds = 0;
+    stats_.buffer_binds = 0;
+
+    if (entry_.empty()){
+        return;
+    }
+    backend_ = backend;
+    if (stream && backend_->Supports(MultiDrawIndirectFeature)){
+        SubmitIndirect(camera, stream);
+    }
+    else {
+        SubmitDirect(camera);
+    }
+}
+
+
+void RenderQueue::BindProgram(GLuint program, Camera *camera, ProgramState &state){
+
+    state.program = program;
+    backend_->UseProgram(program);
+
+    // Set globals for camera and timer once per program
+    camera->SetupShader(program, backend_);
+    GLint timer_var = backend_->GetUniformLocation(program, "timer");
+    backend_->SetUniform(timer_var, (float) glfwGetTime());
+
+    for (int a = 0; a < NumAttributes; a++){
+        state.attribute[a] = backend_->GetAttribLocation(program, vertex_attribute_name_g[a]);
+    }
+    state.world_att = backend_->GetAttribLocation(program, "world_mat");
+    state.material_att = backend_->GetAttribLocation(program, "material");
+    stats_.program_binds++;
+}
+
+
+void RenderQueue::SetVertexAttributes(const VertexFormat *format, const ProgramState &state, GLint base_vertex){
+
+    // Set attributes for shaders as described by the vertex format of the mesh
+    size_t base = (size_t) base_vertex * format->stride;
+    for (int a = 0; a < format->num_attributes; a++){
+        const VertexAttribute &attribute = format->attribute[a];
+        GLint location = state.attribute[attribute.semantic];
+        if (location >= 0){
+            backend_->VertexAttribPointer(location, attribute.size, attribute.type, attribute.normalized, format->stride, base + attribute.offset);
+            backend_->EnableVertexAttribArray(location);
+        }
+    }
+}
+
+
+void RenderQueue::SetInstanceAttributes(const ProgramState &state, bool enable, GLintptr offset){
+
+    // Attribute locations of the per-draw data and their offsets (in floats)
+    GLint location[5] = { -1, -1, -1, -1, state.material_att };
+    if (state.world_att >= 0){
+        for (int c = 0; c < 4; c++){
+            location[c] = state.world_att + c;
+        }
+    }
+    for (int a = 0; a < 5; a++){
+        if (location[a] < 0){
+            continue;
+        }
+        if (enable){
+            backend_->VertexAttribPointer(location[a], 4, GL_FLOAT, GL_FALSE, render_instance_att_g * sizeof(GLfloat), offset + a * 4 * sizeof(GLfloat));
+            backend_->EnableVertexAttribArray(location[a]);
+            backend_->VertexAttribDivisor(location[a], 1);
+        }
+        else {
+            // Divisors are global state (no vertex array object): restore them for other draws
+            backend_->VertexAttribDivisor(location[a], 0);
+            backend_->DisableVertexAttribArray(location[a]);
+        }
+    }
+}
+
+
+void RenderQueue::SubmitDirect(Camera *camera){
+
+    // Currently bound state
+    ProgramState state;
+    state.program = 0;
+    GLuint array_buffer = 0;
+    GLint base_vertex = -1;
+    GLuint element_array_buffer = 0;
+    bool blending = false;
+    glm::vec4 material(0.0f, 0.0f, 0.0f, -1.0f); // Current value of the material attribute (none yet)
+
+    for (size_t i = 0; i < entry_.size(); i++){
+
+        const RenderItem &item = item_[entry_[i].index];
+        const Resource *mesh = item.mesh;
+
+        // Blending is only enabled once the transparent pass starts
+        if (!blending && (entry_[i].key >> 60) == TransparentPass){
+            backend_->SetBlending(true);
+            blending = true;
+        }
+
+        // Select proper material (shader program)
+        if (item.program != state.program){
+            BindProgram(item.program, camera, state);
+
+            // Attribute locations may differ, so set up the vertex buffer again
+            array_buffer = 0;
+        }
+
+        // Set geometry to draw; meshes sharing a buffer start at their base vertex
+        if (mesh->GetArrayBuffer() != array_buffer){
+            array_buffer = mesh->GetArrayBuffer();
+            backend_->BindBuffer(GL_ARRAY_BUFFER, array_buffer);
+            base_vertex = -1;
+            stats_.buffer_binds++;
+        }
+        if (mesh->GetBaseVertex() != base_vertex){
+            base_vertex = mesh->GetBaseVertex();
+            SetVertexAttributes(mesh->GetVertexFormat(), state, base_vertex);
+        }
+        if (mesh->GetElementArrayBuffer() != element_array_buffer){
+            element_array_buffer = mesh->GetElementArrayBuffer();
+            backend_->BindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer);
+            stats_.buffer_binds++;
+        }
+
+        // Per-node material (base color, color mode) is a constant attribute value, so nodes
+        // sharing a mesh keep sharing its buffers. Generic attribute values are context state
+        // and survive program changes
+        if (state.material_att >= 0){
+            if (item.material != material){
+                material = item.material;
+                backend_->VertexAttrib(state.material_att, material);
+            }
+        }
+
+        // World transformation, including the decoding of quantized positions
+        if (state.world_att >= 0){
+            glm::mat4 world = item.world * mesh->GetPositionTransform();
+            for (int c = 0; c < 4; c++){
+                backend_->VertexAttrib(state.world_att + c, world[c]);
+            }
+        }
+
+        // Draw geometry
+        if (item.mode == GL_POINTS){
+            backend_->DrawArrays(item.mode, 0, mesh->GetSize());
+        }
+        else {
+            GLsizei index_size = (mesh->GetIndexType() == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+            backend_->DrawElements(item.mode, mesh->GetSize(), mesh->GetIndexType(), (GLintptr) mesh->GetFirstIndex() * index_size);
+            stats_.indices += mesh->GetSize();
+        }
+        stats_.draws++;
+        stats_.commands++;
+    }
+
+    if (blending){
+        backend_->SetBlending(false);
+    }
+}
+
+
+void RenderQueue::SubmitIndirect(Camera *camera, StreamBuffer *stream){
+
+    const size_t n = entry_.size();
+
+    // One allocation holds the per-draw data (in sorted order) followed by the commands,
+    // so growing the stream buffer cannot drop half of them
+    GLsizeiptr instance_size = (GLsizeiptr) (n * render_instance_att_g * sizeof(GLfloat));
+    GLintptr instance_offset;
+    unsigned char *data = (unsigned char *) stream->Allocate(instance_size + n * sizeof(DrawElementsCommand), instance_offset);
+    GLintptr command_offset = instance_offset + instance_size;
+
+    // Per-draw data, written in place; command i reads instance i
+    GLfloat *instance = (GLfloat *) data;
+    for (size_t i = 0; i < n; i++){
+        const RenderItem &item = item_[entry_[i].index];
+
+        // World transformation, including the decoding of quantized positions
+        glm::mat4 world = item.world * item.mesh->GetPositionTransform();
+        std::memcpy(instance + i * render_instance_att_g, glm::value_ptr(world), 16 * sizeof(GLfloat));
+        std::memcpy(instance + i * render_instance_att_g + 16, glm::value_ptr(item.material), 4 * sizeof(GLfloat));
+    }
+
+    // One command per draw
+    DrawElementsCommand *command = (DrawElementsCommand *) (data + instance_size);
+    for (size_t i = 0; i < n; i++){
+        const Resource *mesh = item_[entry_[i].index].mesh;
+        command[i].count = mesh->GetSize();
+        command[i].instance_count = 1;
+        command[i].first_index = mesh->GetFirstIndex();
+        command[i].base_vertex = mesh->GetBaseVertex();
+        command[i].base_instance = (GLuint) i;
+    }
+    stream->Flush();
+    backend_->BindBuffer(GL_DRAW_INDIRECT_BUFFER, stream->GetBuffer());
+
+    // Currently bound state
+    ProgramState state;
+    state.program = 0;
+    GLuint array_buffer = 0;
+    GLuint element_array_buffer = 0;
+    bool blending = false;
+
+    size_t i = 0;
+    while (i < n){
+
+        const RenderItem &item = item_[entry_[i].index];
+        const Resource *mesh = item.mesh;
+        GLuint64 pass = entry_[i].key >> 60;
+
+        // Blending is only enabled once the transparent pass starts
+        if (!blending && pass == TransparentPass){
+            backend_->SetBlending(true);
+            blending = true;
+        }
+
+        // Select proper material (shader program); per-draw data comes from the instance buffer
+        if (item.program != state.program){
+            if (state.program){
+                SetInstanceAttributes(state, false, 0);
+            }
+            BindProgram(item.program, camera, state);
+            backend_->BindBuffer(GL_ARRAY_BUFFER, stream->GetBuffer());
+            SetInstanceAttributes(state, true, instance_offset);
+
+            // Attribute locations may differ, so set up the vertex buffer again
+            array_buffer = 0;
+        }
+
+        // Set geometry to draw; commands add the base vertex of each mesh
+        if (mesh->GetArrayBuffer() != array_buffer){
+            array_buffer = mesh->GetArrayBuffer();
+            backend_->BindBuffer(GL_ARRAY_BUFFER, array_buffer);
+            SetVertexAttributes(mesh->GetVertexFormat(), state, 0);
+            stats_.buffer_binds++;
+        }
+        if (mesh->GetElementArrayBuffer() != element_array_buffer){
+            element_array_buffer = mesh->GetElementArrayBuffer();
+            backend_->BindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer);
+            stats_.buffer_binds++;
+        }
+
+        // Extend the run over the following draws that need no state change
+        GLenum mode = item.mode;
+        size_t end = i + 1;
+        while (end < n){
+            const RenderItem &next = item_[entry_[end].index];
+            if ((entry_[end].key >> 60) != pass ||
+                next.program != state.program ||
+                next.mode != mode ||
+                next.mesh->GetArrayBuffer() != array_buffer ||
+                next.mesh->GetElementArrayBuffer() != element_array_buffer ||
+                next.mesh->GetIndexType() != mesh->GetIndexType()){
+                break;
+            }
+            end++;
+        }
+
+        // Draw geometry
+        if (mode == GL_POINTS){
+            for (size_t k = i; k < end; k++){
+                const Resource *points = item_[entry_[k].index].mesh;
+                backend_->DrawArraysInstanced(mode, points->GetBaseVertex(), points->GetSize(), 1, (GLuint) k);
+                stats_.draws++;
+            }
+        }
+        else {
+            backend_->MultiDrawElementsIndirect(mode, mesh->GetIndexType(), command_offset + i * sizeof(DrawElementsCommand), (GLsizei) (end - i));
+            for (size_t k = i; k < end; k++){
+                stats_.indices += item_[entry_[k].index].mesh->GetSize();
+            }
+            stats_.draws++;
+        }
+        stats_.commands += (int) (end - i);
+        i = end;
+    }
+
+    SetInstanceAttributes(state, false, 0);
+    if (blending){
+        backend_->SetBlending(false);
+    }
+}
+
+
+int RenderQueue::GetSize(void) const {
+
+    return (int) item_.size();
+}
+
+
+const RenderStats &RenderQueue::GetStats(void) const {
+
+    return stats_;
+}
+
+} // namespace game
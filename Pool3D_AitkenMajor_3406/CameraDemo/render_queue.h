@@ -0,0 +1,121 @@
+#ifndef RENDER_QUEUE_H_
+#define RENDER_QUEUE_H_
+
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include "camera.h"
+#include "vertex_format.h"
+#include "stream_buffer.h"
+#include "render_backend.h"
+
+namespace game {
+
+    class SceneNode;
+    class Resource;
+
+    // Render passes, in submission order (top bits of the sort key)
+    typedef enum Pass { OpaquePass = 0, TransparentPass = 1 } RenderPass;
+
+    // One draw collected from the scene graph. The node state it needs is copied, so
+    // a queue can be submitted while the nodes change (render thread)
+    struct RenderItem {
+        const Resource *mesh; // Geometry to draw (level of detail chosen by the node)
+        GLuint program; // Shader program (material variant chosen by the node)
+        GLenum mode; // Primitive mode of the node
+        glm::vec4 material; // Material parameters of the node
+        glm::mat4 world; // World transform of the node
+    };
+
+    // Counters for the last submitted frame
+    struct RenderStats {
+        int draws; // Draw calls issued
+        int commands; // Meshes drawn (a multi-draw call draws several)
+        int indices; // Vertices submitted through the index buffers
+        int program_binds;
+        int buffer_binds;
+    };
+
+    // Class that collects the draws of a frame and submits them sorted by state
+    class RenderQueue {
+
+        public:
+            // Constructor and destructor
+            RenderQueue(void);
+            ~RenderQueue();
+
+            // Remove all collected draws (keeps allocated memory)
+            void Clear(void);
+            // Add a draw; view_depth is the distance along the camera view direction
+            void Push(RenderPass pass, const SceneNode *node, const Resource *mesh, GLuint program, const glm::mat4 &world, float view_depth);
+            // Sort collected draws by key
+            void Sort(void);
+            // Issue all draws through 'backend' in sorted order, skipping redundant binds. With
+            // a stream buffer (of the same backend), per-draw data and commands are written to
+            // it and runs of draws that share state become one multi-draw indirect call (when
+            // supported)
+            void Submit(RenderBackend *backend, Camera *camera, StreamBuffer *stream = NULL);
+
+            // Number of collected draws
+            int GetSize(void) const;
+            // Counters of the last Submit
+            const RenderStats &GetStats(void) const;
+
+            // Pack pass, program, mesh (Resource::GetId) and depth into a 64-bit sort key:
+            // [63..60] pass, [59..48] program, [47..32] mesh, [31..0] depth
+            static GLuint64 MakeKey(RenderPass pass, GLuint program, GLuint mesh, float view_depth);
+
+        private:
+            // Key and item index sorted together
+            struct SortEntry {
+                GLuint64 key;
+                GLuint index;
+            };
+
+            // Arguments of one indirect indexed draw (layout defined by GL)
+            struct DrawElementsCommand {
+                GLuint count;
+                GLuint instance_count;
+                GLuint first_index;
+                GLint base_vertex;
+                GLuint base_instance;
+            };
+
+            // Attribute locations of the bound program
+            struct ProgramState {
+                GLuint program;
+                GLint attribute[NumAttributes]; // Mesh attributes
+                GLint world_att; // World matrix (mat4: four consecutive locations)
+                GLint material_att; // Material parameters of the node
+            };
+
+            std::vector<RenderItem> item_; // Draws in insertion order
+            std::vector<SortEntry> entry_; // Sorted keys
+            std::vector<SortEntry> scratch_; // Radix sort ping-pong buffer
+            RenderStats stats_;
+            RenderBackend *backend_; // Backend of the current Submit
+
+            // LSD radix sort of entry_ on 8-bit digits
+            void RadixSort(void);
+
+            // Submission paths: one call per draw with constant per-draw attributes, or
+            // multi-draw indirect with per-draw attributes read per instance
+            void SubmitDirect(Camera *camera);
+            void SubmitIndirect(Camera *camera, StreamBuffer *stream);
+
+            // Use 'program' and look up its locations; sets the camera and timer uniforms
+            void BindProgram(GLuint program, Camera *camera, ProgramState &state);
+            // Point the mesh attributes at the bound vertex buffer, starting at 'base_vertex'
+            void SetVertexAttributes(const VertexFormat *format, const ProgramState &state, GLint base_vertex);
+            // Point (or stop pointing) the per-draw attributes at the bound instance buffer,
+            // starting at byte 'offset'
+            void SetInstanceAttributes(const ProgramState &state, bool enable, GLintptr offset);
+
+    }; // class RenderQueue
+
+} // namespace game
+
+#endif // RENDER_QUEUE_H_
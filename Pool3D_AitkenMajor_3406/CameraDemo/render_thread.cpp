@@ -0,0 +1,117 @@
+#define GLM_FORCE_RADIANS
+#include <glm/gtc/quaternion.hpp>
+
+#include "render_thread.h"
+#include "profiler.h"
+
+namespace game {
+
+RenderThread::RenderThread(void){
+
+    window_ = NULL;
+    next_ = NULL;
+    stop_ = false;
+}
+
+
+RenderThread::~RenderThread(){
+
+    Stop();
+}
+
+
+void RenderThread::Start(GLFWwindow *window, std::function<void(void)> sync, std::function<void(RenderPacket *)> render){
+
+    window_ = window;
+    sync_ = sync;
+    render_ = render;
+    next_ = NULL;
+    stop_ = false;
+    error_ = nullptr;
+
+    // A context can only be current on one thread
+    glfwMakeContextCurrent(NULL);
+    thread_ = std::thread(&RenderThread::Run, this);
+}
+
+
+void RenderThread::Stop(void){
+
+    if (!thread_.joinable()){
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+    glfwMakeContextCurrent(window_);
+}
+
+
+bool RenderThread::IsRunning(void) const {
+
+    return thread_.joinable();
+}
+
+
+void RenderThread::Submit(RenderPacket *packet){
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!error_){
+        next_ = packet;
+        wake_.notify_one();
+        taken_.wait(lock, [this](){ return next_ == NULL; });
+    }
+    if (error_){
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+
+void RenderThread::Run(void){
+
+    glfwMakeContextCurrent(window_);
+    Profiler::SetThreadName("Render");
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true){
+        wake_.wait(lock, [this](){ return stop_ || next_ != NULL; });
+        if (!next_){
+            break;
+        }
+
+        // The main thread waits in Submit until the packet is taken
+        RenderPacket *packet = next_;
+        try {
+            sync_();
+        }
+        catch (...){
+            error_ = std::current_exception();
+        }
+        next_ = NULL;
+        taken_.notify_one();
+        if (error_){
+            break;
+        }
+
+        lock.unlock();
+        try {
+            render_(packet);
+        }
+        catch (...){
+            lock.lock();
+            error_ = std::current_exception();
+            break;
+        }
+        lock.lock();
+    }
+    lock.unlock();
+
+    glfwMakeContextCurrent(NULL);
+}
+
+} // namespace game
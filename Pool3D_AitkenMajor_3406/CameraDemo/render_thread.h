@@ -0,0 +1,63 @@
+#ifndef RENDER_THREAD_H_
+#define RENDER_THREAD_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "render_packet.h"
+
+namespace game {
+
+    // Thread that owns the GL context of a window and submits the frames built on the
+    // main thread, one frame behind: while it submits packet N, packet N + 1 is built.
+    // Submit hands a packet over and waits until the previous one is done, so the main
+    // thread is never more than one frame ahead
+    class RenderThread {
+
+        private:
+            std::thread thread_;
+            GLFWwindow *window_;
+            // Run with the main thread blocked in Submit (work on state both threads use)
+            std::function<void(void)> sync_;
+            // Submit a packet and present it
+            std::function<void(RenderPacket *)> render_;
+            std::mutex mutex_;
+            std::condition_variable wake_; // A packet was handed over, or the thread must stop
+            std::condition_variable taken_; // The handed packet was taken
+            RenderPacket *next_; // Handed over and not taken yet
+            bool stop_;
+            std::exception_ptr error_; // Thrown on the render thread, rethrown by Submit
+
+            // Thread loop: take each packet, run sync_ and then render_ on it
+            void Run(void);
+
+        public:
+            RenderThread(void);
+            // Stops the thread
+            ~RenderThread();
+
+            // Move the context of 'window' (current on the calling thread) to a new render
+            // thread. For each packet, 'sync' runs there while the caller is blocked in
+            // Submit, then 'render' runs while the caller builds the next packet
+            void Start(GLFWwindow *window, std::function<void(void)> sync, std::function<void(RenderPacket *)> render);
+            // Finish the packet being rendered and end the thread; the context becomes
+            // current on the calling thread again
+            void Stop(void);
+            bool IsRunning(void) const;
+
+            // Hand a packet to the render thread. Returns once it was taken (and 'sync' ran),
+            // which means the render thread is done with the previous packet. Rethrows an
+            // exception of the render thread
+            void Submit(RenderPacket *packet);
+
+    }; // class RenderThread
+
+} // namespace game
+
+#endif // RENDER_THREAD_H_
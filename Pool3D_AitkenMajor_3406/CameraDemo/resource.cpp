@@ -1,23 +1,63 @@
 #include <exception>
+#include <cfloat>
 
 #include "resource.h"
 
 namespace game {
 
+const char *material_feature_define_g[num_material_features_g] = { "SOLID_COLOR", "GRADIENT_COLOR" };
+
+
 Resource::Resource(ResourceType type, std::string name, GLuint resource, GLsizei size){
     type_ = type;
+    state_ = Ready;
     name_ = name;
+    id_ = 0;
     resource_ = resource;
     size_ = size;
+    vertex_format_ = &packed_vertex_format_g;
+    index_type_ = GL_UNSIGNED_INT;
+    base_vertex_ = 0;
+    first_index_ = 0;
+    position_offset_ = glm::vec3(0.0f);
+    position_scale_ = glm::vec3(1.0f);
+    bound_center_ = glm::vec3(0.0f);
+    bound_radius_ = 0.0f;
+    sphere_ = false;
+    sphere_color_ = glm::vec3(1.0f);
+    sphere_gradient_ = false;
+    material_features_ = 0;
+    vertex_num_ = 0;
+    ref_count_ = 0;
+    last_use_ = glfwGetTime();
+    memory_size_ = 0;
 }
 
 
 Resource::Resource(ResourceType type, std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size){
     type_ = type;
+    state_ = Ready;
     name_ = name;
+    id_ = 0;
     array_buffer_ = array_buffer;
     element_array_buffer_ = element_array_buffer;
     size_ = size;
+    vertex_format_ = &packed_vertex_format_g;
+    index_type_ = GL_UNSIGNED_INT;
+    base_vertex_ = 0;
+    first_index_ = 0;
+    position_offset_ = glm::vec3(0.0f);
+    position_scale_ = glm::vec3(1.0f);
+    bound_center_ = glm::vec3(0.0f);
+    bound_radius_ = 0.0f;
+    sphere_ = false;
+    sphere_color_ = glm::vec3(1.0f);
+    sphere_gradient_ = false;
+    material_features_ = 0;
+    vertex_num_ = 0;
+    ref_count_ = 0;
+    last_use_ = glfwGetTime();
+    memory_size_ = 0;
 }
 
 
@@ -32,12 +72,24 @@ ResourceType Resource::GetType(void) const {
 }
 
 
-const std::string Resource::GetName(void) const {
+const std::string &Resource::GetName(void) const {
 
     return name_;
 }
 
 
+void Resource::SetId(unsigned id){
+
+    id_ = id;
+}
+
+
+unsigned Resource::GetId(void) const {
+
+    return id_;
+}
+
+
 GLuint Resource::GetResource(void) const {
 
     return resource_;
@@ -61,4 +113,310 @@ GLsizei Resource::GetSize(void) const {
     return size_;
 }
 
+
+void Resource::SetVertexFormat(const VertexFormat *format, GLenum index_type){
+
+    vertex_format_ = format;
+    index_type_ = index_type;
+}
+
+
+const VertexFormat *Resource::GetVertexFormat(void) const {
+
+    return vertex_format_;
+}
+
+
+GLenum Resource::GetIndexType(void) const {
+
+    return index_type_;
+}
+
+
+void Resource::SetBufferRange(GLint base_vertex, GLuint first_index){
+
+    base_vertex_ = base_vertex;
+    first_index_ = first_index;
+}
+
+
+void Resource::SetVertexCount(GLsizei vertex_num){
+
+    vertex_num_ = vertex_num;
+}
+
+
+GLsizei Resource::GetVertexCount(void) const {
+
+    return vertex_num_;
+}
+
+
+GLint Resource::GetBaseVertex(void) const {
+
+    return base_vertex_;
+}
+
+
+GLuint Resource::GetFirstIndex(void) const {
+
+    return first_index_;
+}
+
+
+void Resource::SetPositionDequantization(const glm::vec3 &offset, const glm::vec3 &scale){
+
+    position_offset_ = offset;
+    position_scale_ = scale;
+}
+
+
+glm::mat4 Resource::GetPositionTransform(void) const {
+
+    // Scale, then translate
+    glm::mat4 transform(1.0f);
+    transform[0][0] = position_scale_.x;
+    transform[1][1] = position_scale_.y;
+    transform[2][2] = position_scale_.z;
+    transform[3] = glm::vec4(position_offset_, 1.0f);
+    return transform;
+}
+
+
+void Resource::SetResource(GLuint resource, GLsizei size){
+
+    resource_ = resource;
+    size_ = size;
+}
+
+
+void Resource::SetBuffers(GLuint array_buffer, GLuint element_array_buffer, GLsizei size){
+
+    array_buffer_ = array_buffer;
+    element_array_buffer_ = element_array_buffer;
+    size_ = size;
+}
+
+
+void Resource::SetState(ResourceState state){
+
+    state_ = state;
+}
+
+
+bool Resource::IsReady(void) const {
+
+    return state_ == Ready;
+}
+
+
+void Resource::SetBoundingSphere(const glm::vec3 &center, float radius){
+
+    bound_center_ = center;
+    bound_radius_ = radius;
+}
+
+
+glm::vec3 Resource::GetBoundingCenter(void) const {
+
+    return bound_center_;
+}
+
+
+float Resource::GetBoundingRadius(void) const {
+
+    return bound_radius_;
+}
+
+
+void Resource::AddLod(const Resource *lod, float max_screen_radius){
+
+    lod->AddRef();
+    lod_.push_back(lod);
+    lod_screen_radius_.push_back(max_screen_radius);
+}
+
+
+int Resource::GetLodCount(void) const {
+
+    return 1 + (int) lod_.size();
+}
+
+
+const Resource *Resource::GetLod(int level) const {
+
+    if (level <= 0){
+        return this;
+    }
+    return lod_[level - 1];
+}
+
+
+const Resource *Resource::GetReadyLod(int level) const {
+
+    // Coarser levels are built first and are cheaper than the one asked for
+    for (int l = level; l < GetLodCount(); l++){
+        if (GetLod(l)->IsReady()){
+            return GetLod(l);
+        }
+    }
+    for (int l = level - 1; l >= 0; l--){
+        if (GetLod(l)->IsReady()){
+            return GetLod(l);
+        }
+    }
+    return NULL;
+}
+
+
+float Resource::GetLodScreenRadius(int level) const {
+
+    // The full-detail level is used at any size
+    if (level <= 0){
+        return FLT_MAX;
+    }
+    return lod_screen_radius_[level - 1];
+}
+
+
+void Resource::SetSphereMaterial(const glm::vec3 &color, bool gradient_to_white){
+
+    sphere_ = true;
+    sphere_color_ = color;
+    sphere_gradient_ = gradient_to_white;
+}
+
+
+bool Resource::IsSphere(void) const {
+
+    return sphere_;
+}
+
+
+glm::vec3 Resource::GetSphereColor(void) const {
+
+    return sphere_color_;
+}
+
+
+bool Resource::GetSphereGradient(void) const {
+
+    return sphere_gradient_;
+}
+
+
+void Resource::SetMaterialFeatures(unsigned features){
+
+    material_features_ = features;
+}
+
+
+unsigned Resource::GetMaterialFeatures(void) const {
+
+    return material_features_;
+}
+
+
+GLuint Resource::GetProgram(unsigned features) const {
+
+    features &= material_features_;
+    for (const Variant &v : variant_){
+        if (v.features == features){
+            return v.program;
+        }
+    }
+
+    // First use of this combination
+    Variant v;
+    v.features = features;
+    v.program = 0;
+    v.requested = false;
+    variant_.push_back(v);
+    return 0;
+}
+
+
+void Resource::SetProgram(unsigned features, GLuint program){
+
+    for (Variant &v : variant_){
+        if (v.features == features){
+            v.program = program;
+            v.requested = true;
+            return;
+        }
+    }
+    Variant v;
+    v.features = features;
+    v.program = program;
+    v.requested = true;
+    variant_.push_back(v);
+}
+
+
+void Resource::TakeVariantRequests(std::vector<unsigned> &features){
+
+    for (Variant &v : variant_){
+        if (!v.requested){
+            features.push_back(v.features);
+            v.requested = true;
+        }
+    }
+}
+
+
+void Resource::GetPrograms(std::vector<GLuint> &program) const {
+
+    for (const Variant &v : variant_){
+        if (v.program){
+            program.push_back(v.program);
+        }
+    }
+}
+
+
+void Resource::AddRef(void) const {
+
+    ref_count_++;
+    last_use_ = glfwGetTime();
+}
+
+
+void Resource::Release(void) const {
+
+    if (ref_count_ > 0){
+        ref_count_--;
+    }
+    last_use_ = glfwGetTime();
+}
+
+
+int Resource::GetRefCount(void) const {
+
+    return ref_count_;
+}
+
+
+void Resource::MarkUsed(double time) const {
+
+    last_use_ = time;
+}
+
+
+double Resource::GetLastUse(void) const {
+
+    return last_use_;
+}
+
+
+void Resource::SetMemorySize(size_t size){
+
+    memory_size_ = size;
+}
+
+
+size_t Resource::GetMemorySize(void) const {
+
+    return memory_size_;
+}
+
 } // namespace game
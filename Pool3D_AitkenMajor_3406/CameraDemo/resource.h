@@ -2,21 +2,37 @@
 #define RESOURCE_H_
 
 #include <string>
+#include <vector>
 #define GLEW_STATIC
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include "vertex_format.h"
 
 namespace game {
 
     // Possible resource types
     typedef enum Type { Material, PointSet, Mesh, Texture } ResourceType;
+    const int num_resource_types_g = 4;
+
+    // Whether the GL objects of a resource exist yet (Pending: still being built or uploaded)
+    typedef enum Availability { Pending, Ready } ResourceState;
+
+    // Optional features of a material; a variant of the shader program is built for each
+    // combination used, with a #define per set flag (material_feature_define_g)
+    typedef enum Feature { SolidColorFeature = 1 << 0, GradientColorFeature = 1 << 1 } MaterialFeature;
+    const int num_material_features_g = 2;
+    extern const char *material_feature_define_g[num_material_features_g];
 
     // Class that holds one resource
     class Resource {
 
         private:
             ResourceType type_; // Type of resource
+            ResourceState state_; // Ready unless created by an asynchronous request
             std::string name_; // Reference name
+            unsigned id_; // Index in the resource manager (unique among live resources)
             union {
                 struct {
                     GLuint resource_; // OpenGL handle for resource
@@ -27,17 +43,103 @@ namespace game {
                 };
             };
             GLsizei size_; // Number of primitives in geometry
+            GLsizei vertex_num_; // Number of vertices in geometry
+            const VertexFormat *vertex_format_; // Layout of the vertex buffer
+            GLenum index_type_; // Type of the indices in the element buffer
+            GLint base_vertex_; // Position of the mesh in shared buffers (0 for own buffers)
+            GLuint first_index_;
+            glm::vec3 position_offset_; // Dequantization of the stored positions
+            glm::vec3 position_scale_;
+            glm::vec3 bound_center_; // Bounding sphere of geometry (object space)
+            float bound_radius_;
+            std::vector<const Resource *> lod_; // Lower levels of detail, finest first
+            std::vector<float> lod_screen_radius_; // Largest projected radius (pixels) of each level
+            bool sphere_; // Geometry is a colored sphere that can be drawn as an impostor
+            glm::vec3 sphere_color_;
+            bool sphere_gradient_;
+            // Material variants: programs by feature set (0 while being built)
+            struct Variant {
+                unsigned features;
+                GLuint program;
+                bool requested; // Handed to the resource manager for building
+            };
+            unsigned material_features_; // Features the material sources support
+            mutable std::vector<Variant> variant_;
+            // Users of the resource; only unreferenced resources are evicted
+            mutable int ref_count_;
+            mutable double last_use_; // Time the resource was last drawn, acquired or released
+            size_t memory_size_; // Bytes of GPU memory held by the GL objects
 
         public:
             Resource(ResourceType type, std::string name, GLuint resource, GLsizei size);
             Resource(ResourceType type, std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size);
             ~Resource();
             ResourceType GetType(void) const;
-            const std::string GetName(void) const;
+            const std::string &GetName(void) const;
+            // Index in the resource manager; the render queue sorts draws of one mesh together by it
+            void SetId(unsigned id);
+            unsigned GetId(void) const;
             GLuint GetResource(void) const;
             GLuint GetArrayBuffer(void) const;
             GLuint GetElementArrayBuffer(void) const;
             GLsizei GetSize(void) const;
+            // GL objects of a resource created before they existed
+            void SetResource(GLuint resource, GLsizei size);
+            void SetBuffers(GLuint array_buffer, GLuint element_array_buffer, GLsizei size);
+            void SetState(ResourceState state);
+            bool IsReady(void) const;
+            // Vertex layout and index type (packed_vertex_format_g and GL_UNSIGNED_INT by default)
+            void SetVertexFormat(const VertexFormat *format, GLenum index_type);
+            const VertexFormat *GetVertexFormat(void) const;
+            GLenum GetIndexType(void) const;
+            // Range of the mesh in its buffers: first vertex (added to every index) and
+            // first index, so several meshes can live in the same buffers
+            void SetBufferRange(GLint base_vertex, GLuint first_index);
+            void SetVertexCount(GLsizei vertex_num);
+            GLsizei GetVertexCount(void) const;
+            GLint GetBaseVertex(void) const;
+            GLuint GetFirstIndex(void) const;
+            // Stored positions decode as offset + scale * position; GetPositionTransform
+            // returns this as a matrix to append to the world transform
+            void SetPositionDequantization(const glm::vec3 &offset, const glm::vec3 &scale);
+            glm::mat4 GetPositionTransform(void) const;
+            void SetBoundingSphere(const glm::vec3 &center, float radius);
+            glm::vec3 GetBoundingCenter(void) const;
+            float GetBoundingRadius(void) const;
+            // Level-of-detail chain; level 0 is this resource and holds a reference to the others
+            void AddLod(const Resource *lod, float max_screen_radius);
+            int GetLodCount(void) const;
+            const Resource *GetLod(int level) const;
+            // Ready level closest to 'level', preferring coarser levels (null: none is ready)
+            const Resource *GetReadyLod(int level) const;
+            float GetLodScreenRadius(int level) const;
+            // Shading of a colored sphere (solid color or gradient towards white)
+            void SetSphereMaterial(const glm::vec3 &color, bool gradient_to_white);
+            bool IsSphere(void) const;
+            glm::vec3 GetSphereColor(void) const;
+            bool GetSphereGradient(void) const;
+            // Features a material supports (others are ignored when picking a variant)
+            void SetMaterialFeatures(unsigned features);
+            unsigned GetMaterialFeatures(void) const;
+            // Program of a material variant; 0 while it is built (the first call requests it)
+            GLuint GetProgram(unsigned features) const;
+            void SetProgram(unsigned features, GLuint program);
+            // Feature sets requested since the last call, still to be built
+            void TakeVariantRequests(std::vector<unsigned> &features);
+            // Programs of all built variants
+            void GetPrograms(std::vector<GLuint> &program) const;
+            // Reference counting by the users of the resource (scene nodes, level-of-detail
+            // chains); the resource manager may evict a resource with no references
+            void AddRef(void) const;
+            void Release(void) const;
+            int GetRefCount(void) const;
+            // Time (glfwGetTime) the resource was last drawn, acquired or released; eviction
+            // removes the least recently used resources first
+            void MarkUsed(double time) const;
+            double GetLastUse(void) const;
+            // GPU memory held by the GL objects, in bytes (set by the resource manager)
+            void SetMemorySize(size_t size);
+            size_t GetMemorySize(void) const;
 
     }; // class Resource
 
@@ -4,550 +4,933 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <utility>
+#include <algorithm>
+#include <iomanip>
+#include <iterator>
+#include <cstdio>
+#include <filesystem>
 
 #include "resource_manager.h"
+#include "mesh_generator.h"
+#include "static_mesh.h"
 
 namespace game {
 
-ResourceManager::ResourceManager(void){
+// Level-of-detail settings for procedural spheres
+const float lod_edge_pixels_g = 6.0f; // Longest silhouette edge (in pixels) a level may show
+
+// Built resources that may wait for their upload (workers block beyond this)
+const size_t upload_queue_size_g = 8;
+
+// Header of the files in the program cache
+const GLuint program_cache_magic_g = 0x4e494250; // "PBIN"
+
+
+ResourceManager::ResourceManager(RenderBackend *backend) : backend_(backend ? backend : GetGLBackend()), geometry_pool_(packed_vertex_format_g.stride, backend_){
+
+    stopping_ = false;
+    pending_ = 0;
+    shader_support_queried_ = false;
+    program_binary_ = false;
+    parallel_compile_ = false;
+    for (int t = 0; t < num_resource_types_g; t++){
+        memory_usage_[t] = 0;
+    }
+    memory_budget_ = 0;
+    evictions_ = 0;
 }
 
 
 ResourceManager::~ResourceManager(){
-}
 
+    // Release workers waiting for queue space; the worker pool then joins them
+    {
+        std::lock_guard<std::mutex> lock(staged_mutex_);
+        stopping_ = true;
+    }
+    staged_space_.notify_all();
+
+    // Without a context the GL objects are already gone
+    if (glfwGetCurrentContext()){
+        UnloadAll();
+    }
+}
 
-void ResourceManager::AddResource(ResourceType type, const std::string name, GLuint resource, GLsizei size){
 
-    Resource *res;
+Resource *ResourceManager::AddResource(ResourceType type, const std::string name, GLuint resource, GLsizei size){
 
-    res = new Resource(type, name, resource, size);
+    Handle<Resource> handle = resource_.Create(type, name, resource, size);
+    resource_index_.emplace(name, handle);
+    resource_.Get(handle)->SetId(handle.index);
 
-    resource_.push_back(res);
+    return resource_.Get(handle);
 }
 
 
-void ResourceManager::AddResource(ResourceType type, const std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size){
+Resource *ResourceManager::AddResource(ResourceType type, const std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size){
 
-    Resource *res;
-
-    res = new Resource(type, name, array_buffer, element_array_buffer, size);
+    Handle<Resource> handle = resource_.Create(type, name, array_buffer, element_array_buffer, size);
+    resource_index_.emplace(name, handle);
+    resource_.Get(handle)->SetId(handle.index);
 
-    resource_.push_back(res);
+    return resource_.Get(handle);
 }
 
 
-void ResourceManager::LoadResource(ResourceType type, const std::string name, const char *filename){
+void ResourceManager::LoadResource(ResourceType type, const std::string name, const char *filename, unsigned features){
 
     // Call appropriate method depending on type of resource
     if (type == Material){
-        LoadMaterial(name, filename);
+        LoadMaterial(name, filename, features);
     } else {
         throw(std::invalid_argument(std::string("Invalid type of resource")));
     }
 }
 
 
-Resource *ResourceManager::GetResource(const std::string name) const {
+Resource *ResourceManager::GetResource(const std::string &name) const {
+
+    return resource_.Get(GetResourceHandle(name));
+}
+
+
+Handle<Resource> ResourceManager::GetResourceHandle(const std::string &name) const {
+
+    auto found = resource_index_.find(name);
+    if (found == resource_index_.end()){
+        return Handle<Resource>();
+    }
+    return found->second;
+}
+
+
+Resource *ResourceManager::GetResource(Handle<Resource> handle) const {
+
+    return resource_.Get(handle);
+}
+
+
+bool ResourceManager::RemoveResource(Resource *res){
+
+    if (!res || res->GetRefCount() > 0 || !res->IsReady()){
+        return false;
+    }
+    Handle<Resource> handle = resource_.GetHandle(res);
+    DeleteObjects(res);
+
+    // The chain's references to the lower levels of detail go with it
+    for (int l = 1; l < res->GetLodCount(); l++){
+        res->GetLod(l)->Release();
+    }
+
+    const std::string name = res->GetName();
+    auto found = resource_index_.find(name);
+    if (found != resource_index_.end() && found->second == handle){
+        resource_index_.erase(found);
+    }
+    for (size_t i = 0; i < material_source_.size(); ){
+        if (material_source_[i].material == handle){
+            material_source_.erase(material_source_.begin() + i);
+        }
+        else {
+            i++;
+        }
+    }
+    resource_.Destroy(handle);
+
+    // Another resource with the same name becomes visible to GetResource
+    resource_.ForEach([this, &name](Resource &other){
+        if (other.GetName() == name){
+            resource_index_.emplace(name, resource_.GetHandle(&other));
+        }
+    });
+    return true;
+}
+
+
+void ResourceManager::UnloadAll(void){
+
+    for (const LinkingProgram &linking : linking_){
+        glDeleteShader(linking.vertex_shader);
+        glDeleteShader(linking.fragment_shader);
+        glDeleteProgram(linking.program);
+        pending_--;
+    }
+    linking_.clear();
+
+    resource_.ForEach([this](Resource &res){
+        DeleteObjects(&res);
+    });
+    geometry_pool_.Clear();
+}
+
+
+void ResourceManager::DeleteObjects(Resource *res){
+
+    // Pending resources have no GL objects (or they were deleted already)
+    if (!res->IsReady()){
+        return;
+    }
+    if (res->GetType() == Material){
+        std::vector<GLuint> program;
+        res->GetPrograms(program);
+        for (GLuint p : program){
+            glDeleteProgram(p);
+        }
+        res->SetResource(0, 0);
+    }
+    else if (res->GetIndexType() == GL_UNSIGNED_SHORT && res->GetArrayBuffer() != 0 && res->GetArrayBuffer() == geometry_pool_.GetArrayBuffer()){
+        // Range of the shared buffers, reused by later meshes
+        geometry_pool_.Remove(res->GetBaseVertex(), res->GetVertexCount(), res->GetFirstIndex(), res->GetSize());
+        res->SetBuffers(0, 0, 0);
+    }
+    else {
+        backend_->DeleteBuffer(res->GetArrayBuffer());
+        backend_->DeleteBuffer(res->GetElementArrayBuffer());
+        res->SetBuffers(0, 0, 0);
+    }
+    SetMemorySize(res, 0);
+    res->SetState(Pending);
+}
+
+
+void ResourceManager::SetMemorySize(Resource *res, size_t size){
+
+    size_t &usage = memory_usage_[res->GetType()];
+    usage = usage - res->GetMemorySize() + size;
+    res->SetMemorySize(size);
+}
+
+
+void ResourceManager::AddProgramMemory(Resource *res, GLuint program){
+
+    GLint length = 0;
+    if (program_binary_){
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    }
+    SetMemorySize(res, res->GetMemorySize() + length);
+}
+
+
+size_t ResourceManager::GetMemoryUsage(void) const {
+
+    size_t usage = 0;
+    for (int t = 0; t < num_resource_types_g; t++){
+        usage += memory_usage_[t];
+    }
+    return usage;
+}
+
+
+size_t ResourceManager::GetMemoryUsage(ResourceType type) const {
+
+    return memory_usage_[type];
+}
+
+
+void ResourceManager::SetMemoryBudget(size_t bytes){
+
+    memory_budget_ = bytes;
+}
+
+
+size_t ResourceManager::GetMemoryBudget(void) const {
+
+    return memory_budget_;
+}
+
+
+unsigned ResourceManager::GetEvictions(void) const {
+
+    return evictions_;
+}
+
+
+void ResourceManager::EvictResources(void){
+
+    if (memory_budget_ == 0 || GetMemoryUsage() <= memory_budget_){
+        return;
+    }
+
+    // Ready resources nobody uses, least recently used first
+    std::vector<Resource *> unused;
+    resource_.ForEach([&unused](Resource &res){
+        if (res.GetRefCount() == 0 && res.IsReady() && res.GetMemorySize() > 0){
+            unused.push_back(&res);
+        }
+    });
+    std::sort(unused.begin(), unused.end(), [](const Resource *a, const Resource *b){
+        return a->GetLastUse() < b->GetLastUse();
+    });
+
+    for (Resource *res : unused){
+        if (GetMemoryUsage() <= memory_budget_){
+            break;
+        }
+        RemoveResource(res);
+        evictions_++;
+    }
+}
+
+
+void ResourceManager::LoadMaterial(const std::string name, const char *prefix, unsigned features){
+
+    QueryShaderSupport();
+
+    // The resource becomes ready with the variant without features; the others are
+    // built when first drawn
+    Resource *res = AddPendingResource(Material, name);
+    res->SetMaterialFeatures(features);
+    MaterialSource source;
+    source.material = resource_.GetHandle(res);
+    source.prefix = prefix;
+    material_source_.push_back(source);
+    QueueProgram(res, source.prefix, 0);
+}
+
+
+// Specialize a shader source: a #define per feature, after the #version line
+static std::string AddFeatureDefines(const std::string &source, unsigned features){
+
+    if (features == 0){
+        return source;
+    }
+    size_t start = 0;
+    if (source.compare(0, 8, "#version") == 0){
+        start = source.find('\n');
+        start = (start == std::string::npos) ? source.size() : start + 1;
+    }
+    std::string defines;
+    for (int f = 0; f < num_material_features_g; f++){
+        if (features & (1u << f)){
+            defines += std::string("#define ") + material_feature_define_g[f] + " 1\n";
+        }
+    }
+    // Keep the line numbers of compile errors matching the file
+    int line = 1 + (int) std::count(source.begin(), source.begin() + start, '\n');
+    defines += "#line " + std::to_string(line) + "\n";
+    return source.substr(0, start) + defines + source.substr(start);
+}
+
+
+void ResourceManager::QueueProgram(Resource *res, const std::string &prefix, unsigned features){
+
+    // Read the sources (and a cached binary) on a worker; the program is made on the GL thread
+    std::string path(prefix);
+    std::string cache_directory = program_binary_ ? program_cache_directory_ : std::string();
+    std::string driver_key = driver_key_;
+    const AssetPack *pack = pack_.IsOpen() ? &pack_ : NULL;
+    QueueBuild(res, [path, features, cache_directory, driver_key, pack](StagedResource &staged){
+        staged.features = features;
+
+        // Load vertex program source code
+        std::string filename = path + std::string(VERTEX_PROGRAM_EXTENSION);
+        staged.vertex_source = AddFeatureDefines(LoadTextFile(filename.c_str(), pack), features);
+
+        // Load fragment program source code
+        filename = path + std::string(FRAGMENT_PROGRAM_EXTENSION);
+        staged.fragment_source = AddFeatureDefines(LoadTextFile(filename.c_str(), pack), features);
+
+        if (cache_directory.empty()){
+            return;
+        }
 
-    // Find resource with the specified name
-    for (int i = 0; i < resource_.size(); i++){
-        if (resource_[i]->GetName() == name){
-            return resource_[i];
+        // The binary is only valid for the same sources on the same driver
+        uint64_t key = HashName(driver_key);
+        key = HashName(staged.vertex_source, HashName(std::string(1, '\0'), key));
+        key = HashName(staged.fragment_source, HashName(std::string(1, '\0'), key));
+        std::stringstream cache_file;
+        cache_file << cache_directory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+        staged.cache_file = cache_file.str();
+
+        // A missing or unreadable entry just means compiling from source
+        std::ifstream f(staged.cache_file.c_str(), std::ios::in | std::ios::binary);
+        GLuint header[2];
+        if (!f.read((char *) header, sizeof(header)) || header[0] != program_cache_magic_g){
+            return;
         }
+        staged.program_format = header[1];
+        staged.program_binary.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    });
+}
+
+
+void ResourceManager::OpenPack(const std::string &filename){
+
+    pack_.Open(filename);
+}
+
+
+PackSpan ResourceManager::GetPackedFile(const std::string &filename) const {
+
+    if (!pack_.IsOpen()){
+        return PackSpan();
+    }
+    return pack_.FindFile(filename);
+}
+
+
+void ResourceManager::SetProgramCacheDirectory(const std::string &directory){
+
+    program_cache_directory_ = directory;
+    if (!directory.empty()){
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+    }
+}
+
+
+void ResourceManager::QueryShaderSupport(void){
+
+    if (shader_support_queried_){
+        return;
+    }
+    shader_support_queried_ = true;
+
+    GLint format_num = 0;
+    if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary){
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_num);
+    }
+    program_binary_ = format_num > 0;
+
+    parallel_compile_ = GLEW_KHR_parallel_shader_compile != 0;
+    if (parallel_compile_){
+        // Let the driver pick the number of compiler threads
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    }
+
+    const GLenum name[] = { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION };
+    for (GLenum n : name){
+        const GLubyte *value = glGetString(n);
+        driver_key_ += value ? std::string((const char *) value) : std::string();
+        driver_key_ += "\n";
+    }
+}
+
+
+// Store a linked program in its material; the variant without features is the resource itself
+static void SetMaterialProgram(Resource *res, unsigned features, GLuint program){
+
+    if (features == 0){
+        res->SetResource(program, 0);
     }
-    return NULL;
+    res->SetProgram(features, program);
 }
 
 
-void ResourceManager::LoadMaterial(const std::string name, const char *prefix){
+bool ResourceManager::UploadMaterial(StagedResource &staged, Resource *res){
 
-    // Load vertex program source code
-    std::string filename = std::string(prefix) + std::string(VERTEX_PROGRAM_EXTENSION);
-    std::string vp = LoadTextFile(filename.c_str());
+    // Warm start: the driver takes back the binary it produced for the same sources
+    if (!staged.program_binary.empty()){
+        GLuint sp = glCreateProgram();
+        glProgramBinary(sp, staged.program_format, staged.program_binary.data(), (GLsizei) staged.program_binary.size());
+        GLint status;
+        glGetProgramiv(sp, GL_LINK_STATUS, &status);
+        if (status == GL_TRUE){
+            SetMaterialProgram(res, staged.features, sp);
+            AddProgramMemory(res, sp);
+            return true;
+        }
+        // Rejected (e.g. by an updated driver): compile and replace the binary
+        glDeleteProgram(sp);
+    }
 
-    // Load fragment program source code
-    filename = std::string(prefix) + std::string(FRAGMENT_PROGRAM_EXTENSION);
-    std::string fp = LoadTextFile(filename.c_str());
+    LinkingProgram linking;
+    linking.target = staged.target;
+    linking.features = staged.features;
+    linking.cache_file = staged.cache_file;
 
     // Create a shader from the vertex program source code
-    GLuint vs = glCreateShader(GL_VERTEX_SHADER);
-    const char *source_vp = vp.c_str();
-    glShaderSource(vs, 1, &source_vp, NULL);
-    glCompileShader(vs);
+    linking.vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+    const char *source_vp = staged.vertex_source.c_str();
+    glShaderSource(linking.vertex_shader, 1, &source_vp, NULL);
+    glCompileShader(linking.vertex_shader);
 
-    // Check if shader compiled successfully
+    // Create a shader from the fragment program source code
+    linking.fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+    const char *source_fp = staged.fragment_source.c_str();
+    glShaderSource(linking.fragment_shader, 1, &source_fp, NULL);
+    glCompileShader(linking.fragment_shader);
+
+    // Create a shader program linking both vertex and fragment shaders
+    // together; the compile status is checked after the link, so that a
+    // parallel compile is not waited for here
+    linking.program = glCreateProgram();
+    glAttachShader(linking.program, linking.vertex_shader);
+    glAttachShader(linking.program, linking.fragment_shader);
+    // Keep "vertex" on attribute 0: compatibility contexts only draw when attribute 0 is enabled
+    glBindAttribLocation(linking.program, 0, "vertex");
+    if (!linking.cache_file.empty()){
+        glProgramParameteri(linking.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(linking.program);
+
+    if (parallel_compile_){
+        linking_.push_back(linking);
+        return false;
+    }
+    FinishMaterial(linking, res);
+    return true;
+}
+
+
+void ResourceManager::FinishMaterial(const LinkingProgram &linking, Resource *res){
+
+    // Check if shaders compiled successfully
     GLint status;
-    glGetShaderiv(vs, GL_COMPILE_STATUS, &status);
+    glGetShaderiv(linking.vertex_shader, GL_COMPILE_STATUS, &status);
     if (status != GL_TRUE){
         char buffer[512];
-        glGetShaderInfoLog(vs, 512, NULL, buffer);
+        glGetShaderInfoLog(linking.vertex_shader, 512, NULL, buffer);
         throw(std::ios_base::failure(std::string("Error compiling vertex shader: ")+std::string(buffer)));
     }
-
-    // Create a shader from the fragment program source code
-    GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
-    const char *source_fp = fp.c_str();
-    glShaderSource(fs, 1, &source_fp, NULL);
-    glCompileShader(fs);
-
-    // Check if shader compiled successfully
-    glGetShaderiv(fs, GL_COMPILE_STATUS, &status);
+    glGetShaderiv(linking.fragment_shader, GL_COMPILE_STATUS, &status);
     if (status != GL_TRUE){
         char buffer[512];
-        glGetShaderInfoLog(fs, 512, NULL, buffer);
+        glGetShaderInfoLog(linking.fragment_shader, 512, NULL, buffer);
         throw(std::ios_base::failure(std::string("Error compiling fragment shader: ")+std::string(buffer)));
     }
 
-    // Create a shader program linking both vertex and fragment shaders
-    // together
-    GLuint sp = glCreateProgram();
-    glAttachShader(sp, vs);
-    glAttachShader(sp, fs);
-    glLinkProgram(sp);
-
     // Check if shaders were linked successfully
-    glGetProgramiv(sp, GL_LINK_STATUS, &status);
+    glGetProgramiv(linking.program, GL_LINK_STATUS, &status);
     if (status != GL_TRUE){
         char buffer[512];
-        glGetProgramInfoLog(sp, 512, NULL, buffer);
+        glGetProgramInfoLog(linking.program, 512, NULL, buffer);
         throw(std::ios_base::failure(std::string("Error linking shaders: ")+std::string(buffer)));
     }
 
     // Delete memory used by shaders, since they were already compiled
     // and linked
-    glDeleteShader(vs);
-    glDeleteShader(fs);
+    glDeleteShader(linking.vertex_shader);
+    glDeleteShader(linking.fragment_shader);
+
+    // Save the binary for the next run; the file is written by a worker
+    GLint length = 0;
+    if (!linking.cache_file.empty()){
+        glGetProgramiv(linking.program, GL_PROGRAM_BINARY_LENGTH, &length);
+    }
+    if (length > 0){
+        std::vector<unsigned char> binary(length);
+        GLenum format;
+        glGetProgramBinary(linking.program, length, &length, &format, binary.data());
+        std::string cache_file = linking.cache_file;
+        worker_.Submit([cache_file, format, binary](){
+            // Write to a temporary file first, so a concurrent run never reads half a binary
+            std::string temporary = cache_file + ".tmp";
+            std::ofstream f(temporary.c_str(), std::ios::out | std::ios::binary);
+            GLuint header[2] = { program_cache_magic_g, format };
+            f.write((const char *) header, sizeof(header));
+            f.write((const char *) binary.data(), binary.size());
+            f.close();
+            if (f){
+                std::rename(temporary.c_str(), cache_file.c_str());
+            }
+            else {
+                std::remove(temporary.c_str());
+            }
+        });
+    }
+
+    SetMaterialProgram(res, linking.features, linking.program);
+    AddProgramMemory(res, linking.program);
+}
+
+
+void ResourceManager::PollPrograms(bool wait){
 
-    // Add a resource for the shader program
-    AddResource(Material, name, sp, 0);
+    for (size_t i = 0; i < linking_.size(); ){
+        GLint done = GL_TRUE;
+        if (!wait){
+            glGetProgramiv(linking_[i].program, GL_COMPLETION_STATUS_KHR, &done);
+        }
+        if (!done){
+            i++;
+            continue;
+        }
+
+        LinkingProgram linking = linking_[i];
+        linking_.erase(linking_.begin() + i);
+        pending_--;
+        Resource *res = resource_.Get(linking.target);
+        if (res){
+            FinishMaterial(linking, res);
+            res->SetState(Ready);
+        }
+        else {
+            // The material was removed while its variant was linking
+            glDeleteShader(linking.vertex_shader);
+            glDeleteShader(linking.fragment_shader);
+            glDeleteProgram(linking.program);
+        }
+    }
 }
 
 
-std::string ResourceManager::LoadTextFile(const char *filename){
+std::string ResourceManager::LoadTextFile(const char *filename, const AssetPack *pack){
+
+    // Bundled in the asset pack: no file to open
+    if (pack){
+        PackSpan bundled = pack->FindFile(filename);
+        if (bundled.data){
+            return std::string((const char *) bundled.data, bundled.size);
+        }
+    }
 
     // Open file
     std::ifstream f;
-    f.open(filename);
+    f.open(filename, std::ios::in | std::ios::binary);
     if (f.fail()){
         throw(std::ios_base::failure(std::string("Error opening file ")+std::string(filename)));
     }
 
-    // Read file
-    std::string content;
-    std::string line;
-    while(std::getline(f, line)){
-        content += line + "\n";
-    }
+    // Read the whole file at once
+    std::stringstream content;
+    content << f.rdbuf();
 
     // Close file
     f.close();
 
-    return content;
+    return content.str();
 }
 
 
-void ResourceManager::CreateSphere(std::string object_name, float radius, int num_samples_theta, int num_samples_phi){
+Resource *ResourceManager::AddPendingResource(ResourceType type, const std::string &name){
 
-    // Create a sphere using a well-known parameterization
-
-    // Number of vertices and faces to be created
-    const GLuint vertex_num = num_samples_theta*num_samples_phi;
-    const GLuint face_num = num_samples_theta*(num_samples_phi-1)*2;
-
-    // Number of attributes for vertices and faces
-    const int vertex_att = 11;
-    const int face_att = 3;
-
-    // Data buffers 
-    GLfloat *vertex = NULL;
-    GLuint *face = NULL;
-
-    // Allocate memory for buffers
-    try {
-        vertex = new GLfloat[vertex_num * vertex_att]; // 11 attributes per vertex: 3D position (3), 3D normal (3), RGB color (3), 2D texture coordinates (2)
-        face = new GLuint[face_num * face_att]; // 3 indices per face
-    }
-    catch  (std::exception &e){
-        throw e;
-    }
-
-    // Create vertices 
-    float theta, phi; // Angles for parametric equation
-    glm::vec3 vertex_position;
-    glm::vec3 vertex_normal;
-    glm::vec3 vertex_color;
-    glm::vec2 vertex_coord;
-   
-    for (int i = 0; i < num_samples_theta; i++){
-            
-        theta = 2.0*glm::pi<GLfloat>()*i/(num_samples_theta-1); // angle theta
-            
-        for (int j = 0; j < num_samples_phi; j++){
-                    
-            phi = glm::pi<GLfloat>()*j/(num_samples_phi-1); // angle phi
-
-            // Define position, normal and color of vertex
-            vertex_normal = glm::vec3(cos(theta)*sin(phi), sin(theta)*sin(phi), -cos(phi));
-            // We need z = -cos(phi) to make sure that the z coordinate runs from -1 to 1 as phi runs from 0 to pi
-            // Otherwise, the normal will be inverted
-            vertex_position = glm::vec3(vertex_normal.x*radius, 
-                                        vertex_normal.y*radius, 
-                                        vertex_normal.z*radius),
-            vertex_color = glm::vec3(((float)i)/((float)num_samples_theta), 1.0-((float)j)/((float)num_samples_phi), ((float)j)/((float)num_samples_phi));
-            vertex_coord = glm::vec2(((float)i)/((float)num_samples_theta), 1.0-((float)j)/((float)num_samples_phi));
-
-            // Add vectors to the data buffer
-            for (int k = 0; k < 3; k++){
-                vertex[(i*num_samples_phi+j)*vertex_att + k] = vertex_position[k];
-                vertex[(i*num_samples_phi+j)*vertex_att + k + 3] = vertex_normal[k];
-                vertex[(i*num_samples_phi+j)*vertex_att + k + 6] = vertex_color[k];
-            }
-            vertex[(i*num_samples_phi+j)*vertex_att + 9] = vertex_coord[0];
-            vertex[(i*num_samples_phi+j)*vertex_att + 10] = vertex_coord[1];
+    Resource *res;
+    if (type == Material){
+        res = AddResource(type, name, 0, 0);
+    }
+    else {
+        res = AddResource(type, name, 0, 0, 0);
+    }
+    res->SetState(Pending);
+    return res;
+}
+
+
+void ResourceManager::QueueBuild(Resource *res, std::function<void(StagedResource &)> build){
+
+    Handle<Resource> target = resource_.GetHandle(res);
+    pending_++;
+    worker_.Submit([this, target, build](){
+        StagedResource staged;
+        staged.target = target;
+        try {
+            build(staged);
+        }
+        catch (std::exception &e){
+            // Reported on the GL thread when the resource would be uploaded
+            staged.error = e.what();
+        }
+
+        std::unique_lock<std::mutex> lock(staged_mutex_);
+        staged_space_.wait(lock, [this](){ return stopping_ || staged_.size() < upload_queue_size_g; });
+        if (stopping_){
+            return;
+        }
+        staged_.push_back(std::move(staged));
+        staged_ready_.notify_one();
+    });
+}
+
+
+// View of a mesh entry of an asset pack (false if the entry is malformed)
+static bool GetPackedMesh(PackSpan packed, MeshView &view){
+
+    const PackMeshHeader *header = (const PackMeshHeader *) packed.data;
+    size_t size = packed.size;
+    if (size < sizeof(PackMeshHeader) || (header->index_size != 2 && header->index_size != 4) ||
+        header->vertex_offset > size || (size - header->vertex_offset) / packed_vertex_format_g.stride < header->vertex_num ||
+        header->index_offset > size || (size - header->index_offset) / header->index_size < header->index_num){
+        return false;
+    }
+    view.vertex = packed.data + header->vertex_offset;
+    view.vertex_num = header->vertex_num;
+    view.index = packed.data + header->index_offset;
+    view.index_num = (GLsizei) header->index_num;
+    view.index_type = (header->index_size == 2) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    view.position_offset = glm::vec3(header->position_offset[0], header->position_offset[1], header->position_offset[2]);
+    view.position_scale = glm::vec3(header->position_scale[0], header->position_scale[1], header->position_scale[2]);
+    return true;
+}
+
+
+void ResourceManager::QueueMesh(Resource *res, const std::string &description, std::function<void(MeshData &)> generate){
+
+    // Pre-generated meshes need no build: compiled into the executable, or in the asset
+    // pack. The upload reads them in place
+    MeshView packed;
+    const MeshView *compiled = FindStaticMesh(description);
+    if (compiled){
+        packed = *compiled;
+    }
+    else if (pack_.IsOpen()){
+        PackSpan entry = pack_.Find(HashName(description), PackedMesh);
+        if (entry.data && !GetPackedMesh(entry, packed)){
+            throw(std::ios_base::failure(std::string("Invalid packed mesh ")+description));
         }
     }
+    if (!packed.vertex){
+        QueueBuild(res, [generate](StagedResource &staged){
+            generate(staged.mesh);
+        });
+        return;
+    }
+
+    StagedResource staged;
+    staged.target = resource_.GetHandle(res);
+    staged.packed = packed;
+    pending_++;
+    {
+        // Not bounded: only workers wait for queue space
+        std::lock_guard<std::mutex> lock(staged_mutex_);
+        staged_.push_back(std::move(staged));
+    }
+    staged_ready_.notify_one();
+}
+
+
+int ResourceManager::ProcessUploads(double budget){
 
-    // Create faces
-    for (int i = 0; i < num_samples_theta; i++){
-        for (int j = 0; j < (num_samples_phi-1); j++){
-            // Two triangles per quad
-            glm::vec3 t1(((i + 1) % num_samples_theta)*num_samples_phi + j, 
-                         i*num_samples_phi + (j + 1),
-                         i*num_samples_phi + j);
-            glm::vec3 t2(((i + 1) % num_samples_theta)*num_samples_phi + j, 
-                         ((i + 1) % num_samples_theta)*num_samples_phi + (j + 1), 
-                         i*num_samples_phi + (j + 1));
-            // Add two triangles to the data buffer
-            for (int k = 0; k < 3; k++){
-                face[(i*(num_samples_phi-1)+j)*face_att*2 + k] = (GLuint) t1[k];
-                face[(i*(num_samples_phi-1)+j)*face_att*2 + k + face_att] = (GLuint) t2[k];
+    double deadline = glfwGetTime() + budget;
+    QueueVariants();
+    PollPrograms(false);
+    while (pending_ > 0){
+        StagedResource staged;
+        {
+            std::lock_guard<std::mutex> lock(staged_mutex_);
+            if (staged_.empty()){
+                break;
             }
+            staged = std::move(staged_.front());
+            staged_.pop_front();
+        }
+        staged_space_.notify_one();
+
+        Upload(staged);
+        if (glfwGetTime() >= deadline){
+            break;
         }
     }
+    EvictResources();
+    return pending_;
+}
+
 
-    // Create OpenGL buffers and copy data
-    //GLuint vao;
-    //glGenVertexArrays(1, &vao);
-    //glBindVertexArray(vao);
+void ResourceManager::FinishLoading(void){
 
-    GLuint vbo, ebo;
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertex_num * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
+    while (pending_ > 0){
+        if (pending_ == (int) linking_.size()){
+            // Only programs are left: wait for their links
+            PollPrograms(true);
+            continue;
+        }
+        {
+            std::unique_lock<std::mutex> lock(staged_mutex_);
+            staged_ready_.wait(lock, [this](){ return !staged_.empty(); });
+        }
+        ProcessUploads(0.0);
+    }
+}
 
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, face_num * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
 
-    // Free data buffers
-    delete [] vertex;
-    delete [] face;
+void ResourceManager::QueueVariants(void){
 
-    // Create resource
-    AddResource(Mesh, object_name, vbo, ebo, face_num * face_att);
+    std::vector<unsigned> features;
+    for (const MaterialSource &source : material_source_){
+        Resource *res = resource_.Get(source.material);
+        if (!res || !res->IsReady()){
+            continue;
+        }
+        features.clear();
+        res->TakeVariantRequests(features);
+        for (unsigned f : features){
+            QueueProgram(res, source.prefix, f);
+        }
+    }
 }
 
-void ResourceManager::CreateColoredSphere(std::string object_name, const glm::vec3 &color, bool gradient_to_white, float radius, int num_samples_theta, int num_samples_phi) {
 
-    // Create a sphere using a parametric parameterization, identical topology to CreateSphere
-    const GLuint vertex_num = num_samples_theta * num_samples_phi;
-    const GLuint face_num = num_samples_theta * (num_samples_phi - 1) * 2;
-    const int vertex_att = 11;
-    const int face_att = 3;
-
-    GLfloat *vertex = NULL;
-    GLuint *face = NULL;
-
-    try {
-        vertex = new GLfloat[vertex_num * vertex_att];
-        face = new GLuint[face_num * face_att];
-    }
-    catch (std::exception &e) {
-        throw e;
-    }
-
-    float theta, phi;
-    glm::vec3 vertex_position;
-    glm::vec3 vertex_normal;
-    glm::vec3 vertex_color;
-    glm::vec2 vertex_coord;
-
-    for (int i = 0; i < num_samples_theta; i++) {
-        theta = 2.0f * glm::pi<GLfloat>() * i / (num_samples_theta - 1);
-        for (int j = 0; j < num_samples_phi; j++) {
-            phi = glm::pi<GLfloat>() * j / (num_samples_phi - 1);
-
-            vertex_normal = glm::vec3(cos(theta) * sin(phi), sin(theta) * sin(phi), -cos(phi));
-            vertex_position = glm::vec3(vertex_normal.x * radius, vertex_normal.y * radius, vertex_normal.z * radius);
-
-            // Choose color: either solid 'color' or interpolated towards white
-            if (!gradient_to_white) {
-                vertex_color = color;
-            } else {
-                // Interpolate toward white based on the hemisphere: more white near +Y surface
-                // t in [0,1], compute from normal.y so poles interpolate more to white
-                float t = glm::clamp(0.5f * (1.0f - vertex_normal.y), 0.0f, 1.0f);
-                vertex_color = (1.0f - t) * color + t * glm::vec3(1.0f);
-            }
+bool ResourceManager::IsLoading(void) const {
+
+    return pending_ > 0;
+}
 
-            vertex_coord = glm::vec2(((float)i) / ((float)num_samples_theta), 1.0f - ((float)j) / ((float)num_samples_phi));
 
-            for (int k = 0; k < 3; k++) {
-                vertex[(i * num_samples_phi + j) * vertex_att + k] = vertex_position[k];
-                vertex[(i * num_samples_phi + j) * vertex_att + k + 3] = vertex_normal[k];
-                vertex[(i * num_samples_phi + j) * vertex_att + k + 6] = vertex_color[k];
-            }
-            vertex[(i * num_samples_phi + j) * vertex_att + 9] = vertex_coord[0];
-            vertex[(i * num_samples_phi + j) * vertex_att + 10] = vertex_coord[1];
+int ResourceManager::GetPendingCount(void) const {
+
+    return pending_;
+}
+
+
+void ResourceManager::Upload(StagedResource &staged){
+
+    Resource *res = resource_.Get(staged.target);
+    if (!res){
+        pending_--;
+        return;
+    }
+    if (!staged.error.empty()){
+        pending_--;
+        throw(std::ios_base::failure(staged.error));
+    }
+
+    if (res->GetType() == Material){
+        if (!UploadMaterial(staged, res)){
+            // Still linking: finished by PollPrograms
+            return;
         }
     }
+    else {
+        UploadMesh(staged, res);
+    }
+    res->SetState(Ready);
+    pending_--;
+}
 
-    // Create faces (same as CreateSphere)
-    for (int i = 0; i < num_samples_theta; i++) {
-        for (int j = 0; j < (num_samples_phi - 1); j++) {
-            glm::vec3 t1(((i + 1) % num_samples_theta) * num_samples_phi + j,
-                         i * num_samples_phi + (j + 1),
-                         i * num_samples_phi + j);
-            glm::vec3 t2(((i + 1) % num_samples_theta) * num_samples_phi + j,
-                         ((i + 1) % num_samples_theta) * num_samples_phi + (j + 1),
-                         i * num_samples_phi + (j + 1));
-            for (int k = 0; k < 3; k++) {
-                face[(i * (num_samples_phi - 1) + j) * face_att * 2 + k] = (GLuint)t1[k];
-                face[(i * (num_samples_phi - 1) + j) * face_att * 2 + k + face_att] = (GLuint)t2[k];
-            }
+
+void ResourceManager::UploadMesh(StagedResource &staged, Resource *res){
+
+    MeshView view = staged.packed;
+    std::vector<GLushort> short_index;
+    if (!view.vertex){
+        const MeshData &mesh = staged.mesh;
+        view.vertex = mesh.vertex.data();
+        view.vertex_num = (GLuint) (mesh.vertex.size() / packed_vertex_format_g.stride);
+        view.index_num = (GLsizei) mesh.index.size();
+        view.position_offset = mesh.position_offset;
+        view.position_scale = mesh.position_scale;
+        if (view.vertex_num <= 0x10000){
+            // 16-bit indices can address every vertex
+            short_index.assign(mesh.index.begin(), mesh.index.end());
+            view.index = short_index.data();
+            view.index_type = GL_UNSIGNED_SHORT;
+        }
+        else {
+            view.index = mesh.index.data();
+            view.index_type = GL_UNSIGNED_INT;
+        }
+    }
+
+    if (view.index_type == GL_UNSIGNED_SHORT){
+        // Store the mesh in the shared buffers
+        GLint base_vertex;
+        GLuint first_index;
+        GLuint array_buffer = geometry_pool_.GetArrayBuffer();
+        GLuint element_array_buffer = geometry_pool_.GetElementArrayBuffer();
+        geometry_pool_.Add(view.vertex, view.vertex_num, (const GLushort *) view.index, view.index_num, base_vertex, first_index);
+        if (array_buffer && (geometry_pool_.GetArrayBuffer() != array_buffer || geometry_pool_.GetElementArrayBuffer() != element_array_buffer)){
+            // The pool grew into new buffers: move the meshes already in it over
+            resource_.ForEach([&](Resource &other){
+                if (other.GetIndexType() == GL_UNSIGNED_SHORT && other.GetArrayBuffer() == array_buffer){
+                    other.SetBuffers(geometry_pool_.GetArrayBuffer(), geometry_pool_.GetElementArrayBuffer(), other.GetSize());
+                }
+            });
         }
+        res->SetBuffers(geometry_pool_.GetArrayBuffer(), geometry_pool_.GetElementArrayBuffer(), view.index_num);
+        res->SetVertexFormat(&packed_vertex_format_g, GL_UNSIGNED_SHORT);
+        res->SetBufferRange(base_vertex, first_index);
     }
+    else {
+        // Large mesh with 32-bit indices in its own buffers
+        GLuint vbo = backend_->CreateBuffer();
+        backend_->BindBuffer(GL_ARRAY_BUFFER, vbo);
+        backend_->BufferData(GL_ARRAY_BUFFER, (GLsizeiptr) view.vertex_num * packed_vertex_format_g.stride, view.vertex, GL_STATIC_DRAW);
+        GLuint ebo = backend_->CreateBuffer();
+        backend_->BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        backend_->BufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr) view.index_num * sizeof(GLuint), view.index, GL_STATIC_DRAW);
+        res->SetBuffers(vbo, ebo, view.index_num);
+        res->SetVertexFormat(&packed_vertex_format_g, GL_UNSIGNED_INT);
+    }
+    res->SetVertexCount((GLsizei) view.vertex_num);
+    res->SetPositionDequantization(view.position_offset, view.position_scale);
+    size_t index_size = (view.index_type == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+    SetMemorySize(res, (size_t) view.vertex_num * packed_vertex_format_g.stride + (size_t) view.index_num * index_size);
+}
 
-    // Upload to GL
-    GLuint vbo, ebo;
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertex_num * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
 
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, face_num * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
+void ResourceManager::CreateSphere(std::string object_name, float radius, int num_samples_theta, int num_samples_phi){
 
-    delete[] vertex;
-    delete[] face;
+    // Full-detail sphere, followed by its lower levels of detail
+    std::vector<int> theta, phi;
+    GetSphereLevels(num_samples_theta, num_samples_phi, theta, phi);
+    std::vector<Resource *> level;
+    for (size_t l = 0; l < theta.size(); l++){
+        std::string name = (l == 0) ? object_name : object_name + "_LOD" + std::to_string(l);
+        level.push_back(AddPendingResource(Mesh, name));
+        // The sphere is centered at the origin
+        level[l]->SetBoundingSphere(glm::vec3(0.0f), radius);
+        if (l > 0){
+            level[0]->AddLod(level[l], LodScreenRadius(theta[l]));
+        }
+    }
 
-    AddResource(Mesh, object_name, vbo, ebo, face_num * face_att);
+    // Coarsest level first, so something can be drawn early
+    for (int l = (int) level.size() - 1; l >= 0; l--){
+        int t = theta[l], p = phi[l];
+        QueueMesh(level[l], DescribeSphere(radius, t, p), [radius, t, p](MeshData &mesh){
+            GenerateSphere(radius, t, p, mesh);
+        });
+    }
 }
 
-void ResourceManager::CreateTorus(std::string object_name, float loop_radius, float circle_radius, int num_loop_samples, int num_circle_samples) {
 
-    // Increase torus loop radius by 50% to make diameter 50% larger
-    float loopR = loop_radius * 1.5f;
-    float tubeR = circle_radius;
-
-    // Number of vertices and faces
-    const GLuint vertex_num = num_loop_samples * num_circle_samples;
-    const GLuint face_num = num_loop_samples * num_circle_samples * 2;
-
-    // Attributes: position(3), normal(3), color(3), texcoord(2)
-    const int vertex_att = 11;
-    const int face_att = 3;
-
-    GLfloat* vertex = nullptr;
-    GLuint* face = nullptr;
-
-    try {
-        vertex = new GLfloat[vertex_num * vertex_att];
-        face = new GLuint[face_num * face_att];
-    }
-    catch (std::exception &e) {
-        throw e;
-    }
-
-    // Build vertices
-    for (int i = 0; i < num_loop_samples; ++i) {
-        float u = 2.0f * glm::pi<float>() * i / num_loop_samples; // loop angle
-        float cu = cos(u), su = sin(u);
-        for (int j = 0; j < num_circle_samples; ++j) {
-            float v = 2.0f * glm::pi<float>() * j / num_circle_samples; // tube angle
-            float cv = cos(v), sv = sin(v);
-
-            // Position using scaled loopR and tubeR
-            float x = (loopR + tubeR * cv) * cu;
-            float y = (loopR + tubeR * cv) * su;
-            float z = tubeR * sv;
-
-            // Normal: vector from tube center to surface point (normalized)
-            glm::vec3 n = glm::normalize(glm::vec3(cu * cv, su * cv, sv));
-
-            // Color: slightly darker grey for guides
-            glm::vec3 color = glm::vec3(0.3f, 0.3f, 0.3f);
-
-            // Texcoords
-            float s = (float)i / (float)num_loop_samples;
-            float t = (float)j / (float)num_circle_samples;
-
-            int idx = (i * num_circle_samples + j) * vertex_att;
-            vertex[idx + 0] = x;
-            vertex[idx + 1] = y;
-            vertex[idx + 2] = z;
-            vertex[idx + 3] = n.x;
-            vertex[idx + 4] = n.y;
-            vertex[idx + 5] = n.z;
-            vertex[idx + 6] = color.x;
-            vertex[idx + 7] = color.y;
-            vertex[idx + 8] = color.z;
-            vertex[idx + 9] = s;
-            vertex[idx + 10] = t;
+void ResourceManager::CreateColoredSphere(std::string object_name, const glm::vec3 &color, bool gradient_to_white, float radius, int num_samples_theta, int num_samples_phi) {
+
+    // Full-detail sphere, followed by its lower levels of detail
+    std::vector<int> theta, phi;
+    GetSphereLevels(num_samples_theta, num_samples_phi, theta, phi);
+    std::vector<Resource *> level;
+    for (size_t l = 0; l < theta.size(); l++) {
+        std::string name = (l == 0) ? object_name : object_name + "_LOD" + std::to_string(l);
+        level.push_back(AddPendingResource(Mesh, name));
+        level[l]->SetBoundingSphere(glm::vec3(0.0f), radius);
+        // Shading is analytic, so the sphere can also be ray-cast as an impostor
+        level[l]->SetSphereMaterial(color, gradient_to_white);
+        if (l > 0) {
+            level[0]->AddLod(level[l], LodScreenRadius(theta[l]));
         }
     }
 
-    // Build faces (two triangles per quad, wrapping on both dimensions)
-    int fidx = 0;
-    for (int i = 0; i < num_loop_samples; ++i) {
-        int inext = (i + 1) % num_loop_samples;
-        for (int j = 0; j < num_circle_samples; ++j) {
-            int jnext = (j + 1) % num_circle_samples;
-
-            // indices of quad corners
-            GLuint a = i * num_circle_samples + j;
-            GLuint b = inext * num_circle_samples + j;
-            GLuint c = inext * num_circle_samples + jnext;
-            GLuint d = i * num_circle_samples + jnext;
-
-            // triangle 1: a, b, d
-            face[fidx * face_att + 0] = a;
-            face[fidx * face_att + 1] = b;
-            face[fidx * face_att + 2] = d;
-            ++fidx;
-
-            // triangle 2: b, c, d
-            face[fidx * face_att + 0] = b;
-            face[fidx * face_att + 1] = c;
-            face[fidx * face_att + 2] = d;
-            ++fidx;
-        }
+    // Coarsest level first, so something can be drawn early
+    for (int l = (int) level.size() - 1; l >= 0; l--) {
+        int t = theta[l], p = phi[l];
+        glm::vec3 c = color;
+        QueueMesh(level[l], DescribeColoredSphere(c, gradient_to_white, radius, t, p), [c, gradient_to_white, radius, t, p](MeshData &mesh) {
+            GenerateColoredSphere(c, gradient_to_white, radius, t, p, mesh);
+        });
     }
+}
+
 
-    // Upload to GL buffers
-    GLuint vbo, ebo;
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertex_num * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
+float ResourceManager::LodScreenRadius(int num_samples_theta) {
 
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, face_num * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
+    // A level is used while the edges around its silhouette stay below
+    // lod_edge_pixels_g: circumference (2*pi*r) / number of segments
+    return num_samples_theta * lod_edge_pixels_g / (2.0f * glm::pi<float>());
+}
 
-    // Free CPU memory
-    delete[] vertex;
-    delete[] face;
+void ResourceManager::CreateTorus(std::string object_name, float loop_radius, float circle_radius, int num_loop_samples, int num_circle_samples) {
 
-    // Register resource
-    AddResource(Mesh, object_name, vbo, ebo, face_num * face_att);
+    Resource *res = AddPendingResource(Mesh, object_name);
+    // The outer edge of the tube bounds the torus
+    res->SetBoundingSphere(glm::vec3(0.0f), loop_radius * torus_loop_scale_g + circle_radius);
+    QueueMesh(res, DescribeTorus(loop_radius, circle_radius, num_loop_samples, num_circle_samples), [=](MeshData &mesh) {
+        GenerateTorus(loop_radius, circle_radius, num_loop_samples, num_circle_samples, mesh);
+    });
 }
 
+
 void ResourceManager::CreateBox(std::string object_name, float width, float height, float depth) {
 
-    // Box centered at origin, depth along +Z. We'll create 8 vertices and 12 triangles.
-    const int vertex_att = 11;
-    const int face_att = 3;
-
-    const GLuint vertex_num = 8;
-    const GLuint face_num = 12;
-
-    GLfloat *vertex = nullptr;
-    GLuint *face = nullptr;
-
-    try {
-        vertex = new GLfloat[vertex_num * vertex_att];
-        face = new GLuint[face_num * face_att];
-    } catch (std::exception &e) {
-        throw e;
-    }
-
-    float hx = width * 0.5f;
-    float hy = height * 0.5f;
-    float hz = depth * 0.5f;
-
-    // Define 8 corner positions
-    glm::vec3 positions[8] = {
-        glm::vec3(-hx, -hy, -hz),
-        glm::vec3( hx, -hy, -hz),
-        glm::vec3( hx,  hy, -hz),
-        glm::vec3(-hx,  hy, -hz),
-        glm::vec3(-hx, -hy,  hz),
-        glm::vec3( hx, -hy,  hz),
-        glm::vec3( hx,  hy,  hz),
-        glm::vec3(-hx,  hy,  hz)
-    };
-
-    // Per-vertex normals (we'll assign averaged normals per face corners to keep it simple)
-    glm::vec3 normals[8] = {
-        glm::vec3(-1,-1,-1),
-        glm::vec3( 1,-1,-1),
-        glm::vec3( 1, 1,-1),
-        glm::vec3(-1, 1,-1),
-        glm::vec3(-1,-1, 1),
-        glm::vec3( 1,-1, 1),
-        glm::vec3( 1, 1, 1),
-        glm::vec3(-1, 1, 1)
-    };
-    for (int i = 0; i < 8; ++i) normals[i] = glm::normalize(normals[i]);
-
-    // Color: white (alpha handled by shader if supported)
-    glm::vec3 color(1.0f, 1.0f, 1.0f);
-
-    // Texcoords (not important)
-    glm::vec2 uvs[8] = {
-        glm::vec2(0.0f,0.0f), glm::vec2(1.0f,0.0f), glm::vec2(1.0f,1.0f), glm::vec2(0.0f,1.0f),
-        glm::vec2(0.0f,0.0f), glm::vec2(1.0f,0.0f), glm::vec2(1.0f,1.0f), glm::vec2(0.0f,1.0f)
-    };
-
-    // Fill vertex buffer (position, normal, color, uv)
-    for (int i = 0; i < 8; ++i) {
-        int idx = i * vertex_att;
-        vertex[idx + 0] = positions[i].x;
-        vertex[idx + 1] = positions[i].y;
-        vertex[idx + 2] = positions[i].z;
-        vertex[idx + 3] = normals[i].x;
-        vertex[idx + 4] = normals[i].y;
-        vertex[idx + 5] = normals[i].z;
-        vertex[idx + 6] = color.x;
-        vertex[idx + 7] = color.y;
-        vertex[idx + 8] = color.z;
-        vertex[idx + 9] = uvs[i].x;
-        vertex[idx + 10] = uvs[i].y;
-    }
-
-    // Index order (12 triangles)
-    GLuint inds[36] = {
-        // back face (-Z)
-        0,1,2, 0,2,3,
-        // front face (+Z)
-        4,6,5, 4,7,6,
-        // left face (-X)
-        0,3,7, 0,7,4,
-        // right face (+X)
-        1,5,6, 1,6,2,
-        // bottom face (-Y)
-        0,4,5, 0,5,1,
-        // top face (+Y)
-        3,2,6, 3,6,7
-    };
-
-    for (int i = 0; i < face_num * face_att; ++i) face[i] = inds[i];
-
-    // Upload to GL
-    GLuint vbo, ebo;
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertex_num * vertex_att * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
-
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, face_num * face_att * sizeof(GLuint), face, GL_STATIC_DRAW);
-
-    delete[] vertex;
-    delete[] face;
-
-    AddResource(Mesh, object_name, vbo, ebo, face_num * face_att);
+    Resource *res = AddPendingResource(Mesh, object_name);
+    // Bounding sphere passes through the corners
+    res->SetBoundingSphere(glm::vec3(0.0f), 0.5f * glm::length(glm::vec3(width, height, depth)));
+    QueueMesh(res, DescribeBox(width, height, depth), [=](MeshData &mesh) {
+        GenerateBox(width, height, depth, mesh);
+    });
 }
 
+
 } // namespace game;
@@ -3,6 +3,11 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
 #define GLEW_STATIC
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -10,6 +15,11 @@
 #include <glm/glm.hpp>
 
 #include "resource.h"
+#include "geometry_pool.h"
+#include "object_pool.h"
+#include "worker_pool.h"
+#include "mesh_generator.h"
+#include "asset_pack.h"
 
 // Default extensions for different shader source files
 #define VERTEX_PROGRAM_EXTENSION "_vp.glsl"
@@ -21,35 +31,181 @@ namespace game {
     class ResourceManager {
 
         public:
-            // Constructor and destructor
-            ResourceManager(void);
+            // Constructor and destructor; mesh buffers go through 'backend' (NULL: the GL context)
+            ResourceManager(RenderBackend *backend = NULL);
             ~ResourceManager();
             // Add a resource that was already loaded and allocated to memory
-            void AddResource(ResourceType type, const std::string name, GLuint resource, GLsizei size);
-            void AddResource(ResourceType type, const std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size);
-            // Load a resource from a file, according to the specified type
-            void LoadResource(ResourceType type, const std::string name, const char *filename);
+            Resource *AddResource(ResourceType type, const std::string name, GLuint resource, GLsizei size);
+            Resource *AddResource(ResourceType type, const std::string name, GLuint array_buffer, GLuint element_array_buffer, GLsizei size);
+            // Load a resource from a file, according to the specified type.
+            // Loading and mesh creation run on worker threads: the resources are added
+            // right away but stay Pending until ProcessUploads creates their GL objects.
+            // features: MaterialFeature flags a material supports (variants are built on first use)
+            void LoadResource(ResourceType type, const std::string name, const char *filename, unsigned features = 0);
             // Get the resource with the specified name
-            Resource *GetResource(const std::string name) const;
+            Resource *GetResource(const std::string &name) const;
+            // Handles stay checkable after the resource is removed
+            Handle<Resource> GetResourceHandle(const std::string &name) const;
+            Resource *GetResource(Handle<Resource> handle) const;
+            // Delete an unreferenced resource that is ready, with its GL objects (false if it
+            // is still used or pending); handles to it become null
+            bool RemoveResource(Resource *res);
+            // Delete the GL objects of all resources (while the GL context still exists);
+            // the resources stay, Pending
+            void UnloadAll(void);
+
+            // GPU memory held by the resources in bytes, in total or of one type (meshes
+            // in the shared buffers count their own ranges)
+            size_t GetMemoryUsage(void) const;
+            size_t GetMemoryUsage(ResourceType type) const;
+            // Budget for GetMemoryUsage, in bytes (0: unlimited). While it is exceeded,
+            // ProcessUploads removes unreferenced resources, least recently used first
+            void SetMemoryBudget(size_t bytes);
+            size_t GetMemoryBudget(void) const;
+            // Resources removed to stay within the budget so far
+            unsigned GetEvictions(void) const;
             // Methods to create specific resources
             // Create the geometry for a torus and add it to the list of resources
             void CreateTorus(std::string object_name, float loop_radius = 0.6, float circle_radius = 0.2, int num_loop_samples = 90, int num_circle_samples = 30);
-            // Create the geometry for a sphere
+            // Create the geometry for a sphere, with a chain of lower levels of detail
             void CreateSphere(std::string object_name, float radius = 0.6, int num_samples_theta = 90, int num_samples_phi = 45);
-            // Create a colored sphere mesh (solid color or gradient towards white)
+            // Create a colored sphere mesh (solid color or gradient towards white), with a chain of lower levels of detail
             void CreateColoredSphere(std::string object_name, const glm::vec3 &color, bool gradient_to_white = false, float radius = 0.6f, int num_samples_theta = 90, int num_samples_phi = 45);
             // Create the geometry for a box
             void CreateBox(std::string object_name, float width, float height, float depth);
 
+            // Create the GL objects of built resources until 'budget' seconds have passed
+            // (at least one is uploaded). Call once per frame from the GL thread.
+            // Returns the number of resources still pending
+            int ProcessUploads(double budget);
+            // Wait until all requested resources are ready
+            void FinishLoading(void);
+            bool IsLoading(void) const;
+            // Number of requested resources not uploaded yet
+            int GetPendingCount(void) const;
+
+            // Map an asset pack (throws std::ios_base::failure if it is missing or invalid);
+            // shaders and meshes requested afterwards come from the pack when it has them
+            void OpenPack(const std::string &filename);
+            // Bundled file, e.g. a texture to decode (data null: not in the pack)
+            PackSpan GetPackedFile(const std::string &filename) const;
+
+            // Keep the binaries of linked shader programs in 'directory' (created if needed),
+            // so later runs with the same sources and driver skip compilation. Empty disables
+            void SetProgramCacheDirectory(const std::string &directory);
+
         private:
-            // List storing all resources
-            std::vector<Resource*> resource_; 
+            // Storage of all resources
+            ObjectPool<Resource> resource_;
+            // Resources by name (the first resource added under a name)
+            std::unordered_map<std::string, Handle<Resource> > resource_index_;
+            // Mesh buffers are made through the backend (programs use GL directly)
+            RenderBackend *backend_;
+            // Shared buffers of the meshes with 16-bit indices
+            GeometryPool geometry_pool_;
+            // GPU memory by resource type, and its budget (0: unlimited)
+            size_t memory_usage_[num_resource_types_g];
+            size_t memory_budget_;
+            unsigned evictions_;
+
+            // CPU-side result of a worker job, waiting for the GL thread
+            struct StagedResource {
+                Handle<Resource> target; // Pending resource to complete
+                std::string error; // Set when the job failed
+                // Mesh: generated by the worker, or pre-generated (compiled in or in the
+                // asset pack) and used in place
+                MeshData mesh;
+                MeshView packed; // Vertex null: use 'mesh'
+                // Material: shader sources of a variant, and the cached program binary if there is one
+                unsigned features;
+                std::string vertex_source;
+                std::string fragment_source;
+                std::string cache_file; // Empty: no program cache
+                std::vector<unsigned char> program_binary;
+                GLenum program_format;
+            };
+
+            // Program linked from source, finished once the driver completes it
+            struct LinkingProgram {
+                Handle<Resource> target;
+                unsigned features;
+                GLuint program;
+                GLuint vertex_shader;
+                GLuint fragment_shader;
+                std::string cache_file;
+            };
+            std::vector<LinkingProgram> linking_;
+
+            // Source files of the materials, for building their variants
+            struct MaterialSource {
+                Handle<Resource> material;
+                std::string prefix;
+            };
+            std::vector<MaterialSource> material_source_;
+
+            // Shader program support, queried with the first material (GL thread)
+            bool shader_support_queried_;
+            bool program_binary_; // Programs can be saved and loaded as binaries
+            bool parallel_compile_; // Compiles and links run in the background
+            std::string driver_key_; // Driver identification, part of the cache keys
+            std::string program_cache_directory_;
+
+            // Built resources, bounded so workers cannot run far ahead of the uploads
+            std::deque<StagedResource> staged_;
+            std::mutex staged_mutex_;
+            std::condition_variable staged_ready_; // An entry was added
+            std::condition_variable staged_space_; // An entry was removed
+            bool stopping_; // Workers must not wait for space any more
+            int pending_; // Requested resources not uploaded yet (GL thread only)
+
+            // Mapped asset pack (read by workers, so it outlives them)
+            AssetPack pack_;
+
+            // Threads building the resources (destroyed first, while the queue still exists)
+            WorkerPool worker_;
 
             // Methods to load specific types of resources
             // Load shaders programs
-            void LoadMaterial(const std::string name, const char *prefix);
-            // Load a text file into memory (could be source code)
-            std::string LoadTextFile(const char *filename);
+            void LoadMaterial(const std::string name, const char *prefix, unsigned features);
+            // Build a variant of a material's program
+            void QueueProgram(Resource *res, const std::string &prefix, unsigned features);
+            // Queue the variants requested by drawing since the last call
+            void QueueVariants(void);
+            // Load a text file into memory (could be source code); a file bundled
+            // in 'pack' is taken from there
+            static std::string LoadTextFile(const char *filename, const AssetPack *pack = NULL);
+
+            // Add a resource whose GL objects are made later by ProcessUploads, and run
+            // 'build' on a worker thread to fill its staging data
+            Resource *AddPendingResource(ResourceType type, const std::string &name);
+            void QueueBuild(Resource *res, std::function<void(StagedResource &)> build);
+            // Stage the mesh with this description (mesh_generator.h) from the compiled-in
+            // meshes or the asset pack, or queue 'generate' to build it
+            void QueueMesh(Resource *res, const std::string &description, std::function<void(MeshData &)> generate);
+            // Create the GL objects of a staged resource and mark it ready
+            void Upload(StagedResource &staged);
+
+            // Upload a staged mesh (to the shared buffers when it has 16-bit indices)
+            void UploadMesh(StagedResource &staged, Resource *res);
+            // Load the cached binary of a staged shader program, or compile and link its
+            // sources (returns false while a parallel link is still running)
+            bool UploadMaterial(StagedResource &staged, Resource *res);
+            // Check the shaders and program and save the binary of a linked program
+            void FinishMaterial(const LinkingProgram &linking, Resource *res);
+            // Finish the programs whose parallel link completed (all of them if 'wait')
+            void PollPrograms(bool wait);
+            void QueryShaderSupport(void);
+            // Record the GPU memory of the GL objects of a resource
+            void SetMemorySize(Resource *res, size_t size);
+            // Count a new program of a material (drivers do not report program memory:
+            // the size of its binary stands in)
+            void AddProgramMemory(Resource *res, GLuint program);
+            // Delete the GL objects of a resource and make it Pending
+            void DeleteObjects(Resource *res);
+            // Remove unreferenced resources, least recently used first, until within the budget
+            void EvictResources(void);
+            // Largest projected radius (pixels) at which a sphere level with this many samples is used
+            static float LodScreenRadius(int num_samples_theta);
 
     }; // class ResourceManager
 
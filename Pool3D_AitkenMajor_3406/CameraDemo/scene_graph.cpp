@@ -1,6 +1,7 @@
 #include <stdexcept>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 #define GLM_FORCE_RADIANS
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -10,18 +11,30 @@
 
 namespace game {
 
-SceneGraph::SceneGraph(void){
+// Initial streaming space per frame in flight (grows when needed)
+const GLsizeiptr stream_region_size_g = 64 * 1024;
+
+// Fewest nodes a thread updates when a depth level is split (smaller levels stay on the calling thread)
+const size_t transform_parallel_nodes_g = 4096;
+
+
+SceneGraph::SceneGraph(RenderBackend *backend) : backend_(backend ? backend : GetGLBackend()), stream_(backend_, stream_region_size_g){
 
     background_color_ = glm::vec3(0.0, 0.0, 0.0);
+    cull_stats_.drawn = 0;
+    cull_stats_.culled = 0;
+    impostor_material_ = nullptr;
+    impostor_mode_ = false;
+    next_packet_ = 0;
+    render_stats_ = RenderStats();
+    order_version_ = SceneNode::GetHierarchyVersion();
+    order_dirty_ = true;
 }
 
 
 SceneGraph::~SceneGraph(){
-    // delete owned nodes
-    for (SceneNode *n : node_) {
-        delete n;
-    }
-    node_.clear();
+    // Nodes created by the graph are destroyed with the pool
+    SetImpostorMaterial(nullptr);
 }
 
 
@@ -40,10 +53,10 @@ glm::vec3 SceneGraph::GetBackgroundColor(void) const {
 SceneNode *SceneGraph::CreateNode(std::string node_name, Resource *geometry, Resource *material){
 
     // Create scene node with the specified resources
-    SceneNode *scn = new SceneNode(node_name, geometry, material);
+    SceneNode *scn = node_pool_.Get(node_pool_.Create(node_name, geometry, material));
 
-    // Add node to the scene root list (owner)
-    node_.push_back(scn);
+    // Add node to the scene root list
+    AddNode(scn);
 
     return scn;
 
@@ -53,19 +66,60 @@ SceneNode *SceneGraph::CreateNode(std::string node_name, Resource *geometry, Res
 void SceneGraph::AddNode(SceneNode *node){
 
     node_.push_back(node);
+    node_index_.emplace(node->GetName(), node);
+    order_dirty_ = true;
 }
 
 
-SceneNode *SceneGraph::GetNode(std::string node_name) const {
+void SceneGraph::DestroyNode(Handle<SceneNode> handle){
+
+    SceneNode *node = node_pool_.Get(handle);
+    if (!node){
+        return;
+    }
+
+    // Unlink from the hierarchy
+    node->SetParent(nullptr);
+    while (!node->GetChildren().empty()){
+        node->GetChildren().back()->SetParent(nullptr);
+    }
 
-    // Find node with the specified name
-    for (int i = 0; i < (int)node_.size(); i++){
-        if (node_[i]->GetName() == node_name){
-            return node_[i];
+    node_.erase(std::remove(node_.begin(), node_.end(), node), node_.end());
+    auto found = node_index_.find(node->GetName());
+    if (found != node_index_.end() && found->second == node){
+        node_index_.erase(found);
+        // Another node with the same name becomes visible to GetNode
+        for (SceneNode *n : node_){
+            if (n->GetName() == node->GetName()){
+                node_index_.emplace(n->GetName(), n);
+                break;
+            }
         }
     }
-    return NULL;
+    node_pool_.Destroy(handle);
+    order_dirty_ = true;
+}
+
+
+SceneNode *SceneGraph::GetNode(const std::string &node_name) const {
+
+    auto found = node_index_.find(node_name);
+    if (found == node_index_.end()){
+        return NULL;
+    }
+    return found->second;
+}
+
+
+Handle<SceneNode> SceneGraph::GetNodeHandle(const SceneNode *node) const {
+
+    return node_pool_.GetHandle(node);
+}
+
+
+SceneNode *SceneGraph::GetNode(Handle<SceneNode> handle) const {
 
+    return node_pool_.Get(handle);
 }
 
 
@@ -83,27 +137,209 @@ std::vector<SceneNode *>::const_iterator SceneGraph::end() const {
 
 void SceneGraph::Draw(Camera *camera){
 
+    SubmitPacket(BuildPacket(camera));
+}
+
+
+RenderPacket *SceneGraph::BuildPacket(Camera *camera){
+
+    PROFILE_ZONE("SceneGraph::BuildPacket");
+    RenderPacket *packet = &packet_[next_packet_];
+    next_packet_ = 1 - next_packet_;
+    packet->camera = *camera;
+    packet->background_color = background_color_;
+    packet->viewport_width = 0;
+    packet->viewport_height = 0;
+    packet->impostor_material = 0;
+    if (impostor_mode_ && impostor_material_ && impostor_material_->IsReady()) {
+        packet->impostor_material = impostor_material_->GetResource();
+    }
+
+    // Update world transforms and bounds of the nodes that moved
+    {
+        PROFILE_ZONE("Transforms");
+        UpdateTransforms();
+    }
+
+    // View parameters of the current camera
+    ViewParams params;
+    params.view = camera->GetViewMatrix();
+    params.frustum.Set(camera->GetProjectionMatrix() * params.view);
+    params.projection_scale = camera->GetProjectionScale();
+    params.stats = &cull_stats_;
+    params.impostors = packet->impostor_material ? &packet->impostors : nullptr;
+    params.time = glfwGetTime();
+    if (packet->impostor_material) {
+        impostor_material_->MarkUsed(params.time);
+    }
+
+    // Collect the root nodes; children are collected recursively
+    {
+        PROFILE_ZONE("Cull");
+        packet->queue.Clear();
+        packet->impostors.Clear();
+        cull_stats_.drawn = 0;
+        cull_stats_.culled = 0;
+        for (SceneNode *n : node_) {
+            if (n->GetParent() == nullptr) {
+                n->Enqueue(&packet->queue, params, Frustum::AllPlanes);
+            }
+        }
+    }
+
+    // Sort by pass, program, mesh and depth so state changes are grouped
+    {
+        PROFILE_ZONE("Sort");
+        packet->queue.Sort();
+    }
+    return packet;
+}
+
+
+void SceneGraph::SubmitPacket(RenderPacket *packet){
+
+    PROFILE_ZONE("SceneGraph::SubmitPacket");
+    gpu_profiler_.BeginFrame(backend_);
+
+    if (packet->viewport_width > 0) {
+        backend_->SetViewport(0, 0, packet->viewport_width, packet->viewport_height);
+    }
+
     // Clear background
-    glClearColor(background_color_[0], 
-                 background_color_[1],
-                 background_color_[2], 0.0);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    backend_->Clear(glm::vec4(packet->background_color, 0.0f));
 
-    // Draw root nodes only (nodes with no parent); children are drawn recursively
-    glm::mat4 identity = glm::mat4(1.0f);
+    {
+        PROFILE_ZONE("Submit meshes");
+        PROFILE_GPU_ZONE(&gpu_profiler_, backend_, "Meshes");
+        packet->queue.Submit(backend_, &packet->camera, &stream_);
+    }
+    render_stats_ = packet->queue.GetStats();
+
+    // All impostors in a single instanced draw
+    if (packet->impostor_material) {
+        PROFILE_ZONE("Submit impostors");
+        PROFILE_GPU_ZONE(&gpu_profiler_, backend_, "Impostors");
+        packet->impostors.Submit(backend_, &packet->camera, packet->impostor_material, &stream_);
+    }
+
+    // The frame's streamed data is fenced; the next frame writes to another region
+    stream_.EndFrame();
+}
+
+
+void SceneGraph::BuildOrder(void){
+
+    order_.clear();
+    level_.clear();
+
+    // Root nodes (nodes with no parent) form the first level
     for (SceneNode *n : node_) {
         if (n->GetParent() == nullptr) {
-            n->Draw(camera, identity);
+            order_.push_back(n);
+        }
+    }
+
+    // Each level is followed by the children of its nodes
+    size_t begin = 0;
+    while (begin < order_.size()) {
+        size_t end = order_.size();
+        level_.push_back(begin);
+        for (size_t i = begin; i < end; i++) {
+            const std::vector<SceneNode *> &children = order_[i]->GetChildren();
+            order_.insert(order_.end(), children.begin(), children.end());
         }
+        begin = end;
+    }
+    level_.push_back(order_.size());
+
+    order_version_ = SceneNode::GetHierarchyVersion();
+    order_dirty_ = false;
+}
+
+
+void SceneGraph::ForEachNode(SceneNode *const *begin, SceneNode *const *end, void (SceneNode::*step)(void)){
+
+    size_t count = end - begin;
+    if (count < 2 * transform_parallel_nodes_g){
+        for (SceneNode *const *n = begin; n != end; n++){
+            ((*n)->*step)();
+        }
+        return;
+    }
+
+    // The threads live as long as the graph, so a frame only hands them chunks
+    if (!workers_){
+        workers_.reset(new WorkerPool());
+    }
+    size_t chunk_num = std::min<size_t>(workers_->GetThreadCount() + 1, count / transform_parallel_nodes_g);
+    size_t chunk = (count + chunk_num - 1) / chunk_num;
+    workers_->ParallelFor((int) chunk_num, [begin, count, chunk, step](int c){
+        SceneNode *const *last = begin + std::min(count, (c + 1) * chunk);
+        for (SceneNode *const *n = begin + std::min(count, c * chunk); n != last; n++){
+            ((*n)->*step)();
+        }
+    });
+}
+
+
+void SceneGraph::UpdateTransforms(void){
+
+    if (order_dirty_ || order_version_ != SceneNode::GetHierarchyVersion()) {
+        BuildOrder();
+    }
+
+    // Transforms top-down, then bounds bottom-up; the nodes of one level are independent.
+    // Nodes that did not move only check their flags
+    SceneNode *const *order = order_.data();
+    const size_t level_num = level_.size() - 1;
+    for (size_t d = 0; d < level_num; d++) {
+        ForEachNode(order + level_[d], order + level_[d + 1], &SceneNode::UpdateTransform);
+    }
+    for (size_t d = level_num; d-- > 0; ) {
+        ForEachNode(order + level_[d], order + level_[d + 1], &SceneNode::UpdateSubtreeBounds);
     }
 }
 
 
-void SceneGraph::Update(void){
+const RenderStats &SceneGraph::GetRenderStats(void) const {
+
+    return render_stats_;
+}
+
+
+RenderBackend *SceneGraph::GetBackend(void) const {
+
+    return backend_;
+}
+
+
+const CullStats &SceneGraph::GetCullStats(void) const {
+
+    return cull_stats_;
+}
 
-    for (int i = 0; i < (int)node_.size(); i++){
-        node_[i]->Update();
+
+void SceneGraph::SetImpostorMaterial(const Resource *material){
+
+    if (material){
+        material->AddRef();
+    }
+    if (impostor_material_){
+        impostor_material_->Release();
     }
+    impostor_material_ = material;
+}
+
+
+void SceneGraph::SetImpostorMode(bool impostors){
+
+    impostor_mode_ = impostors;
+}
+
+
+bool SceneGraph::IsImpostorMode(void) const {
+
+    return impostor_mode_;
 }
 
 } // namespace game
@@ -3,6 +3,8 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <memory>
 #define GLEW_STATIC
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -10,6 +12,14 @@
 #include "scene_node.h"
 #include "resource.h"
 #include "camera.h"
+#include "render_queue.h"
+#include "frustum.h"
+#include "impostor_batch.h"
+#include "render_packet.h"
+#include "stream_buffer.h"
+#include "object_pool.h"
+#include "profiler.h"
+#include "worker_pool.h"
 
 namespace game {
 
@@ -17,15 +27,52 @@ namespace game {
     class SceneGraph {
 
         private:
+            // Backend that receives the draw commands (declared before the stream buffer)
+            RenderBackend *backend_;
+
             // Background color
             glm::vec3 background_color_;
 
-            // Scene nodes to render (owner list)
+            // Scene nodes to render
             std::vector<SceneNode *> node_;
+            // Storage of the nodes created by the graph
+            ObjectPool<SceneNode> node_pool_;
+            // Nodes by name (the first node added under a name)
+            std::unordered_map<std::string, SceneNode *> node_index_;
+
+            // Hierarchy flattened breadth-first: parents come before their children and
+            // each depth level is contiguous, from level_[d] to level_[d + 1]
+            std::vector<SceneNode *> order_;
+            std::vector<size_t> level_;
+            unsigned order_version_; // Hierarchy version the order was built from
+            bool order_dirty_; // Nodes were added since the order was built
+            // Threads sharing the updates of large depth levels (started by the first one)
+            std::unique_ptr<WorkerPool> workers_;
+
+            // Frames are built into the two packets in turn (reused to avoid reallocations),
+            // so one can be submitted while the other is built
+            RenderPacket packet_[2];
+            int next_packet_;
+            // Counters of the last submitted packet
+            RenderStats render_stats_;
+
+            // Per-frame data (transforms, colors, draw commands) streamed to the GPU
+            StreamBuffer stream_;
+
+            // Culling counters of the last frame
+            CullStats cull_stats_;
+
+            // Spheres can be drawn as ray-cast impostors with this material (the graph holds
+            // a reference to it), when impostor_mode_ is on
+            const Resource *impostor_material_;
+            bool impostor_mode_;
+
+            // GPU time of the mesh and impostor passes
+            GpuProfiler gpu_profiler_;
 
         public:
-            // Constructor and destructor
-            SceneGraph(void);
+            // Constructor and destructor; draws go through 'backend' (NULL: the GL context)
+            SceneGraph(RenderBackend *backend = NULL);
             ~SceneGraph();
 
             // Background color
@@ -34,19 +81,48 @@ namespace game {
             
             // Create a scene node from two resources (returns a new node; caller may set parent)
             SceneNode *CreateNode(std::string node_name, Resource *geometry, Resource *material);
-            // Add an already-created node (root-level)
+            // Add a node allocated elsewhere (root-level); the caller keeps ownership
             void AddNode(SceneNode *node);
+            // Remove a node created by the graph; its children become root nodes
+            void DestroyNode(Handle<SceneNode> handle);
             // Find a scene node with a specific name
-            SceneNode *GetNode(std::string node_name) const;
+            SceneNode *GetNode(const std::string &node_name) const;
+            // Handles of nodes created by the graph (null once the node is destroyed)
+            Handle<SceneNode> GetNodeHandle(const SceneNode *node) const;
+            SceneNode *GetNode(Handle<SceneNode> handle) const;
             // Get node const iterator
             std::vector<SceneNode *>::const_iterator begin() const;
             std::vector<SceneNode *>::const_iterator end() const;
 
-            // Draw the entire scene (root nodes only)
+            // Draw the entire scene: collect draws from root nodes that pass the
+            // frustum test, sort them by state and submit (BuildPacket, then SubmitPacket)
             void Draw(Camera *camera);
+            // Collect the sorted draws of the scene seen from 'camera' into the next packet,
+            // without GL calls. The packet stays valid until the second next call, so it can
+            // be submitted (on another thread) while the following frame is built
+            RenderPacket *BuildPacket(Camera *camera);
+            // Issue the draws of a packet (on the thread of the GL context)
+            void SubmitPacket(RenderPacket *packet);
+            // Counters of the last SubmitPacket (read them on the thread that submits)
+            const RenderStats &GetRenderStats(void) const;
+            RenderBackend *GetBackend(void) const;
+            const CullStats &GetCullStats(void) const;
+
+            // Material of the sphere impostors (null: none); the graph keeps it loaded
+            void SetImpostorMaterial(const Resource *material);
+            // Draw sphere nodes as ray-cast impostors instead of meshes (once the material is ready)
+            void SetImpostorMode(bool impostors);
+            bool IsImpostorMode(void) const;
 
-            // Update entire scene (calls Update on all nodes)
-            void Update(void);
+
+        private:
+            // Rebuild order_ and level_ from the root nodes
+            void BuildOrder(void);
+            // Bring the cached world transforms and bounds of all nodes up to date
+            void UpdateTransforms(void);
+            // Call 'step' on every node of [begin, end); large ranges are split between the
+            // worker threads (nodes of a range must not depend on each other)
+            void ForEachNode(SceneNode *const *begin, SceneNode *const *end, void (SceneNode::*step)(void));
 
     }; // class SceneGraph
 
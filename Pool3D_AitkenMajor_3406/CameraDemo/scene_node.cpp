@@ -4,12 +4,16 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
+#include <cfloat>
 #include <time.h>
 
 #include "scene_node.h"
 
 namespace game {
 
+    unsigned SceneNode::hierarchy_version_ = 0;
+
+
     SceneNode::SceneNode(const std::string name, const Resource* geometry, const Resource* material) {
 
         // Set name of scene node
@@ -26,20 +30,25 @@ namespace game {
             throw(std::invalid_argument(std::string("Invalid type of geometry")));
         }
 
-        array_buffer_ = geometry->GetArrayBuffer();
-        element_array_buffer_ = geometry->GetElementArrayBuffer();
-        size_ = geometry->GetSize();
+        geometry_ = geometry;
+        lod_ = 0;
 
         // Set material (shader program)
         if (material->GetType() != Material) {
             throw(std::invalid_argument(std::string("Invalid type of material")));
         }
 
-        material_ = material->GetResource();
+        // Buffers and program are looked up when drawing: the resources may still be pending
+        material_ = material;
+
+        // The resources stay loaded while the node uses them
+        geometry_->AddRef();
+        material_->AddRef();
 
         // Other attributes
         scale_ = glm::vec3(1.0, 1.0, 1.0);
         visible_ = true;
+        render_pass_ = OpaquePass;
 
         // initialize transform to identity
         position_ = glm::vec3(0.0f);
@@ -49,20 +58,40 @@ namespace game {
         parent_ = nullptr;
         children_.clear();
 
+        // World state is filled in by UpdateWorld or the first transform pass
+        local_ = glm::mat4(1.0f);
+        local_dirty_ = true;
+        world_dirty_ = true;
+        world_changed_ = false;
+        visible_in_tree_ = false;
+        subtree_changed_ = true;
+        world_ = glm::mat4(1.0f);
+        world_center_ = glm::vec3(0.0f);
+        world_radius_ = -1.0f;
+        subtree_center_ = glm::vec3(0.0f);
+        subtree_radius_ = -1.0f;
+        subtree_count_ = 0;
+
         // Initialize override/color-hint flags
         override_color_enabled_ = false;
         override_color_ = glm::vec3(1.0f, 1.0f, 1.0f);
         color_hint_enabled_ = false;
         color_hint_ = glm::vec3(1.0f, 1.0f, 1.0f);
+
+        // Colors come from the mesh unless a material color is set
+        base_color_ = glm::vec3(1.0f, 1.0f, 1.0f);
+        color_mode_ = VertexColor;
     }
 
 
     SceneNode::~SceneNode() {
         // Note: do not delete children here; SceneGraph owns nodes.
+        geometry_->Release();
+        material_->Release();
     }
 
 
-    const std::string SceneNode::GetName(void) const {
+    const std::string& SceneNode::GetName(void) const {
 
         return name_;
     }
@@ -89,6 +118,7 @@ namespace game {
     void SceneNode::SetPosition(glm::vec3 position) {
 
         position_ = position;
+        local_dirty_ = true;
     }
 
 
@@ -96,12 +126,14 @@ namespace game {
 
         // Ensure orientation stays normalized to avoid drift when applying many rotations
         orientation_ = glm::normalize(orientation);
+        local_dirty_ = true;
     }
 
 
     void SceneNode::SetScale(glm::vec3 scale) {
 
         scale_ = scale;
+        local_dirty_ = true;
     }
 
 
@@ -125,6 +157,8 @@ namespace game {
         }
         parent_ = parent;
         if (parent_) parent_->children_.push_back(this);
+        world_dirty_ = true;
+        hierarchy_version_++;
     }
 
     SceneNode* SceneNode::GetParent() const {
@@ -144,6 +178,7 @@ namespace game {
     void SceneNode::Translate(glm::vec3 trans) {
 
         position_ += trans;
+        local_dirty_ = true;
     }
 
 
@@ -153,12 +188,14 @@ namespace game {
         // Also normalize after applying rotation to avoid quaternion drift/scale over many operations.
         orientation_ = rot * orientation_;
         orientation_ = glm::normalize(orientation_);
+        local_dirty_ = true;
     }
 
 
     void SceneNode::Scale(glm::vec3 scale) {
 
         scale_ *= scale;
+        local_dirty_ = true;
     }
 
 
@@ -170,25 +207,32 @@ namespace game {
 
     GLuint SceneNode::GetArrayBuffer(void) const {
 
-        return array_buffer_;
+        return geometry_->GetArrayBuffer();
     }
 
 
     GLuint SceneNode::GetElementArrayBuffer(void) const {
 
-        return element_array_buffer_;
+        return geometry_->GetElementArrayBuffer();
     }
 
 
     GLsizei SceneNode::GetSize(void) const {
 
-        return size_;
+        return geometry_->GetSize();
     }
 
 
     GLuint SceneNode::GetMaterial(void) const {
 
-        return material_;
+        // Variant of the material specialized for the node's color mode (0 while it is built)
+        return material_->GetProgram(GetMaterialFeatures());
+    }
+
+
+    int SceneNode::GetLevelOfDetail(void) const {
+
+        return lod_;
     }
 
 
@@ -205,6 +249,48 @@ namespace game {
         return override_color_enabled_;
     }
 
+    glm::vec3 SceneNode::GetOverrideColor(void) const {
+        return override_color_;
+    }
+
+    void SceneNode::SetBaseColor(const glm::vec3& color) {
+        base_color_ = color;
+    }
+
+    glm::vec3 SceneNode::GetBaseColor(void) const {
+        return base_color_;
+    }
+
+    void SceneNode::SetColorMode(ColorMode mode) {
+        color_mode_ = mode;
+    }
+
+    ColorMode SceneNode::GetColorMode(void) const {
+        return color_mode_;
+    }
+
+    glm::vec4 SceneNode::GetMaterialParameters(void) const {
+        if (override_color_enabled_) {
+            return glm::vec4(override_color_, (float) SolidColor);
+        }
+        return glm::vec4(base_color_, (float) color_mode_);
+    }
+
+    unsigned SceneNode::GetMaterialFeatures(void) const {
+        ColorMode mode = override_color_enabled_ ? SolidColor : color_mode_;
+        if (mode == SolidColor) return SolidColorFeature;
+        if (mode == GradientColor) return GradientColorFeature;
+        return 0;
+    }
+
+    void SceneNode::SetRenderPass(RenderPass pass) {
+        render_pass_ = pass;
+    }
+
+    RenderPass SceneNode::GetRenderPass(void) const {
+        return render_pass_;
+    }
+
     void SceneNode::SetColorHint(const glm::vec3& color) {
         color_hint_enabled_ = true;
         color_hint_ = color;
@@ -219,94 +305,229 @@ namespace game {
     }
 
 
-    void SceneNode::Draw(Camera* camera, const glm::mat4& parentTransform) {
+    // Grow the sphere (center, radius) to enclose another sphere; a negative radius means empty
+    static void MergeSphere(glm::vec3& center, float& radius, const glm::vec3& other_center, float other_radius) {
 
-        // Skip rendering if invisible
-        if (!visible_) {
-            // still traverse children (they may be independently visible)
-            for (auto child : children_) {
-                child->Draw(camera, parentTransform);
-            }
+        if (other_radius < 0.0f) return;
+        if (radius < 0.0f) {
+            center = other_center;
+            radius = other_radius;
             return;
         }
+        glm::vec3 d = other_center - center;
+        float dist = glm::length(d);
+        if (dist + other_radius <= radius) return; // other sphere already enclosed
+        if (dist + radius <= other_radius) { // other sphere encloses this one
+            center = other_center;
+            radius = other_radius;
+            return;
+        }
+        float new_radius = 0.5f * (dist + radius + other_radius);
+        center += d * ((new_radius - radius) / dist);
+        radius = new_radius;
+    }
 
-        // Compute local->world transform using parentTransform
-        glm::mat4 scaling = glm::scale(glm::mat4(1.0f), scale_);
-        glm::mat4 rotation = glm::mat4_cast(orientation_);
-        glm::mat4 translation = glm::translate(glm::mat4(1.0f), position_);
-        glm::mat4 localWorld = parentTransform * (translation * rotation * scaling);
 
-        // Select proper material (shader program)
-        glUseProgram(material_);
+    void SceneNode::Draw(Camera* camera, const glm::mat4& parentTransform) {
+
+        // Submit the node (and its children) through a local queue so the
+        // immediate path shares the state setup of the scene queue; no culling.
+        // Per-draw data is set directly, so nothing is streamed
+        RenderQueue queue;
+        ViewParams params;
+        params.view = camera->GetViewMatrix();
+        params.projection_scale = 0.0f;
+        params.stats = nullptr;
+        params.impostors = nullptr;
+        params.time = glfwGetTime();
+        UpdateWorld(parentTransform);
+        Enqueue(&queue, params, 0);
+        queue.Sort();
+        queue.Submit(GetGLBackend(), camera);
+    }
 
-        // Set geometry to draw
-        glBindBuffer(GL_ARRAY_BUFFER, array_buffer_);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer_);
 
-        // Set globals for camera
-        camera->SetupShader(material_);
+    void SceneNode::UpdateWorld(const glm::mat4& parentTransform) {
+
+        UpdateWorld(parentTransform, true);
+    }
+
 
-        // Set world matrix and other shader input variables
-        SetupShader(material_, localWorld);
+    void SceneNode::UpdateWorld(const glm::mat4& parentTransform, bool parent_visible) {
 
-        // Draw geometry
-        if (mode_ == GL_POINTS) {
-            glDrawArrays(mode_, 0, size_);
+        // Matrices set here may not be relative to the parent: the next transform pass redoes them
+        world_ = parentTransform * GetLocalTransform();
+        world_dirty_ = true;
+        UpdateWorldBounds();
+        visible_in_tree_ = visible_ && parent_visible;
+
+        // Invisible nodes hide their subtree
+        subtree_center_ = world_center_;
+        subtree_radius_ = visible_in_tree_ ? world_radius_ : -1.0f;
+        subtree_count_ = visible_in_tree_ ? 1 : 0;
+        for (auto child : children_) {
+            child->UpdateWorld(world_, visible_in_tree_);
+            MergeSphere(subtree_center_, subtree_radius_, child->subtree_center_, child->subtree_radius_);
+            subtree_count_ += child->subtree_count_;
         }
-        else {
-            glDrawElements(mode_, size_, GL_UNSIGNED_INT, 0);
+    }
+
+
+    void SceneNode::UpdateTransform(void) {
+
+        // The parent was updated earlier in the pass
+        bool parent_changed = parent_ && parent_->world_changed_;
+        bool visible = visible_ && (!parent_ || parent_->visible_in_tree_);
+
+        world_changed_ = false;
+        if (local_dirty_ || world_dirty_ || parent_changed) {
+            world_ = parent_ ? parent_->world_ * GetLocalTransform() : GetLocalTransform();
+            UpdateWorldBounds();
+            world_dirty_ = false;
+            world_changed_ = true;
         }
 
-        // Draw children with this node's world transform as parent
+        subtree_changed_ = world_changed_ || visible != visible_in_tree_;
+        visible_in_tree_ = visible;
+    }
+
+
+    void SceneNode::UpdateSubtreeBounds(void) {
+
+        // The children were updated earlier in the pass; nothing moved or was hidden: keep the bounds
+        bool changed = subtree_changed_;
         for (auto child : children_) {
-            child->Draw(camera, localWorld);
+            changed = changed || child->subtree_changed_;
+        }
+        if (!changed) return;
+        subtree_changed_ = true;
+
+        subtree_center_ = world_center_;
+        subtree_radius_ = visible_in_tree_ ? world_radius_ : -1.0f;
+        subtree_count_ = visible_in_tree_ ? 1 : 0;
+        for (auto child : children_) {
+            MergeSphere(subtree_center_, subtree_radius_, child->subtree_center_, child->subtree_radius_);
+            subtree_count_ += child->subtree_count_;
         }
     }
 
 
-    void SceneNode::Update(void) {
+    unsigned SceneNode::GetHierarchyVersion(void) {
 
-        // Do nothing for this generic type of scene node
+        return hierarchy_version_;
     }
 
 
-    void SceneNode::SetupShader(GLuint program, const glm::mat4& world) {
+    void SceneNode::UpdateWorldBounds(void) {
+
+        // World bounds: transform the center, scale the radius by the largest axis scale
+        float max_scale = glm::max(glm::length(glm::vec3(world_[0])),
+                          glm::max(glm::length(glm::vec3(world_[1])), glm::length(glm::vec3(world_[2]))));
+        world_center_ = glm::vec3(world_ * glm::vec4(geometry_->GetBoundingCenter(), 1.0f));
+        world_radius_ = geometry_->GetBoundingRadius() * max_scale;
+    }
+
 
-        // Set attributes for shaders
-        GLint vertex_att = glGetAttribLocation(program, "vertex");
-        glVertexAttribPointer(vertex_att, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), 0);
-        glEnableVertexAttribArray(vertex_att);
+    void SceneNode::Enqueue(RenderQueue* queue, const ViewParams& params, unsigned plane_mask) {
 
-        GLint normal_att = glGetAttribLocation(program, "normal");
-        glVertexAttribPointer(normal_att, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
-        glEnableVertexAttribArray(normal_att);
+        // Nothing visible in this subtree
+        if (subtree_count_ == 0) return;
 
-        GLint color_att = glGetAttribLocation(program, "color");
-        if (color_att >= 0) {
-            if (override_color_enabled_) {
-                // Use a constant attribute value instead of the VBO color array
-                glDisableVertexAttribArray(color_att);
-                glVertexAttrib3f(color_att, override_color_.x, override_color_.y, override_color_.z);
+        // Reject the whole subtree at once; planes fully containing it are dropped from the mask
+        if (plane_mask && !params.frustum.TestSphere(subtree_center_, subtree_radius_, plane_mask)) {
+            if (params.stats) params.stats->culled += subtree_count_;
+            return;
+        }
+
+        if (visible_in_tree_) {
+            // A leaf was decided by the subtree test; otherwise test the node's own bounds
+            unsigned own_mask = plane_mask;
+            if (children_.empty() || !own_mask || params.frustum.TestSphere(world_center_, world_radius_, own_mask)) {
+                if (params.impostors && geometry_->IsSphere()) {
+                    // Ray-cast sphere: one quad instead of the mesh, shaded like the material shader
+                    glm::vec4 material = GetMaterialParameters();
+                    if (material.w == (float) VertexColor) {
+                        params.impostors->Add(world_center_, world_radius_, geometry_->GetSphereColor(), geometry_->GetSphereGradient());
+                    }
+                    else {
+                        params.impostors->Add(world_center_, world_radius_, glm::vec3(material), material.w == (float) GradientColor);
+                    }
+                }
+                else if (material_->IsReady()) {
+                    // Depth of the node origin along the view direction (camera looks down -Z)
+                    float depth = -(params.view * world_[3]).z;
+                    SelectLevelOfDetail(params.projection_scale, depth);
+                    // While the level or the material variant is still loading, another level
+                    // stands in for the first and the second is skipped
+                    const Resource* mesh = geometry_->GetReadyLod(lod_);
+                    GLuint program = GetMaterial();
+                    if (mesh && program) {
+                        queue->Push(render_pass_, this, mesh, program, world_, depth);
+                        mesh->MarkUsed(params.time);
+                        material_->MarkUsed(params.time);
+                    }
+                }
+                if (params.stats) params.stats->drawn++;
             }
-            else {
-                // Use per-vertex colors from the VBO
-                glVertexAttribPointer(color_att, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void*)(6 * sizeof(GLfloat)));
-                glEnableVertexAttribArray(color_att);
+            else if (params.stats) {
+                params.stats->culled++;
             }
         }
 
-        GLint tex_att = glGetAttribLocation(program, "uv");
-        glVertexAttribPointer(tex_att, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void*)(9 * sizeof(GLfloat)));
-        glEnableVertexAttribArray(tex_att);
+        // Collect children (planes the subtree is inside of are not tested again)
+        for (auto child : children_) {
+            child->Enqueue(queue, params, plane_mask);
+        }
+    }
+
 
-        // World transformation
-        GLint world_mat = glGetUniformLocation(program, "world_mat");
-        glUniformMatrix4fv(world_mat, 1, GL_FALSE, glm::value_ptr(world));
+    void SceneNode::SelectLevelOfDetail(float projection_scale, float depth) {
 
-        // Timer
-        GLint timer_var = glGetUniformLocation(program, "timer");
-        double current_time = glfwGetTime();
-        glUniform1f(timer_var, (float)current_time);
+        const int count = geometry_->GetLodCount();
+        if (count == 1 || projection_scale <= 0.0f) {
+            lod_ = 0;
+            return;
+        }
+
+        // Projected radius in pixels; nodes at or behind the camera plane get full detail
+        float screen_radius = (depth > 0.0f) ? world_radius_ * projection_scale / depth : FLT_MAX;
+
+        // Hysteresis: a level is only left once the radius is clearly past its threshold,
+        // so nodes hovering around a threshold do not pop between levels every frame
+        const float hysteresis = 0.15f;
+        lod_ = glm::clamp(lod_, 0, count - 1);
+        while (lod_ > 0 && screen_radius > geometry_->GetLodScreenRadius(lod_) * (1.0f + hysteresis)) {
+            lod_--;
+        }
+        while (lod_ + 1 < count && screen_radius < geometry_->GetLodScreenRadius(lod_ + 1) * (1.0f - hysteresis)) {
+            lod_++;
+        }
+    }
+
+
+    const glm::mat4& SceneNode::GetWorldTransform(void) const {
+
+        return world_;
+    }
+
+
+    const glm::mat4& SceneNode::GetLocalTransform(void) {
+
+        if (local_dirty_) {
+            glm::mat4 scaling = glm::scale(glm::mat4(1.0f), scale_);
+            glm::mat4 rotation = glm::mat4_cast(orientation_);
+            glm::mat4 translation = glm::translate(glm::mat4(1.0f), position_);
+            local_ = translation * rotation * scaling;
+            local_dirty_ = false;
+            world_dirty_ = true;
+        }
+        return local_;
+    }
+
+
+    void SceneNode::Update(void) {
+
+        // Do nothing for this generic type of scene node
     }
 
 } // namespace game;
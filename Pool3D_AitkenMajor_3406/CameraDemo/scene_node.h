@@ -12,9 +12,25 @@
 
 #include "resource.h"
 #include "camera.h"
+#include "render_queue.h"
+#include "frustum.h"
+#include "impostor_batch.h"
 
 namespace game {
 
+    // How the material shader colors a node
+    typedef enum Coloring { VertexColor = 0, SolidColor = 1, GradientColor = 2 } ColorMode;
+
+    // Per-frame view parameters used while collecting draws
+    struct ViewParams {
+        glm::mat4 view; // Camera view matrix (depth of nodes)
+        Frustum frustum; // Culling planes
+        float projection_scale; // Pixels per world unit at unit distance (0: always use full detail)
+        CullStats* stats; // Culling counters (may be null)
+        ImpostorBatch* impostors; // Spheres are drawn as impostors into this batch (null: draw meshes)
+        double time; // Frame time, stamped on the resources drawn (Resource::MarkUsed)
+    };
+
     // Class that manages one object in a scene 
     class SceneNode {
 
@@ -26,7 +42,7 @@ namespace game {
         virtual ~SceneNode();
 
         // Get name of node
-        const std::string GetName(void) const;
+        const std::string& GetName(void) const;
 
         // Get node attributes
         glm::vec3 GetPosition(void) const;
@@ -53,10 +69,31 @@ namespace game {
         void Rotate(glm::quat rot);
         void Scale(glm::vec3 scale);
 
-        // Draw the node according to scene parameters in 'camera'
+        // Draw the node and its children immediately according to scene parameters in 'camera'
         // parentTransform: matrix transform accumulated from parents
         virtual void Draw(Camera* camera, const glm::mat4& parentTransform);
-        // Update the node
+        // Compute the world transform and world bounds of the node and its children
+        // parentTransform: matrix transform accumulated from parents
+        void UpdateWorld(const glm::mat4& parentTransform);
+        // Step of the scene graph's flattened transform pass (parents are updated first):
+        // recompute the cached matrices and bounds only if the node or its parent changed
+        void UpdateTransform(void);
+        // Step of the bounds pass (children are updated first): merge the bounds of the
+        // visible subtree if anything in it changed
+        void UpdateSubtreeBounds(void);
+        // Incremented whenever a parent link changes anywhere (flattened orders are rebuilt)
+        static unsigned GetHierarchyVersion(void);
+        // Collect the draws of the node and its children into 'queue', culling against the
+        // frustum in 'params' and picking a level of detail (call UpdateWorld or the
+        // scene graph's transform pass first).
+        // plane_mask: frustum planes still to be tested (0 disables culling)
+        virtual void Enqueue(RenderQueue* queue, const ViewParams& params, unsigned plane_mask);
+        // World transform computed by the last UpdateWorld
+        const glm::mat4& GetWorldTransform(void) const;
+        // Transform relative to the parent (cached until the node is moved)
+        const glm::mat4& GetLocalTransform(void);
+        // Update the node; the scene graph does not call it, a node type that needs it
+        // registers a function calling it with an UpdateScheduler
         virtual void Update(void);
 
         // OpenGL variables
@@ -65,11 +102,30 @@ namespace game {
         GLuint GetElementArrayBuffer(void) const;
         GLsizei GetSize(void) const;
         GLuint GetMaterial(void) const;
+        // Level of detail picked by the last Enqueue
+        int GetLevelOfDetail(void) const;
 
         // Per-node override color (forces shader color attribute to this constant)
         void SetOverrideColor(const glm::vec3& color);
         void ClearOverrideColor(void);
         bool HasOverrideColor(void) const;
+        glm::vec3 GetOverrideColor(void) const;
+
+        // Material parameters evaluated in the shader, so nodes can share geometry.
+        // VertexColor (default) uses the colors stored in the mesh, SolidColor the base
+        // color, and GradientColor the base color blended toward white along -Y
+        void SetBaseColor(const glm::vec3& color);
+        glm::vec3 GetBaseColor(void) const;
+        void SetColorMode(ColorMode mode);
+        ColorMode GetColorMode(void) const;
+        // Shader material attribute: rgb = color, a = mode (the override color wins)
+        glm::vec4 GetMaterialParameters(void) const;
+        // Material features (MaterialFeature flags) of the shader variant drawing the node
+        unsigned GetMaterialFeatures(void) const;
+
+        // Render pass the node is drawn in (opaque by default)
+        void SetRenderPass(RenderPass pass);
+        RenderPass GetRenderPass(void) const;
 
         // Color hint metadata (used by game logic to query the representative color for the node)
         void SetColorHint(const glm::vec3& color);
@@ -78,15 +134,33 @@ namespace game {
 
     private:
         std::string name_; // Name of the scene node
-        GLuint array_buffer_; // References to geometry: vertex and array buffers
-        GLuint element_array_buffer_;
+        const Resource* geometry_; // Geometry resource (level-of-detail chain)
+        int lod_; // Current level of detail
         GLenum mode_; // Type of geometry
-        GLsizei size_; // Number of primitives in geometry
-        GLuint material_; // Reference to shader program
+        const Resource* material_; // Shader program resource
         glm::vec3 position_; // Position of node (local)
         glm::quat orientation_; // Orientation of node (local)
         glm::vec3 scale_; // Scale of node (local)
         bool visible_; // Visibility flag
+        RenderPass render_pass_; // Pass used when sorting draws
+
+        // Cached transforms: local_ is rebuilt when position, orientation or scale change,
+        // world_ when local_ or the parent's world transform change
+        glm::mat4 local_;
+        bool local_dirty_;
+        bool world_dirty_; // Recompute world_ on the next transform pass
+        bool world_changed_; // world_ was recomputed by the current transform pass
+        bool visible_in_tree_; // The node and all its ancestors are visible
+        bool subtree_changed_; // Subtree bounds must be merged again
+        static unsigned hierarchy_version_;
+
+        // World transform and bounds computed by UpdateWorld
+        glm::mat4 world_;
+        glm::vec3 world_center_; // Bounds of the node alone
+        float world_radius_;
+        glm::vec3 subtree_center_; // Bounds of the visible nodes in the subtree (radius < 0: empty)
+        float subtree_radius_;
+        int subtree_count_; // Number of visible nodes in the subtree
 
         // Hierarchy
         SceneNode* parent_;
@@ -96,12 +170,20 @@ namespace game {
         bool override_color_enabled_;
         glm::vec3 override_color_;
 
+        // Shader material parameters
+        glm::vec3 base_color_;
+        ColorMode color_mode_;
+
         // Per-node color hint (metadata)
         bool color_hint_enabled_;
         glm::vec3 color_hint_;
 
-        // Set matrices that transform the node in a shader program (uses world transform)
-        void SetupShader(GLuint program, const glm::mat4& world);
+        // Pick the level of detail from the projected radius of the node
+        void SelectLevelOfDetail(float projection_scale, float depth);
+        // World bounds of the node alone from world_
+        void UpdateWorldBounds(void);
+        // UpdateWorld for a subtree whose ancestors are (in)visible
+        void UpdateWorld(const glm::mat4& parentTransform, bool parent_visible);
 
     }; // class SceneNode
 
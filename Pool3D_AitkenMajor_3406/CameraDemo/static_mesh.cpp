@@ -0,0 +1,353 @@
+#include <cstddef>
+
+#include "static_mesh.h"
+
+namespace game {
+
+// The generators below follow mesh_generator.cpp, but run in constant expressions: the
+// <cmath> and glm functions are not constexpr, so the math and packing they need is here
+
+constexpr double static_pi_g = 3.14159265358979323846;
+
+// Rows of quads the sphere triangles are emitted in, one band at a time across all columns:
+// both columns of the current quads (2 * (rows + 1) vertices) then fit a 16-entry vertex
+// cache, so every vertex but those on band edges is transformed once
+constexpr int static_band_rows_g = 7;
+
+
+static constexpr double StaticAbs(double x){
+
+    return (x < 0.0) ? -x : x;
+}
+
+
+static constexpr double StaticClamp(double x, double lo, double hi){
+
+    return (x < lo) ? lo : ((x > hi) ? hi : x);
+}
+
+
+// Sine from its Taylor series, after reducing the angle to [-pi, pi]
+static constexpr double StaticSin(double x){
+
+    while (x > static_pi_g){
+        x -= 2.0 * static_pi_g;
+    }
+    while (x < -static_pi_g){
+        x += 2.0 * static_pi_g;
+    }
+    double term = x;
+    double sum = x;
+    for (int n = 1; n < 12; n++){
+        term *= -x * x / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+
+static constexpr double StaticCos(double x){
+
+    return StaticSin(x + 0.5 * static_pi_g);
+}
+
+
+// Square root by Newton's method
+static constexpr double StaticSqrt(double x){
+
+    if (x <= 0.0){
+        return 0.0;
+    }
+    double root = (x > 1.0) ? x : 1.0;
+    for (int i = 0; i < 64; i++){
+        root = 0.5 * (root + x / root);
+    }
+    return root;
+}
+
+
+// Same rounding as glm::packSnorm1x16 and glm::packUnorm1x8
+static constexpr GLshort PackSnorm16(double v){
+
+    double scaled = StaticClamp(v, -1.0, 1.0) * 32767.0;
+    return (GLshort) (int) ((scaled < 0.0) ? scaled - 0.5 : scaled + 0.5);
+}
+
+
+static constexpr GLubyte PackUnorm8(double v){
+
+    return (GLubyte) (int) (StaticClamp(v, 0.0, 1.0) * 255.0 + 0.5);
+}
+
+
+// Half float; values below the smallest normal half flush to zero
+static constexpr GLushort PackHalf(double v){
+
+    GLushort sign = (v < 0.0) ? 0x8000 : 0;
+    v = StaticAbs(v);
+    if (v < 1.0 / 16384.0){
+        return sign;
+    }
+    int exponent = 0;
+    while (v >= 2.0){
+        v *= 0.5;
+        exponent++;
+    }
+    while (v < 1.0){
+        v *= 2.0;
+        exponent--;
+    }
+    int mantissa = (int) ((v - 1.0) * 1024.0 + 0.5);
+    if (mantissa == 1024){
+        mantissa = 0;
+        exponent++;
+    }
+    return (GLushort) (sign | ((exponent + 15) << 10) | mantissa);
+}
+
+
+// Vertex of a generator, before packing
+struct SourceVertex {
+    double position[3];
+    double normal[3];
+    double color[3];
+    double uv[2];
+};
+
+// One vertex in packed_vertex_format_g
+struct PackedVertex {
+    GLshort position[4]; // xyz and padding
+    GLshort normal[2]; // Octahedral
+    GLubyte color[4];
+    GLushort uv[2];
+};
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must match packed_vertex_format_g");
+
+// Packed mesh with room for up to VertexCapacity vertices and IndexCapacity indices
+template <int VertexCapacity, int IndexCapacity>
+struct StaticMeshData {
+    PackedVertex vertex[VertexCapacity];
+    GLushort index[IndexCapacity];
+    int vertex_num;
+    int index_num;
+    double position_offset[3];
+    double position_scale[3];
+};
+
+
+// Quantize the vertices used by 'triangle' inside their bounds, numbering them by first
+// use (as OptimizeVertexFetch does). The generators order the triangles for the vertex cache
+template <int V, int I>
+static constexpr void PackStatic(const SourceVertex (&source)[V], const int (&triangle)[I], int index_num, StaticMeshData<V, I> &mesh){
+
+    // Bounds of the positions, as in PackVertices
+    double lo[3] = { 0.0, 0.0, 0.0 };
+    double hi[3] = { 0.0, 0.0, 0.0 };
+    for (int i = 0; i < V; i++){
+        for (int k = 0; k < 3; k++){
+            double v = source[i].position[k];
+            if (i == 0 || v < lo[k]) lo[k] = v;
+            if (i == 0 || v > hi[k]) hi[k] = v;
+        }
+    }
+    for (int k = 0; k < 3; k++){
+        mesh.position_offset[k] = 0.5 * (lo[k] + hi[k]);
+        mesh.position_scale[k] = (hi[k] > lo[k]) ? 0.5 * (hi[k] - lo[k]) : 1.0;
+    }
+
+    int remap[V] = {};
+    for (int i = 0; i < V; i++){
+        remap[i] = -1;
+    }
+    mesh.vertex_num = 0;
+    mesh.index_num = index_num;
+    for (int n = 0; n < index_num; n++){
+        int v = triangle[n];
+        if (remap[v] < 0){
+            remap[v] = mesh.vertex_num++;
+            const SourceVertex &src = source[v];
+            PackedVertex &dst = mesh.vertex[remap[v]];
+            for (int k = 0; k < 3; k++){
+                dst.position[k] = PackSnorm16((src.position[k] - mesh.position_offset[k]) / mesh.position_scale[k]);
+                dst.color[k] = PackUnorm8(src.color[k]);
+            }
+            dst.position[3] = 0;
+            dst.color[3] = 255;
+
+            // Octahedral normal, as OctahedralEncode
+            double sum = StaticAbs(src.normal[0]) + StaticAbs(src.normal[1]) + StaticAbs(src.normal[2]);
+            double x = (sum > 0.0) ? src.normal[0] / sum : 0.0;
+            double y = (sum > 0.0) ? src.normal[1] / sum : 0.0;
+            if (src.normal[2] < 0.0){
+                double folded_x = (1.0 - StaticAbs(y)) * ((x >= 0.0) ? 1.0 : -1.0);
+                double folded_y = (1.0 - StaticAbs(x)) * ((y >= 0.0) ? 1.0 : -1.0);
+                x = folded_x;
+                y = folded_y;
+            }
+            dst.normal[0] = PackSnorm16(x);
+            dst.normal[1] = PackSnorm16(y);
+
+            dst.uv[0] = PackHalf(src.uv[0]);
+            dst.uv[1] = PackHalf(src.uv[1]);
+        }
+        mesh.index[n] = (GLushort) remap[v];
+    }
+}
+
+
+// GenerateColoredSphere. The seam column and the pole rows repeat a vertex; they are
+// welded to the first copy, and the triangles that collapse are dropped
+template <int Theta, int Phi>
+static constexpr StaticMeshData<Theta * Phi, Theta * (Phi - 1) * 6> MakeColoredSphere(float r, float g, float b, bool gradient_to_white, float radius){
+
+    // Sines and cosines per column and row, to keep the evaluation short
+    double sin_theta[Theta] = {}, cos_theta[Theta] = {};
+    for (int i = 0; i < Theta; i++){
+        double theta = 2.0 * static_pi_g * i / (Theta - 1);
+        sin_theta[i] = StaticSin(theta);
+        cos_theta[i] = StaticCos(theta);
+    }
+    double sin_phi[Phi] = {}, cos_phi[Phi] = {};
+    for (int j = 0; j < Phi; j++){
+        double phi = static_pi_g * j / (Phi - 1);
+        sin_phi[j] = StaticSin(phi);
+        cos_phi[j] = StaticCos(phi);
+    }
+
+    SourceVertex vertex[Theta * Phi] = {};
+    for (int i = 0; i < Theta; i++){
+        for (int j = 0; j < Phi; j++){
+            SourceVertex &v = vertex[i * Phi + j];
+            v.normal[0] = cos_theta[i] * sin_phi[j];
+            v.normal[1] = sin_theta[i] * sin_phi[j];
+            v.normal[2] = -cos_phi[j];
+            double t = gradient_to_white ? StaticClamp(0.5 * (1.0 - v.normal[1]), 0.0, 1.0) : 0.0;
+            const double color[3] = { r, g, b };
+            for (int k = 0; k < 3; k++){
+                v.position[k] = v.normal[k] * radius;
+                v.color[k] = (1.0 - t) * color[k] + t;
+            }
+            v.uv[0] = (double) i / Theta;
+            v.uv[1] = 1.0 - (double) j / Phi;
+        }
+    }
+
+    // First copy of each vertex of the grid
+    int weld[Theta * Phi] = {};
+    for (int i = 0; i < Theta; i++){
+        for (int j = 0; j < Phi; j++){
+            int column = (j == 0 || j == Phi - 1 || i == Theta - 1) ? 0 : i;
+            weld[i * Phi + j] = column * Phi + j;
+        }
+    }
+
+    int triangle[Theta * (Phi - 1) * 6] = {};
+    int index_num = 0;
+    for (int band = 0; band < Phi - 1; band += static_band_rows_g){
+        for (int i = 0; i < Theta; i++){
+            int next = (i + 1) % Theta;
+            for (int j = band; j < Phi - 1 && j < band + static_band_rows_g; j++){
+                const int quad[6] = { next * Phi + j, i * Phi + j + 1, i * Phi + j,
+                                      next * Phi + j, next * Phi + j + 1, i * Phi + j + 1 };
+                for (int t = 0; t < 6; t += 3){
+                    int a = weld[quad[t]], b = weld[quad[t + 1]], c = weld[quad[t + 2]];
+                    if (a == b || b == c || c == a){
+                        continue;
+                    }
+                    triangle[index_num++] = a;
+                    triangle[index_num++] = b;
+                    triangle[index_num++] = c;
+                }
+            }
+        }
+    }
+
+    StaticMeshData<Theta * Phi, Theta * (Phi - 1) * 6> mesh = {};
+    PackStatic(vertex, triangle, index_num, mesh);
+    return mesh;
+}
+
+
+// GenerateBox: 8 corners with diagonal normals
+static constexpr StaticMeshData<8, 36> MakeBox(float width, float height, float depth){
+
+    const double half[3] = { 0.5 * width, 0.5 * height, 0.5 * depth };
+    const int corner[8][3] = {
+        { -1, -1, -1 }, { 1, -1, -1 }, { 1, 1, -1 }, { -1, 1, -1 },
+        { -1, -1, 1 }, { 1, -1, 1 }, { 1, 1, 1 }, { -1, 1, 1 }
+    };
+    const double uv[4][2] = { { 0.0, 0.0 }, { 1.0, 0.0 }, { 1.0, 1.0 }, { 0.0, 1.0 } };
+    const double normal_scale = 1.0 / StaticSqrt(3.0);
+
+    SourceVertex vertex[8] = {};
+    for (int i = 0; i < 8; i++){
+        for (int k = 0; k < 3; k++){
+            vertex[i].position[k] = corner[i][k] * half[k];
+            vertex[i].normal[k] = corner[i][k] * normal_scale;
+            vertex[i].color[k] = 1.0;
+        }
+        vertex[i].uv[0] = uv[i % 4][0];
+        vertex[i].uv[1] = uv[i % 4][1];
+    }
+
+    const int triangle[36] = {
+        0, 1, 2, 0, 2, 3, // back (-Z)
+        4, 6, 5, 4, 7, 6, // front (+Z)
+        0, 3, 7, 0, 7, 4, // left (-X)
+        1, 5, 6, 1, 6, 2, // right (+X)
+        0, 4, 5, 0, 5, 1, // bottom (-Y)
+        3, 2, 6, 3, 6, 7  // top (+Y)
+    };
+
+    StaticMeshData<8, 36> mesh = {};
+    PackStatic(vertex, triangle, 36, mesh);
+    return mesh;
+}
+
+
+// Standard meshes of Game::SetupResources; the parameters must match its Create* calls.
+// Ball sphere, with its levels of detail (GetSphereLevels)
+constexpr StaticMeshData<24 * 24, 24 * 23 * 6> ball_mesh_g = MakeColoredSphere<24, 24>(1.0f, 1.0f, 1.0f, false, 1.0f);
+constexpr StaticMeshData<12 * 12, 12 * 11 * 6> ball_lod1_mesh_g = MakeColoredSphere<12, 12>(1.0f, 1.0f, 1.0f, false, 1.0f);
+constexpr StaticMeshData<6 * 6, 6 * 5 * 6> ball_lod2_mesh_g = MakeColoredSphere<6, 6>(1.0f, 1.0f, 1.0f, false, 1.0f);
+// Shot tracer
+constexpr StaticMeshData<8, 36> tracer_mesh_g = MakeBox(0.05f, 0.05f, 1.0f);
+
+
+template <int V, int I>
+static MeshView GetView(const StaticMeshData<V, I> &mesh){
+
+    MeshView view;
+    view.vertex = mesh.vertex;
+    view.vertex_num = (GLuint) mesh.vertex_num;
+    view.index = mesh.index;
+    view.index_num = (GLsizei) mesh.index_num;
+    view.index_type = GL_UNSIGNED_SHORT;
+    view.position_offset = glm::vec3(mesh.position_offset[0], mesh.position_offset[1], mesh.position_offset[2]);
+    view.position_scale = glm::vec3(mesh.position_scale[0], mesh.position_scale[1], mesh.position_scale[2]);
+    return view;
+}
+
+
+const MeshView *FindStaticMesh(const std::string &description){
+
+    struct Entry {
+        std::string description;
+        MeshView mesh;
+    };
+    static const Entry entry[] = {
+        { DescribeColoredSphere(glm::vec3(1.0f), false, 1.0f, 24, 24), GetView(ball_mesh_g) },
+        { DescribeColoredSphere(glm::vec3(1.0f), false, 1.0f, 12, 12), GetView(ball_lod1_mesh_g) },
+        { DescribeColoredSphere(glm::vec3(1.0f), false, 1.0f, 6, 6), GetView(ball_lod2_mesh_g) },
+        { DescribeBox(0.05f, 0.05f, 1.0f), GetView(tracer_mesh_g) }
+    };
+
+    for (const Entry &e : entry){
+        if (e.description == description){
+            return &e.mesh;
+        }
+    }
+    return NULL;
+}
+
+} // namespace game
@@ -0,0 +1,20 @@
+#ifndef STATIC_MESH_H_
+#define STATIC_MESH_H_
+
+#include <string>
+
+#include "mesh_generator.h"
+
+namespace game {
+
+    // Meshes generated at compile time (static_mesh.cpp) for the parameters the game uses.
+    // Their packed vertices and indices are read-only data of the executable, uploaded
+    // without any processing at startup
+
+    // Compiled-in mesh with this description (mesh_generator.h), or null: meshes with
+    // other parameters are generated at run time
+    const MeshView *FindStaticMesh(const std::string &description);
+
+} // namespace game
+
+#endif // STATIC_MESH_H_
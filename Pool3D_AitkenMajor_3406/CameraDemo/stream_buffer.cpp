@@ -0,0 +1,174 @@
+#include <cstddef>
+
+#include "stream_buffer.h"
+
+namespace game {
+
+// Allocations start on this boundary (enough for vertex attributes and indirect commands)
+const GLsizeiptr stream_alignment_g = 16;
+
+StreamBuffer::StreamBuffer(RenderBackend *backend, GLsizeiptr region_size){
+
+    backend_ = backend;
+    buffer_ = 0;
+    region_size_ = region_size;
+    region_ = 0;
+    used_ = 0;
+    persistent_ = false;
+    fenced_ = false;
+    mapped_ = NULL;
+    for (int i = 0; i < stream_regions_g; i++){
+        fence_[i] = 0;
+    }
+}
+
+
+StreamBuffer::~StreamBuffer(){
+
+    // The context may already be gone when the owner is destroyed
+    if (buffer_ && (backend_ != GetGLBackend() || glfwGetCurrentContext())){
+        Destroy();
+    }
+}
+
+
+void StreamBuffer::Create(GLsizeiptr region_size){
+
+    region_size_ = region_size;
+    region_ = 0;
+    used_ = 0;
+    fenced_ = backend_->Supports(SyncFeature);
+    persistent_ = fenced_ && backend_->Supports(BufferStorageFeature);
+
+    buffer_ = backend_->CreateBuffer();
+    backend_->BindBuffer(GL_ARRAY_BUFFER, buffer_);
+    GLsizeiptr size = region_size_ * stream_regions_g;
+    if (persistent_){
+        // Coherent mapping: writes are visible to later commands without explicit flushes
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        backend_->BufferStorage(GL_ARRAY_BUFFER, size, flags);
+        mapped_ = (unsigned char *) backend_->MapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+    }
+    else {
+        backend_->BufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+        mapped_ = NULL;
+    }
+}
+
+
+void StreamBuffer::Destroy(void){
+
+    if (mapped_){
+        backend_->BindBuffer(GL_ARRAY_BUFFER, buffer_);
+        backend_->UnmapBuffer(GL_ARRAY_BUFFER);
+        mapped_ = NULL;
+    }
+    for (int i = 0; i < stream_regions_g; i++){
+        if (fence_[i]){
+            backend_->DeleteSync(fence_[i]);
+            fence_[i] = 0;
+        }
+    }
+    // Deletion is deferred by GL until pending draws are done with the buffer
+    backend_->DeleteBuffer(buffer_);
+    buffer_ = 0;
+}
+
+
+void StreamBuffer::WaitRegion(int region){
+
+    if (!fence_[region]){
+        return;
+    }
+    bool done = backend_->WaitSync(fence_[region], 0);
+    while (!done){
+        done = backend_->WaitSync(fence_[region], 1000000); // 1 ms
+    }
+    backend_->DeleteSync(fence_[region]);
+    fence_[region] = 0;
+}
+
+
+void *StreamBuffer::Allocate(GLsizeiptr size, GLintptr &offset){
+
+    size = (size + stream_alignment_g - 1) / stream_alignment_g * stream_alignment_g;
+    if (!buffer_){
+        Create(region_size_);
+    }
+
+    // Not enough room left in this frame's region: replace the buffer by a larger one
+    if (used_ + size > region_size_){
+        GLsizeiptr region_size = region_size_ * 2;
+        while (region_size < size){
+            region_size *= 2;
+        }
+        Flush();
+        Destroy();
+        Create(region_size);
+    }
+
+    // First allocation of the frame: the GPU must be done with the region
+    if (used_ == 0){
+        WaitRegion(region_);
+    }
+    offset = region_ * region_size_ + used_;
+    used_ += size;
+
+    if (persistent_){
+        return mapped_ + offset;
+    }
+
+    // One range mapped at a time; the region is not in use by the GPU, so no synchronization
+    Flush();
+    backend_->BindBuffer(GL_ARRAY_BUFFER, buffer_);
+    mapped_ = (unsigned char *) backend_->MapBufferRange(GL_ARRAY_BUFFER, offset, size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    return mapped_;
+}
+
+
+void StreamBuffer::Flush(void){
+
+    if (!persistent_ && mapped_){
+        backend_->BindBuffer(GL_ARRAY_BUFFER, buffer_);
+        backend_->UnmapBuffer(GL_ARRAY_BUFFER);
+        mapped_ = NULL;
+    }
+}
+
+
+void StreamBuffer::EndFrame(void){
+
+    if (!buffer_){
+        return;
+    }
+    Flush();
+
+    if (fenced_){
+        if (used_ > 0){
+            fence_[region_] = backend_->FenceSync();
+        }
+    }
+    region_ = (region_ + 1) % stream_regions_g;
+    used_ = 0;
+
+    // Without fences, give the buffer new storage when the regions wrap around
+    if (!fenced_ && region_ == 0){
+        backend_->BindBuffer(GL_ARRAY_BUFFER, buffer_);
+        backend_->BufferData(GL_ARRAY_BUFFER, region_size_ * stream_regions_g, NULL, GL_STREAM_DRAW);
+    }
+}
+
+
+GLuint StreamBuffer::GetBuffer(void) const {
+
+    return buffer_;
+}
+
+
+bool StreamBuffer::IsPersistent(void) const {
+
+    return persistent_;
+}
+
+} // namespace game
@@ -0,0 +1,65 @@
+#ifndef STREAM_BUFFER_H_
+#define STREAM_BUFFER_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "render_backend.h"
+
+namespace game {
+
+    // Number of frames the stream buffer cycles through
+    const int stream_regions_g = 3;
+
+    // Class that streams per-frame data (transforms, colors, draw commands) to the GPU.
+    // The buffer is split into one region per frame in flight; each region is fenced
+    // when its frame ends and only reused once the GPU is done with it, so writing
+    // never waits on draws of the previous frames. With ARB_buffer_storage the whole
+    // buffer stays persistently mapped and data is written in place; otherwise each
+    // allocation maps its range without synchronization
+    class StreamBuffer {
+
+        public:
+            // Constructor and destructor; region_size is the initial size of a frame's region.
+            // The buffer is created through 'backend'
+            StreamBuffer(RenderBackend *backend, GLsizeiptr region_size);
+            ~StreamBuffer();
+
+            // Reserve 'size' bytes for the current frame. Returns where to write them; 'offset'
+            // receives their position in the buffer (for attribute pointers and indirect draws).
+            // The pointer is valid until the next Allocate or Flush. Growing the buffer replaces
+            // it, so data allocated earlier in the frame must already have been drawn
+            void *Allocate(GLsizeiptr size, GLintptr &offset);
+            // Make the written data visible to the GPU; call before drawing from it
+            void Flush(void);
+            // Fence the region of the current frame and move to the next one
+            void EndFrame(void);
+
+            // Buffer to bind for drawing (changes when the buffer grows)
+            GLuint GetBuffer(void) const;
+            // True if the buffer is persistently mapped
+            bool IsPersistent(void) const;
+
+        private:
+            RenderBackend *backend_;
+            GLuint buffer_;
+            GLsizeiptr region_size_; // Bytes per region
+            int region_; // Region of the current frame
+            GLsizeiptr used_; // Bytes allocated in the current region
+            bool persistent_; // Persistent mapping (ARB_buffer_storage)
+            bool fenced_; // Regions are fenced (ARB_sync); otherwise the buffer is orphaned on wrap
+            unsigned char *mapped_; // Persistent mapping of the whole buffer, or the range mapped by Allocate
+            GLsync fence_[stream_regions_g]; // Pending GPU work per region
+
+            // Allocate or release the GL buffer
+            void Create(GLsizeiptr region_size);
+            void Destroy(void);
+            // Block until the GPU has finished reading 'region' (normally already the case)
+            void WaitRegion(int region);
+
+    }; // class StreamBuffer
+
+} // namespace game
+
+#endif // STREAM_BUFFER_H_
@@ -0,0 +1,235 @@
+/*
+ *
+ * Test of the renderer on the null backend, without a window or GL context: a small
+ * scene is drawn with and without multi-draw indirect, and the draws, binds and uploads
+ * of a frame are checked. The command stream of one frame is compared with a golden file
+ *
+ * Usage: render_backend_test GOLDEN_FILE
+ *
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <glm/gtc/quaternion.hpp>
+
+#include "../camera.h"
+#include "../geometry_pool.h"
+#include "../null_backend.h"
+#include "../resource.h"
+#include "../scene_graph.h"
+#include "../scene_node.h"
+#include "../vertex_format.h"
+
+using namespace game;
+
+// The renderer reads the time from GLFW; a fixed time keeps the command stream the same
+double glfwGetTime(void){
+
+    return 1.0;
+}
+
+
+// No window: the GL context is never current
+GLFWwindow *glfwGetCurrentContext(void){
+
+    return NULL;
+}
+
+
+namespace game {
+
+// Classes given no backend fall back to the GL one, which is a null backend here
+RenderBackend *GetGLBackend(void){
+
+    static NullBackend backend;
+    return &backend;
+}
+
+} // namespace game
+
+
+// Number of failed checks
+static int failures_g = 0;
+
+// Report a failed check
+#define Check(condition)\
+    do {\
+        if (!(condition)){\
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl;\
+            failures_g++;\
+        }\
+    } while (0)
+
+// Meshes of the scene: vertices and indices of each (the contents are made up)
+const GLsizei box_vertex_num_g = 8, box_index_num_g = 36;
+const GLsizei quad_vertex_num_g = 4, quad_index_num_g = 6;
+
+
+// Add a mesh with made-up contents to the pool; the resource uses the pool buffers
+// as they are after the last Add
+static Resource *AddMesh(GeometryPool &pool, const std::string &name, GLsizei vertex_num, GLsizei index_num){
+
+    std::vector<unsigned char> vertex(vertex_num * packed_vertex_format_g.stride);
+    for (size_t i = 0; i < vertex.size(); i++){
+        vertex[i] = (unsigned char) (i * 7 + name.size());
+    }
+    std::vector<GLushort> index(index_num);
+    for (GLsizei i = 0; i < index_num; i++){
+        index[i] = (GLushort) (i % vertex_num);
+    }
+
+    GLint base_vertex;
+    GLuint first_index;
+    pool.Add(vertex.data(), vertex_num, index.data(), index_num, base_vertex, first_index);
+
+    Resource *mesh = new Resource(Mesh, name, 0, 0, index_num);
+    mesh->SetVertexFormat(&packed_vertex_format_g, GL_UNSIGNED_SHORT);
+    mesh->SetBufferRange(base_vertex, first_index);
+    mesh->SetVertexCount(vertex_num);
+    mesh->SetBoundingSphere(glm::vec3(0.0f), 1.0f);
+    return mesh;
+}
+
+
+// Draw the test scene and check the work of a frame; returns the command stream
+// of the frame. Two boxes and two quads share one material and the pool buffers; a fifth
+// node is behind the camera
+static std::string DrawScene(bool multi_draw){
+
+    RecordingBackend backend;
+    backend.SetSupported(MultiDrawIndirectFeature, multi_draw);
+
+    // Meshes: only the new data is uploaded, once
+    GeometryPool pool(packed_vertex_format_g.stride, &backend);
+    Resource *box = AddMesh(pool, "Box", box_vertex_num_g, box_index_num_g);
+    Resource *quad = AddMesh(pool, "Quad", quad_vertex_num_g, quad_index_num_g);
+    box->SetBuffers(pool.GetArrayBuffer(), pool.GetElementArrayBuffer(), box_index_num_g);
+    box->SetId(0);
+    quad->SetBuffers(pool.GetArrayBuffer(), pool.GetElementArrayBuffer(), quad_index_num_g);
+    quad->SetId(1);
+    size_t vertex_bytes = (box_vertex_num_g + quad_vertex_num_g) * packed_vertex_format_g.stride;
+    size_t index_bytes = (box_index_num_g + quad_index_num_g) * sizeof(GLushort);
+    Check(backend.GetCounters().uploaded_bytes == vertex_bytes + index_bytes);
+
+    // Material without features, already built
+    Resource material(Material, "ObjectMaterial", 1, 0);
+    material.SetProgram(0, 1);
+
+    std::string frame;
+    {
+        SceneGraph scene(&backend);
+        scene.CreateNode("Box1", box, &material)->SetPosition(glm::vec3(-3.0f, 0.0f, 0.0f));
+        scene.CreateNode("Box2", box, &material)->SetPosition(glm::vec3(3.0f, 0.0f, 0.0f));
+        scene.CreateNode("Quad1", quad, &material)->SetPosition(glm::vec3(0.0f, -2.0f, 0.0f));
+        scene.CreateNode("Quad2", quad, &material)->SetPosition(glm::vec3(0.0f, 2.0f, 0.0f));
+        scene.CreateNode("Hidden", box, &material)->SetPosition(glm::vec3(0.0f, 0.0f, 20.0f));
+
+        Camera camera;
+        camera.SetView(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        camera.SetProjection(90.0f, 0.5f, 100.0f, 800.0f, 600.0f);
+
+        // The first frame creates the stream buffer; the second is checked
+        scene.Draw(&camera);
+        backend.ResetCounters();
+        backend.ClearRecording();
+        scene.Draw(&camera);
+        frame = backend.GetRecording();
+
+        const CullStats &cull = scene.GetCullStats();
+        Check(cull.drawn == 4);
+        Check(cull.culled == 1);
+
+        // Meshes sorted together share the program and the pool buffers
+        const BackendCounters &counters = backend.GetCounters();
+        Check(counters.program_binds == 1);
+        Check(counters.commands == 4);
+        Check(counters.indices == (size_t) (2 * box_index_num_g + 2 * quad_index_num_g));
+        if (multi_draw){
+            // One multi-draw. The per-draw data (world matrix and material) and the commands
+            // (five words each) are mapped from the stream buffer, which is bound to map and
+            // unmap it, for the instance attributes and for the indirect commands
+            Check(counters.draws == 1);
+            Check(counters.buffer_binds == 6);
+            Check(counters.uploaded_bytes == 4 * (20 * sizeof(GLfloat) + 5 * sizeof(GLuint)));
+        }
+        else {
+            // One draw per node, with the pool buffers bound once
+            Check(counters.draws == 4);
+            Check(counters.buffer_binds == 2);
+            Check(counters.uploaded_bytes == 0);
+        }
+    }
+
+    delete box;
+    delete quad;
+    return frame;
+}
+
+
+// Lines of a command stream (without carriage returns, so the golden file may have either)
+static std::vector<std::string> SplitLines(const std::string &text){
+
+    std::vector<std::string> line;
+    std::stringstream ss(text);
+    std::string l;
+    while (std::getline(ss, l)){
+        if (!l.empty() && l.back() == '\r'){
+            l.pop_back();
+        }
+        line.push_back(l);
+    }
+    return line;
+}
+
+
+// Compare the recorded frame with the golden file; on a difference the frame is written
+// next to the test to be diffed (and copied over the golden file if the change is intended)
+static void CompareFrame(const std::string &frame, const std::string &golden_file){
+
+    std::ifstream f(golden_file.c_str(), std::ios::binary);
+    if (f.fail()){
+        std::cerr << "Error opening file " << golden_file << std::endl;
+        failures_g++;
+        return;
+    }
+    std::stringstream golden;
+    golden << f.rdbuf();
+
+    std::vector<std::string> expected = SplitLines(golden.str());
+    std::vector<std::string> recorded = SplitLines(frame);
+    for (size_t i = 0; i < expected.size() || i < recorded.size(); i++){
+        std::string e = (i < expected.size()) ? expected[i] : "(end of stream)";
+        std::string r = (i < recorded.size()) ? recorded[i] : "(end of stream)";
+        if (e != r){
+            std::cerr << golden_file << ":" << i + 1 << ": expected '" << e << "', recorded '" << r << "'" << std::endl;
+            std::ofstream out("recorded_frame.txt", std::ios::binary);
+            out << frame;
+            std::cerr << "Recorded frame written to recorded_frame.txt" << std::endl;
+            failures_g++;
+            return;
+        }
+    }
+}
+
+
+int main(int argc, char *argv[]){
+
+    if (argc != 2){
+        std::cerr << "Usage: " << argv[0] << " GOLDEN_FILE" << std::endl;
+        return 1;
+    }
+
+    DrawScene(false);
+    // Frame compared with the golden stream (the backend reports multi-draw by default)
+    CompareFrame(DrawScene(true), argv[1]);
+
+    if (failures_g){
+        std::cerr << failures_g << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All checks passed" << std::endl;
+    return 0;
+}
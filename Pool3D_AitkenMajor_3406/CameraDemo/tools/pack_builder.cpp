@@ -0,0 +1,273 @@
+// Asset pack builder: bundles the files and pre-generated meshes listed in a manifest
+// into one pack (asset_pack.h), so the game starts from a single mapped file.
+//
+// Usage: pack_builder <manifest> <source directory> <pack file>
+//
+// Manifest lines (# starts a comment):
+//   file <path>                  file relative to the source directory (shader, texture, ...)
+//   sphere <radius> <theta samples> <phi samples>
+//   colored_sphere <r> <g> <b> <gradient 0/1> <radius> <theta samples> <phi samples>
+//   torus <loop radius> <circle radius> <loop samples> <circle samples>
+//   box <width> <height> <depth>
+// Spheres are stored with all their levels of detail. The parameters must match the
+// ResourceManager::Create* calls of the game, or the game generates the mesh itself.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <map>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+
+#include "../asset_pack.h"
+#include "../mesh_generator.h"
+#include "../mesh_optimizer.h"
+
+using namespace game;
+
+// Data of an entry before the offsets are known
+struct Asset {
+    PackEntryType type;
+    std::string name; // Manifest description, for the report
+    std::vector<unsigned char> data;
+};
+
+
+// Pad 'data' to the pack alignment
+static void Align(std::vector<unsigned char> &data){
+
+    data.resize((data.size() + pack_alignment_g - 1) / pack_alignment_g * pack_alignment_g, 0);
+}
+
+
+// Add an entry unless the same asset is already in (e.g. listed twice)
+static void AddAsset(std::map<uint64_t, Asset> &assets, const std::string &key_name, Asset &asset){
+
+    uint64_t key = HashName(key_name);
+    auto found = assets.find(key);
+    if (found != assets.end()){
+        if (found->second.type != asset.type || found->second.name != asset.name){
+            throw(std::invalid_argument(std::string("Key collision between ")+found->second.name+" and "+asset.name));
+        }
+        return;
+    }
+    assets[key] = std::move(asset);
+}
+
+
+static void AddFile(std::map<uint64_t, Asset> &assets, const std::string &directory, const std::string &path){
+
+    std::string filename = directory + "/" + path;
+    std::ifstream f(filename.c_str(), std::ios::in | std::ios::binary);
+    if (f.fail()){
+        throw(std::ios_base::failure(std::string("Error opening file ")+filename));
+    }
+    std::stringstream content;
+    content << f.rdbuf();
+    std::string text = content.str();
+
+    Asset asset;
+    asset.type = PackedFile;
+    asset.name = path;
+    asset.data.assign(text.begin(), text.end());
+
+    // Files are found by name only, as AssetPack::FindFile does
+    size_t slash = path.find_last_of("/\\");
+    AddAsset(assets, slash == std::string::npos ? path : path.substr(slash + 1), asset);
+}
+
+
+static void AddMesh(std::map<uint64_t, Asset> &assets, const std::string &description, const MeshData &mesh){
+
+    const GLuint vertex_num = (GLuint) (mesh.vertex.size() / packed_vertex_format_g.stride);
+    std::cout << description << ": " << mesh.source_vertex_num << " -> " << vertex_num << " vertices, "
+              << mesh.source_index_num / 3 << " -> " << mesh.index.size() / 3 << " triangles, ACMR "
+              << mesh.source_acmr << " -> " << ComputeACMR(mesh.index, vertex_num) << std::endl;
+
+    // Same index size as the game picks for a generated mesh
+    PackMeshHeader header;
+    memset(&header, 0, sizeof(header));
+    header.vertex_num = vertex_num;
+    header.index_num = (uint32_t) mesh.index.size();
+    header.index_size = (vertex_num <= 0x10000) ? 2 : 4;
+    for (int i = 0; i < 3; i++){
+        header.position_offset[i] = mesh.position_offset[i];
+        header.position_scale[i] = mesh.position_scale[i];
+    }
+
+    Asset asset;
+    asset.type = PackedMesh;
+    asset.name = description;
+    asset.data.resize(sizeof(header));
+    Align(asset.data);
+    header.vertex_offset = (uint32_t) asset.data.size();
+    asset.data.insert(asset.data.end(), mesh.vertex.begin(), mesh.vertex.end());
+    Align(asset.data);
+    header.index_offset = (uint32_t) asset.data.size();
+    if (header.index_size == 2){
+        std::vector<GLushort> short_index(mesh.index.begin(), mesh.index.end());
+        const unsigned char *bytes = (const unsigned char *) short_index.data();
+        asset.data.insert(asset.data.end(), bytes, bytes + short_index.size() * sizeof(GLushort));
+    }
+    else {
+        const unsigned char *bytes = (const unsigned char *) mesh.index.data();
+        asset.data.insert(asset.data.end(), bytes, bytes + mesh.index.size() * sizeof(GLuint));
+    }
+    memcpy(asset.data.data(), &header, sizeof(header));
+
+    AddAsset(assets, description, asset);
+}
+
+
+static void ReadManifest(std::map<uint64_t, Asset> &assets, const std::string &manifest, const std::string &directory){
+
+    std::ifstream f(manifest.c_str());
+    if (f.fail()){
+        throw(std::ios_base::failure(std::string("Error opening manifest ")+manifest));
+    }
+
+    std::string line;
+    int line_num = 0;
+    while (std::getline(f, line)){
+        line_num++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos){
+            line.erase(comment);
+        }
+        std::istringstream in(line);
+        std::string kind;
+        if (!(in >> kind)){
+            continue;
+        }
+
+        MeshData mesh;
+        bool valid = false;
+        if (kind == "file"){
+            std::string path;
+            if ((valid = (bool) (in >> path))){
+                AddFile(assets, directory, path);
+            }
+        }
+        else if (kind == "sphere" || kind == "colored_sphere"){
+            glm::vec3 color(1.0f);
+            int gradient = 0;
+            float radius;
+            int theta, phi;
+            if (kind == "colored_sphere"){
+                in >> color.x >> color.y >> color.z >> gradient;
+            }
+            if ((valid = (bool) (in >> radius >> theta >> phi))){
+                std::vector<int> level_theta, level_phi;
+                GetSphereLevels(theta, phi, level_theta, level_phi);
+                for (size_t l = 0; l < level_theta.size(); l++){
+                    if (kind == "sphere"){
+                        GenerateSphere(radius, level_theta[l], level_phi[l], mesh);
+                        AddMesh(assets, DescribeSphere(radius, level_theta[l], level_phi[l]), mesh);
+                    }
+                    else {
+                        GenerateColoredSphere(color, gradient != 0, radius, level_theta[l], level_phi[l], mesh);
+                        AddMesh(assets, DescribeColoredSphere(color, gradient != 0, radius, level_theta[l], level_phi[l]), mesh);
+                    }
+                }
+            }
+        }
+        else if (kind == "torus"){
+            float loop_radius, circle_radius;
+            int loop_samples, circle_samples;
+            if ((valid = (bool) (in >> loop_radius >> circle_radius >> loop_samples >> circle_samples))){
+                GenerateTorus(loop_radius, circle_radius, loop_samples, circle_samples, mesh);
+                AddMesh(assets, DescribeTorus(loop_radius, circle_radius, loop_samples, circle_samples), mesh);
+            }
+        }
+        else if (kind == "box"){
+            float width, height, depth;
+            if ((valid = (bool) (in >> width >> height >> depth))){
+                GenerateBox(width, height, depth, mesh);
+                AddMesh(assets, DescribeBox(width, height, depth), mesh);
+            }
+        }
+        if (!valid){
+            std::stringstream error;
+            error << manifest << ":" << line_num << ": invalid line";
+            throw(std::invalid_argument(error.str()));
+        }
+    }
+}
+
+
+static void WritePack(const std::map<uint64_t, Asset> &assets, const std::string &filename){
+
+    // Index first, in key order (the map is sorted), then the aligned data
+    std::vector<PackEntry> entry;
+    std::vector<unsigned char> header_bytes(sizeof(PackHeader) + assets.size() * sizeof(PackEntry));
+    Align(header_bytes);
+    uint64_t offset = header_bytes.size();
+    for (const auto &asset : assets){
+        PackEntry e;
+        memset(&e, 0, sizeof(e));
+        e.key = asset.first;
+        e.type = asset.second.type;
+        e.offset = offset;
+        e.size = asset.second.data.size();
+        entry.push_back(e);
+        offset += (e.size + pack_alignment_g - 1) / pack_alignment_g * pack_alignment_g;
+    }
+
+    PackHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = pack_magic_g;
+    header.version = pack_version_g;
+    header.entry_num = (uint32_t) entry.size();
+    memcpy(header_bytes.data(), &header, sizeof(header));
+    if (!entry.empty()){
+        memcpy(header_bytes.data() + sizeof(header), entry.data(), entry.size() * sizeof(PackEntry));
+    }
+
+    // Written under a temporary name, so a failed build leaves no truncated pack
+    std::string temporary = filename + ".tmp";
+    std::ofstream f(temporary.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    f.write((const char *) header_bytes.data(), header_bytes.size());
+    for (const auto &asset : assets){
+        std::vector<unsigned char> data = asset.second.data;
+        Align(data);
+        f.write((const char *) data.data(), data.size());
+    }
+    f.close();
+    if (!f){
+        std::remove(temporary.c_str());
+        throw(std::ios_base::failure(std::string("Error writing asset pack ")+filename));
+    }
+    std::remove(filename.c_str());
+    if (std::rename(temporary.c_str(), filename.c_str()) != 0){
+        throw(std::ios_base::failure(std::string("Error writing asset pack ")+filename));
+    }
+}
+
+
+int main(int argc, char *argv[]){
+
+    if (argc != 4){
+        std::cerr << "Usage: " << argv[0] << " <manifest> <source directory> <pack file>" << std::endl;
+        return 1;
+    }
+
+    try {
+        std::map<uint64_t, Asset> assets;
+        ReadManifest(assets, argv[1], argv[2]);
+        WritePack(assets, argv[3]);
+
+        size_t total = 0;
+        for (const auto &asset : assets){
+            total += asset.second.data.size();
+        }
+        std::cout << "Asset pack " << argv[3] << ": " << assets.size() << " entries, " << total << " bytes" << std::endl;
+    }
+    catch (std::exception &e){
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+#include "update_scheduler.h"
+#include "profiler.h"
+
+namespace game {
+
+UpdateScheduler::UpdateScheduler(void){
+
+    next_id_ = 1;
+    signaled_ = 0;
+    slow_next_ = 0;
+    slow_due_ = 0.0;
+    last_frame_ = -1.0;
+}
+
+
+UpdateScheduler::~UpdateScheduler(){
+}
+
+
+UpdateId UpdateScheduler::Register(UpdateTier tier, UpdateFunction function, void *object){
+
+    Entry entry;
+    entry.function = function;
+    entry.object = object;
+    entry.id = next_id_++;
+    entry.last_run = last_frame_;
+    entry.signaled = false;
+
+    // After the entries with the same function, so they stay together
+    std::vector<Entry> &entries = entry_[tier];
+    auto position = std::upper_bound(entries.begin(), entries.end(), entry,
+        [](const Entry &a, const Entry &b){ return std::less<UpdateFunction>()(a.function, b.function); });
+    size_t index = position - entries.begin();
+    entries.insert(position, entry);
+    if (tier == SlowTier && index < slow_next_){
+        slow_next_++;
+    }
+    return entry.id;
+}
+
+
+UpdateScheduler::Entry *UpdateScheduler::Find(UpdateId id, int &tier){
+
+    for (tier = 0; tier < NumTiers; tier++){
+        for (Entry &entry : entry_[tier]){
+            if (entry.id == id){
+                return &entry;
+            }
+        }
+    }
+    return NULL;
+}
+
+
+void UpdateScheduler::Unregister(UpdateId id){
+
+    int tier;
+    Entry *entry = Find(id, tier);
+    if (!entry){
+        return;
+    }
+    if (entry->signaled){
+        signaled_--;
+    }
+    std::vector<Entry> &entries = entry_[tier];
+    size_t index = entry - entries.data();
+    entries.erase(entries.begin() + index);
+    if (tier == SlowTier && index < slow_next_){
+        slow_next_--;
+    }
+}
+
+
+void UpdateScheduler::Signal(UpdateId id){
+
+    int tier;
+    Entry *entry = Find(id, tier);
+    if (entry && tier == OnEventTier && !entry->signaled){
+        entry->signaled = true;
+        signaled_++;
+    }
+}
+
+
+void UpdateScheduler::RunFrame(double time){
+
+    PROFILE_ZONE("UpdateScheduler::RunFrame");
+    double elapsed = (last_frame_ < 0.0) ? 0.0 : time - last_frame_;
+    last_frame_ = time;
+
+    for (Entry &entry : entry_[EveryFrameTier]){
+        entry.function(entry.object, (float) (entry.last_run < 0.0 ? 0.0 : time - entry.last_run));
+        entry.last_run = time;
+    }
+
+    if (signaled_ > 0){
+        for (Entry &entry : entry_[OnEventTier]){
+            if (entry.signaled){
+                entry.signaled = false;
+                entry.function(entry.object, (float) (entry.last_run < 0.0 ? 0.0 : time - entry.last_run));
+                entry.last_run = time;
+            }
+        }
+        signaled_ = 0;
+    }
+
+    // Slow updates: each frame runs the share of one period's worth that its time covers,
+    // continuing where the last frame stopped. A long frame runs each entry at most once
+    std::vector<Entry> &slow = entry_[SlowTier];
+    if (slow.empty()){
+        return;
+    }
+    slow_due_ = std::min(slow_due_ + slow.size() * elapsed / update_slow_period_g, (double) slow.size());
+    size_t count = (size_t) slow_due_;
+    slow_due_ -= count;
+    for (size_t i = 0; i < count; i++){
+        if (slow_next_ >= slow.size()){
+            slow_next_ = 0;
+        }
+        Entry &entry = slow[slow_next_++];
+        entry.function(entry.object, (float) (entry.last_run < 0.0 ? 0.0 : time - entry.last_run));
+        entry.last_run = time;
+    }
+}
+
+
+void UpdateScheduler::RunTick(float dt){
+
+    for (Entry &entry : entry_[FixedTickTier]){
+        entry.function(entry.object, dt);
+    }
+}
+
+
+bool UpdateScheduler::NeedsFrame(void) const {
+
+    return !entry_[EveryFrameTier].empty() || signaled_ > 0;
+}
+
+
+double UpdateScheduler::GetSlowDeadline(void) const {
+
+    const std::vector<Entry> &slow = entry_[SlowTier];
+    if (slow.empty()){
+        return std::numeric_limits<double>::infinity();
+    }
+    if (last_frame_ < 0.0){
+        return 0.0;
+    }
+    // The next entry is due once the frames have accumulated the rest of its share
+    return last_frame_ + (1.0 - slow_due_) * update_slow_period_g / slow.size();
+}
+
+} // namespace game
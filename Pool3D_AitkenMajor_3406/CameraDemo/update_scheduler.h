@@ -0,0 +1,82 @@
+#ifndef UPDATE_SCHEDULER_H_
+#define UPDATE_SCHEDULER_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace game {
+
+    // How often a registered update runs
+    typedef enum Tier {
+        EveryFrameTier = 0, // Once per frame, with the frame time
+        FixedTickTier, // Once per fixed time step (RunTick)
+        SlowTier, // Every update_slow_period_g seconds, spread over the frames
+        OnEventTier, // At the next frame after Signal
+        NumTiers
+    } UpdateTier;
+
+    // Period of SlowTier updates (20 Hz)
+    const double update_slow_period_g = 0.05;
+
+    // Update of one object: 'object' is the pointer registered, 'dt' the seconds since its
+    // last run (the step for FixedTickTier)
+    typedef void (*UpdateFunction)(void *object, float dt);
+    // Registration (0: none)
+    typedef unsigned UpdateId;
+
+    // Class that runs the updates of systems and scene nodes at the rate each registered,
+    // instead of calling every node every frame: objects that need no update are not
+    // registered and cost nothing. Within a tier, updates with the same function (objects
+    // of one type) run one after another. Slow updates are spread over the frames of their
+    // period, so a frame runs a share of them instead of all at once. Only every-frame
+    // updates and signals need a frame: an idle game waits until the next slow update
+    // falls due (GetSlowDeadline) and runs it without drawing
+    class UpdateScheduler {
+
+        public:
+            UpdateScheduler(void);
+            ~UpdateScheduler();
+
+            // Run 'function(object, dt)' in 'tier'. Updates must not register or unregister
+            // while they run
+            UpdateId Register(UpdateTier tier, UpdateFunction function, void *object);
+            void Unregister(UpdateId id);
+            // Run an OnEventTier update at the next frame (once, however often it was signaled)
+            void Signal(UpdateId id);
+
+            // Run the updates of a frame at 'time' (seconds): every-frame updates, signaled
+            // updates and the share of slow updates that fell due
+            void RunFrame(double time);
+            // Run the fixed-tick updates for one step of 'dt' seconds
+            void RunTick(float dt);
+
+            // Whether the next frame has updates to run (every-frame updates or signals)
+            bool NeedsFrame(void) const;
+            // Time (seconds) at which the next slow update falls due, to be run by RunFrame
+            // (infinity: no slow updates)
+            double GetSlowDeadline(void) const;
+
+        private:
+            struct Entry {
+                UpdateFunction function;
+                void *object;
+                UpdateId id;
+                double last_run; // Time of the last run (negative: none yet)
+                bool signaled; // OnEventTier: run at the next frame
+            };
+            // Entries of each tier, grouped by function
+            std::vector<Entry> entry_[NumTiers];
+            UpdateId next_id_;
+            int signaled_; // OnEventTier entries signaled
+            size_t slow_next_; // SlowTier entry to run next
+            double slow_due_; // Fraction of the next slow update accumulated by past frames
+            double last_frame_; // Time of the last RunFrame (negative: none yet)
+
+            // Find a registration (null: not registered); 'tier' receives its tier
+            Entry *Find(UpdateId id, int &tier);
+
+    }; // class UpdateScheduler
+
+} // namespace game
+
+#endif // UPDATE_SCHEDULER_H_
@@ -0,0 +1,90 @@
+#include <cmath>
+#include <cstring>
+#include <glm/gtc/packing.hpp>
+
+#include "vertex_format.h"
+
+namespace game {
+
+const char *vertex_attribute_name_g[NumAttributes] = { "vertex", "normal", "color", "uv" };
+
+const VertexFormat packed_vertex_format_g = {
+    20,
+    4,
+    {
+        { PositionAttribute, 3, GL_SHORT, GL_TRUE, 0 },
+        { NormalAttribute, 2, GL_SHORT, GL_TRUE, 8 },
+        { ColorAttribute, 4, GL_UNSIGNED_BYTE, GL_TRUE, 12 },
+        { TexCoordAttribute, 2, GL_HALF_FLOAT, GL_FALSE, 16 }
+    }
+};
+
+
+glm::vec2 OctahedralEncode(const glm::vec3 &normal){
+
+    // Project onto the octahedron |x| + |y| + |z| = 1
+    float sum = fabs(normal.x) + fabs(normal.y) + fabs(normal.z);
+    if (sum <= 0.0f){
+        return glm::vec2(0.0f);
+    }
+    glm::vec2 p(normal.x / sum, normal.y / sum);
+
+    // Fold the lower hemisphere over the diagonals
+    if (normal.z < 0.0f){
+        glm::vec2 folded((1.0f - fabs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+                         (1.0f - fabs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f));
+        p = folded;
+    }
+    return p;
+}
+
+
+void PackVertices(const GLfloat *vertex, GLuint vertex_num, std::vector<unsigned char> &packed, glm::vec3 &offset, glm::vec3 &scale){
+
+    // Bounding box of the positions
+    glm::vec3 lo(0.0f), hi(0.0f);
+    for (GLuint i = 0; i < vertex_num; i++){
+        for (int k = 0; k < 3; k++){
+            float v = vertex[i*float_vertex_att_g + k];
+            if (i == 0 || v < lo[k]) lo[k] = v;
+            if (i == 0 || v > hi[k]) hi[k] = v;
+        }
+    }
+    offset = 0.5f * (lo + hi);
+    scale = 0.5f * (hi - lo);
+    for (int k = 0; k < 3; k++){
+        // Flat axis: any scale works
+        if (!(scale[k] > 0.0f)){
+            scale[k] = 1.0f;
+        }
+    }
+
+    const GLsizei stride = packed_vertex_format_g.stride;
+    packed.assign(vertex_num * stride, 0);
+    for (GLuint i = 0; i < vertex_num; i++){
+        const GLfloat *src = vertex + i*float_vertex_att_g;
+        unsigned char *dst = packed.data() + i*stride;
+
+        // Position (snorm16 x3, 2 bytes padding)
+        GLshort position[3];
+        for (int k = 0; k < 3; k++){
+            position[k] = (GLshort) glm::packSnorm1x16((src[k] - offset[k]) / scale[k]);
+        }
+        std::memcpy(dst, position, sizeof(position));
+
+        // Normal (octahedral, snorm16 x2)
+        glm::vec2 oct = OctahedralEncode(glm::vec3(src[3], src[4], src[5]));
+        GLshort normal[2] = { (GLshort) glm::packSnorm1x16(oct.x), (GLshort) glm::packSnorm1x16(oct.y) };
+        std::memcpy(dst + 8, normal, sizeof(normal));
+
+        // Color (unorm8 x4, opaque alpha)
+        GLubyte color[4] = { glm::packUnorm1x8(src[6]), glm::packUnorm1x8(src[7]), glm::packUnorm1x8(src[8]), 255 };
+        std::memcpy(dst + 12, color, sizeof(color));
+
+        // Texture coordinates (half x2)
+        GLushort uv[2] = { glm::packHalf1x16(src[9]), glm::packHalf1x16(src[10]) };
+        std::memcpy(dst + 16, uv, sizeof(uv));
+    }
+}
+
+} // namespace game
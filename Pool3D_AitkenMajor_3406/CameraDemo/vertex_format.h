@@ -0,0 +1,56 @@
+#ifndef VERTEX_FORMAT_H_
+#define VERTEX_FORMAT_H_
+
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+namespace game {
+
+    // Role of a vertex attribute; each one is bound to a fixed shader input name
+    typedef enum Semantic { PositionAttribute = 0, NormalAttribute, ColorAttribute, TexCoordAttribute, NumAttributes } VertexSemantic;
+
+    // Shader input names of the attributes, indexed by VertexSemantic
+    extern const char *vertex_attribute_name_g[NumAttributes];
+
+    // Layout of one attribute in an interleaved vertex
+    struct VertexAttribute {
+        VertexSemantic semantic;
+        GLint size; // Number of components
+        GLenum type; // Type of each component
+        GLboolean normalized; // Integer components map to [-1,1] (signed) or [0,1] (unsigned)
+        GLsizei offset; // Offset in bytes from the start of the vertex
+    };
+
+    // Description of an interleaved vertex layout, used to set up the attribute pointers
+    struct VertexFormat {
+        GLsizei stride; // Size of a vertex in bytes
+        int num_attributes;
+        VertexAttribute attribute[NumAttributes];
+    };
+
+    // Number of floats per vertex produced by the mesh generators:
+    // position (3), normal (3), color (3), uv (2)
+    const int float_vertex_att_g = 11;
+
+    // Compact layout used for all meshes (20 bytes instead of 44):
+    // position as snorm16 x3 relative to the mesh bounds (plus padding), octahedral normal
+    // as snorm16 x2, color as unorm8 x4, uv as half x2
+    extern const VertexFormat packed_vertex_format_g;
+    // Leading bytes of a packed vertex that identify it when welding: position, normal
+    // and color (uv is not used by the shaders, so seams split by uv alone are merged)
+    const GLsizei packed_weld_key_size_g = 16;
+
+    // Convert generator vertices to packed_vertex_format_g. Positions are quantized inside the
+    // bounding box of the mesh; 'offset' and 'scale' return the box center and half extents,
+    // so that the object-space position is offset + scale * decoded position
+    void PackVertices(const GLfloat *vertex, GLuint vertex_num, std::vector<unsigned char> &packed, glm::vec3 &offset, glm::vec3 &scale);
+
+    // Map a unit vector to the octahedron unfolded onto [-1,1]^2 (inverse in material_vp.glsl)
+    glm::vec2 OctahedralEncode(const glm::vec3 &normal);
+
+} // namespace game
+
+#endif // VERTEX_FORMAT_H_
@@ -0,0 +1,92 @@
+#include "worker_pool.h"
+#include "profiler.h"
+
+namespace game {
+
+WorkerPool::WorkerPool(int thread_num){
+
+    stop_ = false;
+    if (thread_num <= 0){
+        thread_num = (int) std::thread::hardware_concurrency() - 1;
+        if (thread_num < 1){
+            thread_num = 1;
+        }
+    }
+    for (int i = 0; i < thread_num; i++){
+        thread_.push_back(std::thread(&WorkerPool::Run, this));
+    }
+}
+
+
+WorkerPool::~WorkerPool(){
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        job_.clear();
+    }
+    wake_.notify_all();
+    for (auto &t : thread_){
+        t.join();
+    }
+}
+
+
+void WorkerPool::Submit(std::function<void(void)> job){
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_.push_back(std::move(job));
+    }
+    wake_.notify_one();
+}
+
+
+void WorkerPool::ParallelFor(int count, const std::function<void(int)> &job){
+
+    std::mutex done_mutex;
+    std::condition_variable done;
+    int remaining = count - 1;
+    for (int i = 1; i < count; i++){
+        Submit([&, i](){
+            job(i);
+            // Notify under the lock: the waiter may return (and destroy 'done') right after
+            std::lock_guard<std::mutex> lock(done_mutex);
+            remaining--;
+            done.notify_one();
+        });
+    }
+    if (count > 0){
+        job(0);
+    }
+    std::unique_lock<std::mutex> lock(done_mutex);
+    done.wait(lock, [&remaining](){ return remaining <= 0; });
+}
+
+
+int WorkerPool::GetThreadCount(void) const {
+
+    return (int) thread_.size();
+}
+
+
+void WorkerPool::Run(void){
+
+    Profiler::SetThreadName("Worker");
+    while (true){
+        std::function<void(void)> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this](){ return stop_ || !job_.empty(); });
+            if (stop_){
+                return;
+            }
+            job = std::move(job_.front());
+            job_.pop_front();
+        }
+        PROFILE_ZONE("Job");
+        job();
+    }
+}
+
+} // namespace game
@@ -0,0 +1,43 @@
+#ifndef WORKER_POOL_H_
+#define WORKER_POOL_H_
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace game {
+
+    // Threads running jobs that do not touch OpenGL (mesh generation, file loading)
+    class WorkerPool {
+
+        private:
+            std::vector<std::thread> thread_;
+            std::deque<std::function<void(void)> > job_; // Jobs not started yet
+            std::mutex mutex_;
+            std::condition_variable wake_;
+            bool stop_;
+
+            // Thread loop: run jobs until the pool is destroyed
+            void Run(void);
+
+        public:
+            // Start 'thread_num' threads (0: one less than the hardware threads, at least one)
+            WorkerPool(int thread_num = 0);
+            // Jobs not started yet are dropped; running jobs are waited for
+            ~WorkerPool();
+
+            // Queue a job; jobs start in the order they were submitted
+            void Submit(std::function<void(void)> job);
+            // Run job(0) .. job(count - 1) on the pool and the calling thread, and return
+            // once all of them are done
+            void ParallelFor(int count, const std::function<void(int)> &job);
+            int GetThreadCount(void) const;
+
+    }; // class WorkerPool
+
+} // namespace game
+
+#endif // WORKER_POOL_H_